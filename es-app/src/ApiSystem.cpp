@@ -11,9 +11,10 @@
 #include "utils/Platform.h"
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
-#include "utils/ThreadPool.h"
+#include "utils/TaskScheduler.h"
 #include "RetroAchievements.h"
 #include "utils/ZipFile.h"
+#include "utils/md5.h"
 #include "Paths.h"
 #include "utils/VectorEx.h"
 #include "LocaleES.h"
@@ -33,6 +34,7 @@
 #include <pugixml/src/pugixml.hpp>
 #include <rapidjson/rapidjson.h>
 #include <rapidjson/pointer.h>
+#include <libcheevos/sevenzip.h>
 
 #if WIN32
 #include <Windows.h>
@@ -1086,6 +1088,28 @@ std::pair<std::string, int> ApiSystem::uninstallBatoceraBezel(std::string bezels
 	return executeScript("batocera-es-thebezelproject remove " + bezelsystem, func);
 }
 
+// A solid block is decompressed at once, by each hashing thread : bigger ones are left to the external 7z command, which streams
+#define SEVENZIP_MAX_BLOCK_SIZE (32ULL * 1024 * 1024)
+
+// The only file of the archive that isn't a .txt, or nullptr
+static const SevenZipEntry* findSevenZipRom(const std::vector<SevenZipEntry>& entries)
+{
+	const SevenZipEntry* rom = nullptr;
+
+	for (auto& entry : entries)
+	{
+		if (entry.isDirectory || Utils::FileSystem::getExtension(entry.name) == ".txt")
+			continue;
+
+		if (rom != nullptr)
+			return nullptr;
+
+		rom = &entry;
+	}
+
+	return rom;
+}
+
 std::string ApiSystem::getMD5(const std::string fileName, bool fromZipContents)
 {
 	LOG(LogDebug) << "getMD5 >> " << fileName;
@@ -1118,6 +1142,27 @@ std::string ApiSystem::getMD5(const std::string fileName, bool fromZipContents)
 		}
 	}
 
+	if (ext == ".7z" && fromZipContents)
+	{
+		// Decompressed straight into the hash, without temporary files. Hashes the same bytes as the commands below, so existing hashes don't change.
+		MD5 md5;
+		auto hash = [&md5](const void* data, size_t size) { md5.update((const char*)data, (MD5::size_type)size); };
+
+#if WIN32
+		// The only rom of the archive
+		std::vector<SevenZipEntry> entries;
+		auto rom = sevenZipList(fileName.c_str(), entries) ? findSevenZipRom(entries) : nullptr;
+		if (rom != nullptr && sevenZipRead(fileName.c_str(), rom->name.c_str(), hash, SEVENZIP_MAX_BLOCK_SIZE))
+#else
+		// '7z x -so | md5sum' : all the files of the archive
+		if (sevenZipReadAll(fileName.c_str(), hash, SEVENZIP_MAX_BLOCK_SIZE))
+#endif
+		{
+			md5.finalize();
+			return md5.hexdigest();
+		}
+	}
+
 #if !WIN32
 	if (fromZipContents && ext == ".7z")
 	{
@@ -1169,6 +1214,24 @@ std::string ApiSystem::getCRC32(std::string fileName, bool fromZipContents)
 
 	if (ext == ".7z" && fromZipContents)
 	{
+		// CRCs are stored in the archive headers
+		std::vector<SevenZipEntry> entries;
+		if (sevenZipList(fileName.c_str(), entries))
+		{
+			LOG(LogDebug) << "getCRC32 is using 7z headers";
+
+			// Same as '7z l -slt' : the first CRC listed
+			for (auto& entry : entries)
+			{
+				if (entry.isDirectory || !entry.hasCrc)
+					continue;
+
+				char hex[10];
+				snprintf(hex, sizeof(hex), "%08X", entry.crc);
+				return hex;
+			}
+		}
+
 		LOG(LogDebug) << "getCRC32 is using 7z";
 
 		std::string fn = Utils::FileSystem::getFileName(fileName);
@@ -1595,10 +1658,10 @@ std::vector<std::string> ApiSystem::extractPdfImages(const std::string& fileName
 			int pc = getPdfPageCount(fileName);
 			if (pc > 0)
 			{
-				Utils::ThreadPool pool(1);
+				Utils::TaskGroup pool;
 
 				for (int i = 0; i < pc; i += numberOfPagesToProcess)
-					pool.queueWorkItem([this, fileName, i, numberOfPagesToProcess] { extractPdfImages(fileName, i + 1, numberOfPagesToProcess); });
+					pool.run([this, fileName, i, numberOfPagesToProcess] { extractPdfImages(fileName, i + 1, numberOfPagesToProcess); });
 
 				pool.wait();
 
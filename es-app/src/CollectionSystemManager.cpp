@@ -9,6 +9,7 @@
 #include "FileSorts.h"
 #include "FileFilterIndex.h"
 #include "Log.h"
+#include "Tracer.h"
 #include "Settings.h"
 #include "SystemData.h"
 #include "ThemeData.h"
@@ -19,7 +20,7 @@
 #include "FileSorts.h"
 #include "views/gamelist/ISimpleGameListView.h"
 #include "PlatformId.h"
-#include "utils/ThreadPool.h"
+#include "utils/TaskScheduler.h"
 #include "Genres.h"
 #include "Paths.h"
 
@@ -341,6 +342,8 @@ void CollectionSystemManager::saveCustomCollection(SystemData* sys)
 // loads all Collection Systems
 void CollectionSystemManager::loadCollectionSystems()
 {
+	TRACE_SCOPE("CollectionSystemManager::loadCollectionSystems");
+
 	initAutoCollectionSystems();
 	
 	CollectionSystemDecl decl = mCollectionSystemDeclsIndex[myCollectionsName];
@@ -432,15 +435,15 @@ void CollectionSystemManager::refreshCollectionSystems(FileData* file)
 	if (!file->getSystem()->isGameSystem() || file->getType() != GAME)
 		return;
 
-	std::map<std::string, CollectionSystemData> allCollections;
-	allCollections.insert(mAutoCollectionSystemsData.cbegin(), mAutoCollectionSystemsData.cend());
-	allCollections.insert(mCustomCollectionSystemsData.cbegin(), mCustomCollectionSystemsData.cend());
+	for (auto& sysData : mAutoCollectionSystemsData)
+		updateCollectionSystem(file, sysData.second);
 
-	for (auto sysDataIt = allCollections.cbegin(); sysDataIt != allCollections.cend(); sysDataIt++)
-		updateCollectionSystem(file, sysDataIt->second);
+	for (auto& sysData : mCustomCollectionSystemsData)
+		if (mAutoCollectionSystemsData.find(sysData.first) == mAutoCollectionSystemsData.cend())
+			updateCollectionSystem(file, sysData.second);
 }
 
-void CollectionSystemManager::updateCollectionSystem(FileData* file, CollectionSystemData sysData)
+void CollectionSystemManager::updateCollectionSystem(FileData* file, const CollectionSystemData& sysData)
 {
 	if (!sysData.isPopulated)
 		return;
@@ -515,9 +518,7 @@ void CollectionSystemManager::sortLastPlayed(SystemData* system)
 	const FileSorts::SortType& sort = FileSorts::getSortTypes().at(system->getSortId());
 
 	std::vector<FileData*>& childs = (std::vector<FileData*>&) rootFolder->getChildren();
-	std::sort(childs.begin(), childs.end(), sort.comparisonFunction);
-	if (!sort.ascending)
-		std::reverse(childs.begin(), childs.end());
+	FileSorts::sortFiles(childs, sort);
 }
 
 void CollectionSystemManager::trimCollectionCount(FolderData* rootFolder, int limit)
@@ -543,22 +544,26 @@ void CollectionSystemManager::deleteCollectionFiles(FileData* file)
 	std::string key = file->getFullPath();
 
 	// find games in collection systems
-	std::map<std::string, CollectionSystemData> allCollections;
-	allCollections.insert(mAutoCollectionSystemsData.cbegin(), mAutoCollectionSystemsData.cend());
-	allCollections.insert(mCustomCollectionSystemsData.cbegin(), mCustomCollectionSystemsData.cend());
+	std::vector<CollectionSystemData*> allCollections;
+	for (auto& sysData : mAutoCollectionSystemsData)
+		allCollections.push_back(&sysData.second);
+
+	for (auto& sysData : mCustomCollectionSystemsData)
+		if (mAutoCollectionSystemsData.find(sysData.first) == mAutoCollectionSystemsData.cend())
+			allCollections.push_back(&sysData.second);
 
-	for (auto sysDataIt = allCollections.begin(); sysDataIt != allCollections.end(); sysDataIt++)
+	for (auto sysData : allCollections)
 	{
-		if (!sysDataIt->second.isPopulated)
+		if (!sysData->isPopulated)
 			continue;
 
-		FileData* collectionEntry = (sysDataIt->second.system)->getRootFolder()->FindByPath(key);
+		FileData* collectionEntry = (sysData->system)->getRootFolder()->FindByPath(key);
 		if (collectionEntry == nullptr)
 			continue;
 		
-		sysDataIt->second.needsSave = true;
+		sysData->needsSave = true;
 
-		SystemData* systemViewToUpdate = getSystemToView(sysDataIt->second.system);
+		SystemData* systemViewToUpdate = getSystemToView(sysData->system);
 		if (systemViewToUpdate == nullptr)
 			continue;
 
@@ -948,13 +953,96 @@ SystemData* CollectionSystemManager::createNewCollectionEntry(std::string name,
 // populates an Automatic Collection System
 void CollectionSystemManager::populateAutoCollection(CollectionSystemData* sysData)
 {
-	SystemData* newSys = sysData->system;
-	CollectionSystemDecl sysDecl = sysData->decl;
-	FolderData* rootFolder = newSys->getRootFolder();
+	populateAutoCollections({ sysData });
+}
+
+// Values of a game that are tested by several auto collections, computed on first use
+struct AutoCollectionGameInfo
+{
+	AutoCollectionGameInfo(FileData* game) : file(game), hasPlayCount(-1), hasPlayers(false) { }
+
+	bool isPlayed()
+	{
+		if (hasPlayCount < 0)
+			hasPlayCount = file->getMetadata(MetaDataId::PlayCount) > "0" ? 1 : 0;
+
+		return hasPlayCount == 1;
+	}
+
+	bool allowsPlayers(int val)
+	{
+		if (!hasPlayers)
+		{
+			players = file->parsePlayersRange();
+			hasPlayers = true;
+		}
+
+		return players.first <= 0 ? (val == players.second) : (players.first <= val && val <= players.second);
+	}
+
+	FileData* file;
+	int hasPlayCount;
+	bool hasPlayers;
+	std::pair<int, int> players;
+};
+
+static bool isInAutoCollection(CollectionSystemDecl& sysDecl, AutoCollectionGameInfo& info, bool isArcade)
+{
+	FileData* game = info.file;
+
+	switch (sysDecl.type)
+	{
+	case AUTO_ALL_GAMES:
+		return true;
+	case AUTO_VERTICALARCADE:
+		return game->isVerticalArcadeGame();
+	case AUTO_LIGHTGUN:
+		return game->isLightGunGame();
+	case AUTO_WHEEL:
+		return game->isWheelGame();
+	case AUTO_RETROACHIEVEMENTS:
+		return game->hasCheevos();
+	case AUTO_LAST_PLAYED:
+		return info.isPlayed();
+	case AUTO_NEVER_PLAYED:
+		return !info.isPlayed();
+	case AUTO_FAVORITES:
+		// we may still want to add files we don't want in auto collections in "favorites"
+		return game->getFavorite();
+	case AUTO_ARCADE:
+		return isArcade;
+	case AUTO_AT2PLAYERS:
+		return info.allowsPlayers(2);
+	case AUTO_AT4PLAYERS:
+		return info.allowsPlayers(4);
+	default:
+		if (!sysDecl.isCustom && !sysDecl.displayIfEmpty)
+		{
+			if (sysDecl.isGenreCollection())
+				return Genres::genreExists(&game->getMetadata(), ((int)sysDecl.type) - 10000);
+
+			if (sysDecl.isArcadeSubSystem())
+				return isArcade && game->getMetadata(MetaDataId::ArcadeSystemName) == sysDecl.themeFolder;
+		}
+
+		break;
+	}
+
+	return true;
+}
+
+// Populates several Automatic Collection Systems with a single walk of the game systems, each system being scanned by its own task
+void CollectionSystemManager::populateAutoCollections(const std::vector<CollectionSystemData*>& collections)
+{
+	if (collections.size() == 0)
+		return;
+
+	TRACE_SCOPE("CollectionSystemManager::populateAutoCollections");
 
 	bool hiddenSystemsShowGames = Settings::HiddenSystemsShowGames();
 	auto hiddenSystems = Utils::String::split(Settings::getInstance()->getString("HiddenSystems"), ';');
 
+	std::vector<SystemData*> systems;
 	for (auto& system : SystemData::sSystemVector)
 	{
 		// we won't iterate all collections
@@ -964,12 +1052,24 @@ void CollectionSystemManager::populateAutoCollection(CollectionSystemData* sysDa
 		if (!hiddenSystemsShowGames && std::find(hiddenSystems.cbegin(), hiddenSystems.cend(), system->getName()) != hiddenSystems.cend())
 			continue;
 
+		systems.push_back(system);
+	}
+
+	// Games of each system matching each collection, merged in system order once every system is scanned
+	std::vector<std::vector<std::vector<FileData*>>> matches(systems.size());
+
+	auto scanSystem = [this, &collections, &systems, &matches](size_t index)
+	{
+		SystemData* system = systems[index];
+		std::vector<std::vector<FileData*>>& systemMatches = matches[index];
+		systemMatches.resize(collections.size());
+
 		std::vector<PlatformIds::PlatformId> platforms = system->getPlatformIds();
 		bool isArcade = std::find(platforms.begin(), platforms.end(), PlatformIds::ARCADE) != platforms.end();
 
 		std::vector<std::string> hiddenExts;
-		for (auto ext : Utils::String::split(Settings::getInstance()->getString(system->getName() + ".HiddenExt"), ';'))
-			hiddenExts.push_back("." + Utils::String::toLower(ext));
+		for (auto& ext : *system->getHiddenExtensions())
+			hiddenExts.push_back("." + ext);
 
 		std::vector<FileData*> files = system->getRootFolder()->getFilesRecursive(GAME);
 		for (auto& game : files)
@@ -977,8 +1077,7 @@ void CollectionSystemManager::populateAutoCollection(CollectionSystemData* sysDa
 			if (system->isGroupSystem() && game->getSystem() != system)
 				continue;
 
-			bool include = includeFileInAutoCollections(game);
-			if (!include)
+			if (!includeFileInAutoCollections(game))
 				continue;
 
 			if (hiddenExts.size() > 0 && game->getType() == GAME)
@@ -988,85 +1087,61 @@ void CollectionSystemManager::populateAutoCollection(CollectionSystemData* sysDa
 					continue;
 			}
 
-			switch (sysDecl.type)
-			{
-			case AUTO_ALL_GAMES:
-				break;
-			case AUTO_VERTICALARCADE:
-				include = game->isVerticalArcadeGame();
-				break;
-			case AUTO_LIGHTGUN:
-				include = game->isLightGunGame();
-				break;
-			case AUTO_WHEEL:
-				include = game->isWheelGame();
-				break;
-			case AUTO_RETROACHIEVEMENTS:
-				include = game->hasCheevos();
-				break;
-			case AUTO_LAST_PLAYED:
-				include = game->getMetadata(MetaDataId::PlayCount) > "0";
-				break;
-			case AUTO_NEVER_PLAYED:
-				include = !(game->getMetadata(MetaDataId::PlayCount) > "0");
-				break;
-			case AUTO_FAVORITES:
-				// we may still want to add files we don't want in auto collections in "favorites"
-				include = game->getFavorite();
-				break;
-			case AUTO_ARCADE:
-				include = isArcade;
-				break;
-			case AUTO_AT2PLAYERS: 
-			case AUTO_AT4PLAYERS:
-			{
-				std::string players = game->getMetadata(MetaDataId::Players);
-				if (players.empty())
-					include = false;
-				else
-				{
-					auto range = game->parsePlayersRange();
+			AutoCollectionGameInfo info(game);
 
-					int val = (sysDecl.type == AUTO_AT2PLAYERS ? 2 : 4);
-					include = range.first <= 0 ? (val == range.second) : (range.first <= val && val <= range.second);
-				}
-			}
-			break;
+			for (size_t i = 0; i < collections.size(); i++)
+				if (isInAutoCollection(collections[i]->decl, info, isArcade))
+					systemMatches[i].push_back(game);
+		}
+	};
 
-			default:
-				if (!sysDecl.isCustom && !sysDecl.displayIfEmpty)
-				{
-					if (sysDecl.isGenreCollection())
-						include = Genres::genreExists(&game->getMetadata(), ((int)sysDecl.type) - 10000);
-					else if (sysDecl.isArcadeSubSystem())
-						include = isArcade && game->getMetadata(MetaDataId::ArcadeSystemName) == sysDecl.themeFolder;
-				}
+	if (systems.size() > 1 && Settings::getInstance()->getBool("ThreadedLoading"))
+	{
+		Utils::TaskGroup pool;
 
-				break;
-			}
+		for (size_t i = 0; i < systems.size(); i++)
+			pool.run([&scanSystem, i] { scanSystem(i); });
+
+		pool.wait();
+	}
+	else
+	{
+		for (size_t i = 0; i < systems.size(); i++)
+			scanSystem(i);
+	}
 
-			if (include)
+	for (size_t i = 0; i < collections.size(); i++)
+	{
+		CollectionSystemData* sysData = collections[i];
+		SystemData* newSys = sysData->system;
+		FolderData* rootFolder = newSys->getRootFolder();
+
+		for (auto& systemMatches : matches)
+		{
+			for (auto game : systemMatches[i])
 			{
 				CollectionFileData* newGame = new CollectionFileData(game, newSys);
 				rootFolder->addChild(newGame);
 				newSys->addToIndex(newGame);
 			}
 		}
-	}
 
-	if (sysDecl.type == AUTO_LAST_PLAYED)
-	{
-		sortLastPlayed(newSys);
-		trimCollectionCount(rootFolder, LAST_PLAYED_MAX);
-	}
+		if (sysData->decl.type == AUTO_LAST_PLAYED)
+		{
+			sortLastPlayed(newSys);
+			trimCollectionCount(rootFolder, LAST_PLAYED_MAX);
+		}
 
-	sysData->isPopulated = true;
-	updateCollectionFolderMetadata(newSys);
+		sysData->isPopulated = true;
+		updateCollectionFolderMetadata(newSys);
+	}
 }
 
 // populates a Custom Collection System
 void CollectionSystemManager::populateCustomCollection(CollectionSystemData* sysData, std::unordered_map<std::string, FileData*>* pMap)
 {
+	TRACE_SCOPE_ARG("CollectionSystemManager::populateCustomCollection", sysData->system->getName());
+
 	SystemData* newSys = sysData->system;
 	sysData->isPopulated = true;
 	CollectionSystemDecl sysDecl = sysData->decl;
@@ -1088,10 +1163,12 @@ void CollectionSystemManager::populateCustomCollection(CollectionSystemData* sys
 
 			std::vector<FileData*> games = folder->getFilesRecursive(GAME);
 			for (auto game : games)
-			{
 				if (sysData->filteredIndex->isSystemSelected(game->getSystemName()))
 					sysData->filteredIndex->addToIndex(game);
 
+			// Filters are evaluated once the whole index is built
+			for (auto game : games)
+			{
 				if (sysData->filteredIndex->showFile(game))
 				{
 					if (!hiddenSystemsShowGames && std::find(hiddenSystems.cbegin(), hiddenSystems.cend(), game->getSystemName()) != hiddenSystems.cend())
@@ -1199,21 +1276,37 @@ void CollectionSystemManager::addEnabledCollectionsToDisplayedSystems(std::map<s
 
 		if (collectionsToPopulate.size() > 1)
 		{
-			getAllGamesCollection();
+			// Auto collections are filled together, "all" being needed by the custom collections
+			std::vector<CollectionSystemData*> autoCollections;
 
-			Utils::ThreadPool pool;
+			CollectionSystemData* allSysData = &mAutoCollectionSystemsData["all"];
+			if (!allSysData->isPopulated)
+				autoCollections.push_back(allSysData);
+
+			for (auto collection : collectionsToPopulate)
+				if (!collection->decl.isCustom && collection != allSysData)
+					autoCollections.push_back(collection);
+
+			populateAutoCollections(autoCollections);
+
+			Utils::TaskGroup pool;
 
 			for (auto collection : collectionsToPopulate)
-			{
 				if (collection->decl.isCustom)
-					pool.queueWorkItem([this, collection, pMap] { populateCustomCollection(collection, pMap); });
-				else
-					pool.queueWorkItem([this, collection, pMap] { populateAutoCollection(collection); });
-			}
+					pool.run([this, collection, pMap] { populateCustomCollection(collection, pMap); });
 
 			pool.wait();
 		}
 	}
+	else
+	{
+		std::vector<CollectionSystemData*> autoCollections;
+		for (auto it = colSystemData->begin(); it != colSystemData->end(); it++)
+			if (it->second.isEnabled && !it->second.isPopulated && !it->second.decl.isCustom)
+				autoCollections.push_back(&(it->second));
+
+		populateAutoCollections(autoCollections);
+	}
 
 	// add auto enabled ones
 	for (auto it = colSystemData->begin(); it != colSystemData->end(); it++)
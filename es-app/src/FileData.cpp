@@ -23,11 +23,14 @@
 #include "ApiSystem.h"
 #include <time.h>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include "LangParser.h"
 #include "resources/ResourceManager.h"
 #include "RetroAchievements.h"
 #include "SaveStateRepository.h"
 #include "Genres.h"
+#include "HashCache.h"
 #include "TextToSpeech.h"
 #include "LocaleES.h"
 #include "guis/GuiMsgBox.h"
@@ -963,75 +966,151 @@ const std::string& CollectionFileData::getName()
 	return mSourceFileData->getName();
 }
 
-const std::vector<FileData*> FolderData::getChildrenListToDisplay() 
+// Settings and filters the list of displayed children depends on
+struct DisplayListContext
 {
-	std::vector<FileData*> ret;
+	std::string showFoldersMode;
+	bool showHiddenFiles;
+	bool filterKidGame;
+	std::shared_ptr<const std::vector<std::string>> hiddenExts; // Snapshot : compared by address
+	SystemData* viewSystem;
+	FileFilterIndex* filterIndex;
+	unsigned int filterVersion;
+	unsigned int sortId;
+	bool foldersFirst;
+	bool favoritesFirst;
+	bool ignoreLeadingArticles;
 
-	std::string showFoldersMode = getSystem()->getFolderViewMode();
-	
-	bool showHiddenFiles = Settings::ShowHiddenFiles();
+	bool operator==(const DisplayListContext& other) const
+	{
+		return showFoldersMode == other.showFoldersMode && showHiddenFiles == other.showHiddenFiles && filterKidGame == other.filterKidGame && hiddenExts == other.hiddenExts &&
+			viewSystem == other.viewSystem && filterIndex == other.filterIndex && filterVersion == other.filterVersion && sortId == other.sortId &&
+			foldersFirst == other.foldersFirst && favoritesFirst == other.favoritesFirst && ignoreLeadingArticles == other.ignoreLeadingArticles;
+	}
+
+	// In the other modes, the list depends on the content of the sub folders, or on relevance scores
+	bool isIncremental() const
+	{
+		return showFoldersMode != "never" && showFoldersMode != "having multiple games" && (filterIndex == nullptr || !filterIndex->hasRelevency());
+	}
+
+	// Returns the relevance of the file if a filter is active, 1 if it's displayed without filter, 0 if it's not displayed
+	int getScore(FileData* file) const
+	{
+		if (!showHiddenFiles && file->getHidden())
+			return 0;
+
+		if (filterKidGame && file->getType() == GAME && !file->getKidGame())
+			return 0;
+
+		if (hiddenExts != nullptr && hiddenExts->size() > 0 && file->getType() == GAME)
+		{
+			std::string extlow = Utils::String::toLower(Utils::FileSystem::getExtension(file->getFileName(), false));
+			if (std::find(hiddenExts->cbegin(), hiddenExts->cend(), extlow) != hiddenExts->cend())
+				return 0;
+		}
+
+		if (filterIndex != nullptr)
+			return filterIndex->showFile(file);
+
+		return 1;
+	}
+};
+
+struct DisplayListCache
+{
+	DisplayListContext context;
+	unsigned int metadataVersion;
+	unsigned int treeVersion;
+	std::vector<FileData*> files;
+};
+
+// Incremented when children are added or removed in any folder, for the lists built from sub folders
+static std::atomic<unsigned int> sTreeVersion(0);
+
+unsigned int FolderData::getTreeVersion()
+{
+	return sTreeVersion;
+}
+
+void FolderData::getDisplayListContext(DisplayListContext& context)
+{
+	context.showFoldersMode = getSystem()->getFolderViewMode();
+	context.showHiddenFiles = Settings::ShowHiddenFiles();
 
-	auto shv = Settings::getInstance()->getString(getSystem()->getName() + ".ShowHiddenFiles");
-	if (shv == "1") showHiddenFiles = true;
-	else if (shv == "0") showHiddenFiles = false;
+	int shv = getSystem()->getShowHiddenFilesOverride();
+	if (shv == 1) context.showHiddenFiles = true;
+	else if (shv == 0) context.showHiddenFiles = false;
 
-	bool filterKidGame = false;
+	context.filterKidGame = false;
 
-	if (!Settings::getInstance()->getBool("ForceDisableFilters"))
+	if (!Settings::ForceDisableFilters())
 	{
 		if (UIModeController::getInstance()->isUIModeKiosk())
-			showHiddenFiles = false;
+			context.showHiddenFiles = false;
 
 		if (UIModeController::getInstance()->isUIModeKid())
-			filterKidGame = true;
+			context.filterKidGame = true;
 	}
 
-	auto sys = CollectionSystemManager::get()->getSystemToView(mSystem);
+	context.viewSystem = CollectionSystemManager::get()->getSystemToView(mSystem);
 
-	std::vector<std::string> hiddenExts;
 	if (mSystem->isGameSystem() && !mSystem->isCollection())
-		hiddenExts = Utils::String::split(Utils::String::toLower(Settings::getInstance()->getString(mSystem->getName() + ".HiddenExt")), ';');
+		context.hiddenExts = mSystem->getHiddenExtensions();
+
+	context.filterIndex = context.viewSystem->getIndex(false);
+	if (context.filterIndex != nullptr && !context.filterIndex->isFiltered())
+		context.filterIndex = nullptr;
+
+	context.filterVersion = context.filterIndex == nullptr ? 0 : context.filterIndex->getVersion();
+
+	context.sortId = context.viewSystem->getSortId();
+	if (context.sortId > FileSorts::getSortTypes().size())
+		context.sortId = 0;
+
+	context.foldersFirst = Settings::ShowFoldersFirst();
+	context.favoritesFirst = getSystem()->getShowFavoritesFirst();
+	context.ignoreLeadingArticles = Settings::IgnoreLeadingArticles();
+}
+
+const std::vector<FileData*> FolderData::getChildrenListToDisplay() 
+{
+	DisplayListContext context;
+	getDisplayListContext(context);
+
+	// Read before building the list : a change made meanwhile makes it outdated
+	unsigned int metadataVersion = MetaDataList::getChangeCount();
+	unsigned int treeVersion = sTreeVersion;
+
+	if (mDisplayCache != nullptr && mDisplayCache->context == context && mDisplayCache->metadataVersion == metadataVersion && (context.isIncremental() || mDisplayCache->treeVersion == treeVersion))
+		return mDisplayCache->files;
+
+	std::vector<FileData*> ret;
 
-	FileFilterIndex* idx = sys->getIndex(false);
-	if (idx != nullptr && !idx->isFiltered())
-		idx = nullptr;
+	auto sys = context.viewSystem;
+	FileFilterIndex* idx = context.filterIndex;
 
   	std::vector<FileData*>* items = &mChildren;
 	
 	std::vector<FileData*> flatGameList;
-	if (showFoldersMode == "never")
+	if (context.showFoldersMode == "never")
 	{
 		flatGameList = getFlatGameList(false, sys);
 		items = &flatGameList;		
 	}
 
-	std::map<FileData*, int> scoringBoard;
+	std::unordered_map<FileData*, int> scoringBoard;
 
-	bool refactorUniqueGameFolders = (showFoldersMode == "having multiple games");
+	bool refactorUniqueGameFolders = (context.showFoldersMode == "having multiple games");
 
 	for (auto it = items->cbegin(); it != items->cend(); it++)
 	{
-		if (!showHiddenFiles && (*it)->getHidden())
+		int score = context.getScore(*it);
+		if (score == 0)
 			continue;
 
-		if (filterKidGame && (*it)->getType() == GAME && !(*it)->getKidGame())
-			continue;
-
-		if (hiddenExts.size() > 0 && (*it)->getType() == GAME)
-		{
-			std::string extlow = Utils::String::toLower(Utils::FileSystem::getExtension((*it)->getFileName(), false));
-			if (std::find(hiddenExts.cbegin(), hiddenExts.cend(), extlow) != hiddenExts.cend())
-				continue;
-		}
-
 		if (idx != nullptr)
-		{
-			int score = idx->showFile(*it);
-			if (score == 0)
-				continue;
-
 			scoringBoard[*it] = score;
-		}
 
 		if ((*it)->getType() == FOLDER && refactorUniqueGameFolders)
 		{
@@ -1051,12 +1130,16 @@ const std::vector<FileData*> FolderData::getChildrenListToDisplay()
 				if (idx != nullptr && !idx->showFile(fd))
 					continue;
 
-				if (!showHiddenFiles && fd->getHidden())
+				if (!context.showHiddenFiles && fd->getHidden())
 					continue;
 
-				if (filterKidGame && !fd->getKidGame())
+				if (context.filterKidGame && !fd->getKidGame())
 					continue;
 
+				// The game is displayed instead of its folder, with the relevance of the folder
+				if (idx != nullptr)
+					scoringBoard[fd] = scoringBoard[*it];
+
 				ret.push_back(fd);
 
 				continue;
@@ -1066,45 +1149,108 @@ const std::vector<FileData*> FolderData::getChildrenListToDisplay()
 		ret.push_back(*it);
 	}
 
-	unsigned int currentSortId = sys->getSortId();
-	if (currentSortId > FileSorts::getSortTypes().size())
-		currentSortId = 0;
-
-	const FileSorts::SortType& sort = FileSorts::getSortTypes().at(currentSortId);
+	const FileSorts::SortType& sort = FileSorts::getSortTypes().at(context.sortId);
 
 	if (idx != nullptr && idx->hasRelevency())
-	{
-		auto compf = sort.comparisonFunction;
+		FileSorts::sortFiles(ret, sort, false, false, &scoringBoard);
+	else
+		FileSorts::sortFiles(ret, sort, context.foldersFirst, context.favoritesFirst);
 
-		std::sort(ret.begin(), ret.end(), [scoringBoard, compf](const FileData* file1, const FileData* file2) -> bool
-		{ 
-			auto s1 = scoringBoard.find((FileData*) file1);
-			auto s2 = scoringBoard.find((FileData*) file2);		
+	if (mDisplayCache == nullptr)
+		mDisplayCache = new DisplayListCache();
 
-			if (s1 != scoringBoard.cend() && s2 != scoringBoard.cend() && s1->second != s2->second)
-				return s1->second < s2->second;
-			
-			return compf(file1, file2);
-		});
+	mDisplayCache->context = context;
+	mDisplayCache->metadataVersion = metadataVersion;
+	mDisplayCache->treeVersion = treeVersion;
+	mDisplayCache->files = ret;
+
+	return ret;
+}
+
+void FolderData::onChildrenChanged(FileData* file, bool added)
+{
+	sTreeVersion++;
+
+	// Virtual folders only show games of other systems
+	if (mOwnsChildrens && getSystem() != nullptr)
+		getSystem()->onGamesChanged();
+
+	updatePathIndexes(file, added);
+	updateDisplayCache(file, added);
+}
+
+// Adds or removes a child in the cached list of displayed children, when it doesn't need to be rebuilt
+void FolderData::updateDisplayCache(FileData* file, bool added)
+{
+	if (mDisplayCache == nullptr)
+		return;
+
+	DisplayListContext context;
+	getDisplayListContext(context);
+
+	if (!context.isIncremental() || !(mDisplayCache->context == context) || mDisplayCache->metadataVersion != MetaDataList::getChangeCount())
+	{
+		resetDisplayCache();
+		return;
 	}
-	else
+
+	auto& files = mDisplayCache->files;
+
+	if (!added)
 	{
-		bool foldersFirst = Settings::ShowFoldersFirst();
-		bool favoritesFirst = getSystem()->getShowFavoritesFirst();
+		auto it = std::find(files.begin(), files.end(), file);
+		if (it != files.end())
+			files.erase(it);
 
-		std::sort(ret.begin(), ret.end(), [sort, foldersFirst, favoritesFirst](const FileData* file1, const FileData* file2) -> bool
-			{
-				if (favoritesFirst && file1->getFavorite() != file2->getFavorite())
-					return file1->getFavorite();
+		return;
+	}
+
+	if (context.getScore(file) != 0)
+		FileSorts::insertFile(files, file, FileSorts::getSortTypes().at(context.sortId), context.foldersFirst, context.favoritesFirst);
+}
+
+// Called when the metadata of a child changed : moves it to its new position in the cached list, or removes it if it's no longer displayed
+void FolderData::refreshDisplayedChild(FileData* file)
+{
+	if (mDisplayCache == nullptr)
+		return;
 
-				if (foldersFirst && file1->getType() != file2->getType())
-					return (file1->getType() == FOLDER);
+	// Only the change of this file can be applied : if other values changed since the list was made, it's made again
+	unsigned int changeCount = MetaDataList::getChangeCount();
+	if (mDisplayCache->metadataVersion + 1 != changeCount)
+	{
+		resetDisplayCache();
+		return;
+	}
+
+	DisplayListContext context;
+	getDisplayListContext(context);
 
-				return sort.comparisonFunction(file1, file2) == sort.ascending;
-			});
+	if (!context.isIncremental() || !(mDisplayCache->context == context))
+	{
+		resetDisplayCache();
+		return;
 	}
 
-	return ret;
+	auto& files = mDisplayCache->files;
+
+	auto it = std::find(files.begin(), files.end(), file);
+	if (it != files.end())
+		files.erase(it);
+
+	if (context.getScore(file) != 0)
+		FileSorts::insertFile(files, file, FileSorts::getSortTypes().at(context.sortId), context.foldersFirst, context.favoritesFirst);
+
+	mDisplayCache->metadataVersion = changeCount;
+}
+
+void FolderData::resetDisplayCache()
+{
+	if (mDisplayCache != nullptr)
+	{
+		delete mDisplayCache;
+		mDisplayCache = nullptr;
+	}
 }
 
 std::shared_ptr<std::vector<FileData*>> FolderData::findChildrenListToDisplayAtCursor(FileData* toFind, std::stack<FileData*>& stack)
@@ -1148,9 +1294,9 @@ FileData* FolderData::findUniqueGameForFolder()
 		{
 			bool showHiddenFiles = Settings::ShowHiddenFiles() && !UIModeController::getInstance()->isUIModeKiosk();
 
-			auto shv = Settings::getInstance()->getString(getSystem()->getName() + ".ShowHiddenFiles");
-			if (shv == "1") showHiddenFiles = true;
-			else if (shv == "0") showHiddenFiles = false;
+			int shv = getSystem()->getShowHiddenFilesOverride();
+			if (shv == 1) showHiddenFiles = true;
+			else if (shv == 0) showHiddenFiles = false;
 
 			if (!showHiddenFiles)
 				continue;
@@ -1249,15 +1395,15 @@ std::vector<FileData*> FolderData::getFilesRecursive(unsigned int typeMask, bool
 	GetFileContext ctx;
 	ctx.showHiddenFiles = Settings::ShowHiddenFiles() && !UIModeController::getInstance()->isUIModeKiosk();
 
-	auto shv = Settings::getInstance()->getString(getSystem()->getName() + ".ShowHiddenFiles");
-	if (shv == "1")
+	int shv = getSystem()->getShowHiddenFilesOverride();
+	if (shv == 1)
 		ctx.showHiddenFiles = true;
-	else if (shv == "0")
+	else if (shv == 0)
 		ctx.showHiddenFiles = false;
 
 	if (pSystem->isGameSystem() && !pSystem->isCollection())
 	{
-		for (auto ext : Utils::String::split(Utils::String::toLower(Settings::getInstance()->getString(pSystem->getName() + ".HiddenExt")), ';'))
+		for (auto& ext : *pSystem->getHiddenExtensions())
 			if (ctx.hiddenExtensions.find(ext) == ctx.hiddenExtensions.cend())
 				ctx.hiddenExtensions.insert(ext);
 	}
@@ -1279,6 +1425,8 @@ void FolderData::addChild(FileData* file, bool assignParent)
 
 	if (assignParent)
 		file->setParent(this);	
+
+	onChildrenChanged(file, true);
 }
 
 void FolderData::removeChild(FileData* file)
@@ -1294,6 +1442,7 @@ void FolderData::removeChild(FileData* file)
 		{
 			file->setParent(NULL);
 			mChildren.erase(it);
+			onChildrenChanged(file, false);
 			return;
 		}
 	}
@@ -1304,19 +1453,71 @@ void FolderData::removeChild(FileData* file)
 #endif
 }
 
+// Guards the path indexes, FindByPath is also called by the http server.
+// Each tree uses the lock of its root, so systems loaded in parallel don't wait for each other.
+#define PATH_INDEX_LOCKS	16
+static std::mutex sPathIndexLocks[PATH_INDEX_LOCKS];
+
+// Path indexes currently built : until a FindByPath, adding and removing children doesn't lock
+static std::atomic<int> sPathIndexCount(0);
+
+// Topmost folder which indexes may contain the files of folder
+static FolderData* getPathIndexRoot(FolderData* folder)
+{
+	while (folder->getParent() != nullptr && !folder->getParent()->isVirtualStorage())
+		folder = folder->getParent();
+
+	return folder;
+}
+
+static std::mutex& getPathIndexLock(FolderData* folder)
+{
+	return sPathIndexLocks[((uintptr_t)getPathIndexRoot(folder) >> 4) % PATH_INDEX_LOCKS];
+}
+
 FileData* FolderData::FindByPath(const std::string& path)
 {
-	std::vector<FileData*> children = getChildren();
+	if (isVirtualStorage())
+	{
+		// Children are bound to the folders of their own system : look into them, their own index is up to date
+		for (auto child : mChildren)
+		{
+			if (child->getPath() == path)
+				return child;
+
+			if (child->getType() != FOLDER)
+				continue;
+
+			auto item = ((FolderData*)child)->FindByPath(path);
+			if (item != nullptr)
+				return item;
+		}
+
+		return nullptr;
+	}
+
+	std::vector<FolderData*> virtualFolders;
 
-	for (std::vector<FileData*>::const_iterator it = children.cbegin(); it != children.cend(); ++it)
 	{
-		if ((*it)->getPath() == path)
-			return (*it);
+		std::unique_lock<std::mutex> lock(getPathIndexLock(this));
 
-		if ((*it)->getType() != FOLDER)
-			continue;
-		
-		auto item = ((FolderData*)(*it))->FindByPath(path);
+		if (mPathIndex == nullptr)
+		{
+			mPathIndex = new std::unordered_multimap<std::string, FileData*>();
+			sPathIndexCount++;
+			buildPathIndex(this);
+		}
+
+		auto it = mPathIndex->find(path);
+		if (it != mPathIndex->cend())
+			return it->second;
+
+		virtualFolders = mPathIndexVirtualFolders;
+	}
+
+	for (auto folder : virtualFolders)
+	{
+		auto item = folder->FindByPath(path);
 		if (item != nullptr)
 			return item;
 	}
@@ -1324,6 +1525,73 @@ FileData* FolderData::FindByPath(const std::string& path)
 	return nullptr;
 }
 
+// The lock of the tree must be held
+void FolderData::buildPathIndex(FolderData* folder)
+{
+	for (auto child : folder->mChildren)
+	{
+		mPathIndex->emplace(child->getPath(), child);
+
+		if (child->getType() != FOLDER)
+			continue;
+
+		if (((FolderData*)child)->isVirtualStorage())
+			mPathIndexVirtualFolders.push_back((FolderData*)child);
+		else
+			buildPathIndex((FolderData*)child);
+	}
+}
+
+// Reflects a change of mChildren into the indexes of this folder and of its parents
+void FolderData::updatePathIndexes(FileData* file, bool added)
+{
+	if (sPathIndexCount == 0)
+		return;
+
+	std::unique_lock<std::mutex> lock(getPathIndexLock(this));
+
+	for (FolderData* folder = this; folder != nullptr && !folder->isVirtualStorage(); folder = folder->getParent())
+	{
+		if (folder->mPathIndex == nullptr)
+			continue;
+
+		// Adding or removing a whole subtree is rare : the index is rebuilt by the next FindByPath
+		if (file->getType() == FOLDER)
+		{
+			folder->resetPathIndex();
+			continue;
+		}
+
+		if (added)
+		{
+			folder->mPathIndex->emplace(file->getPath(), file);
+			continue;
+		}
+
+		auto range = folder->mPathIndex->equal_range(file->getPath());
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second == file)
+			{
+				folder->mPathIndex->erase(it);
+				break;
+			}
+		}
+	}
+}
+
+void FolderData::resetPathIndex()
+{
+	if (mPathIndex != nullptr)
+	{
+		delete mPathIndex;
+		mPathIndex = nullptr;
+		sPathIndexCount--;
+	}
+
+	mPathIndexVirtualFolders.clear();
+}
+
 void FolderData::createChildrenByFilenameMap(std::unordered_map<std::string, FileData*>& map)
 {
 	std::vector<FileData*> children = getChildren();
@@ -1500,6 +1768,12 @@ void FolderData::removeVirtualFolders()
 	}
 }
 
+// Hashes of archives differ when they are computed from their contents
+static std::string getHashCacheKind(const std::string& kind, SystemData* system)
+{
+	return system->shouldExtractHashesFromArchives() ? kind + "a" : kind;
+}
+
 void FileData::checkCrc32(bool force)
 {
 	if (getSourceFileData() != this && getSourceFileData() != nullptr)
@@ -1515,7 +1789,15 @@ void FileData::checkCrc32(bool force)
 	if (system == nullptr)
 		return;
 
-	auto crc = ApiSystem::getInstance()->getCRC32(getPath(), system->shouldExtractHashesFromArchives());
+	std::string kind = getHashCacheKind("crc32", system);
+
+	std::string crc;
+	if (force || !HashCache::get(getPath(), kind, crc))
+	{
+		crc = ApiSystem::getInstance()->getCRC32(getPath(), system->shouldExtractHashesFromArchives());
+		HashCache::set(getPath(), kind, crc);
+	}
+
 	if (!crc.empty())
 	{
 		getMetadata().set(MetaDataId::Crc32, Utils::String::toUpper(crc));
@@ -1538,7 +1820,15 @@ void FileData::checkMd5(bool force)
 	if (system == nullptr)
 		return;
 
-	auto crc = ApiSystem::getInstance()->getMD5(getPath(), system->shouldExtractHashesFromArchives());
+	std::string kind = getHashCacheKind("md5", system);
+
+	std::string crc;
+	if (force || !HashCache::get(getPath(), kind, crc))
+	{
+		crc = ApiSystem::getInstance()->getMD5(getPath(), system->shouldExtractHashesFromArchives());
+		HashCache::set(getPath(), kind, crc);
+	}
+
 	if (!crc.empty())
 	{
 		getMetadata().set(MetaDataId::Md5, Utils::String::toUpper(crc));
@@ -1562,11 +1852,65 @@ void FileData::checkCheevosHash(bool force)
 	if (system == nullptr)
 		return;
 
-	auto crc = RetroAchievements::getCheevosHash(system, getPath());
+	std::string kind = getHashCacheKind("cheevos:" + system->getName(), system);
+
+	std::string crc;
+	if (force || !HashCache::get(getPath(), kind, crc))
+	{
+		crc = RetroAchievements::getCheevosHash(system, getPath());
+		HashCache::set(getPath(), kind, crc);
+	}
+
 	getMetadata().set(MetaDataId::CheevosHash, Utils::String::toUpper(crc));
 	saveToGamelistRecovery(this);
 }
 
+void FileData::checkHashes(bool crc32, bool cheevosHash, bool force)
+{
+	if (getSourceFileData() != this && getSourceFileData() != nullptr)
+	{
+		getSourceFileData()->checkHashes(crc32, cheevosHash, force);
+		return;
+	}
+
+	SystemData* system = getSystem();
+	if (system == nullptr)
+		return;
+
+	bool needCrc32 = crc32 && (force || getMetadata(MetaDataId::Crc32).empty());
+	bool needCheevosHash = cheevosHash && (force || getMetadata(MetaDataId::CheevosHash).empty());
+
+	// When the cheevos hash is the md5 of the file, both digests are computed from a single read of the rom
+	if (needCrc32 && needCheevosHash && RetroAchievements::isFileMd5Hash(system))
+	{
+		std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(getPath()));
+		bool fromArchive = system->shouldExtractHashesFromArchives() && (ext == ".zip" || ext == ".7z");
+
+		std::string crc32Kind = getHashCacheKind("crc32", system);
+		std::string cheevosKind = getHashCacheKind("cheevos:" + system->getName(), system);
+
+		std::string crc, md5;
+		if (!fromArchive && (force || (!HashCache::get(getPath(), crc32Kind, crc) && !HashCache::get(getPath(), cheevosKind, md5))) &&
+			Utils::FileSystem::getFileHashes(getPath(), &crc, &md5))
+		{
+			HashCache::set(getPath(), crc32Kind, crc);
+			HashCache::set(getPath(), cheevosKind, md5);
+
+			// A forced check would bypass the cache and read the rom again
+			getMetadata().set(MetaDataId::Crc32, Utils::String::toUpper(crc));
+			getMetadata().set(MetaDataId::CheevosHash, Utils::String::toUpper(md5));
+			saveToGamelistRecovery(this);
+			return;
+		}
+	}
+
+	if (crc32)
+		checkCrc32(force);
+
+	if (cheevosHash)
+		checkCheevosHash(force);
+}
+
 std::string FileData::getKeyboardMappingFilePath()
 {
 	if (Utils::FileSystem::isDirectory(getSourceFileData()->getPath()))
@@ -1694,15 +2038,25 @@ FolderData::FolderData(const std::string& startpath, SystemData* system, bool ow
 {
 	mIsDisplayableAsVirtualFolder = false;
 	mOwnsChildrens = ownsChildrens;
+	mPathIndex = nullptr;
+	mDisplayCache = nullptr;
 }
 
 FolderData::~FolderData()
 {
 	clear();
+	resetPathIndex();
+	resetDisplayCache();
 }
 
 void FolderData::clear()
 {
+	// Not updated one child at a time
+	resetDisplayCache();
+
+	// Before the children are deleted : the lists streamed by the http server stop on it
+	sTreeVersion++;
+
 	if (mOwnsChildrens)
 	{
 		for (int i = mChildren.size() - 1; i >= 0; i--)
@@ -1710,6 +2064,17 @@ void FolderData::clear()
 	}
 
 	mChildren.clear();
+	sTreeVersion++;
+
+	if (mOwnsChildrens && getSystem() != nullptr)
+		getSystem()->onGamesChanged();
+
+	if (sPathIndexCount == 0)
+		return;
+
+	std::unique_lock<std::mutex> lock(getPathIndexLock(this));
+	for (FolderData* folder = this; folder != nullptr && !folder->isVirtualStorage(); folder = folder->getParent())
+		folder->resetPathIndex();
 }
 
 void FolderData::removeFromVirtualFolders(FileData* game)
@@ -1725,6 +2090,7 @@ void FolderData::removeFromVirtualFolders(FileData* game)
 		if ((*it) == game)
 		{
 			mChildren.erase(it);
+			onChildrenChanged(game, false);
 			return;
 		}
 	}
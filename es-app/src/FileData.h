@@ -70,6 +70,8 @@ struct LaunchGameOptions
 };
 
 class FolderData;
+struct DisplayListContext;
+struct DisplayListCache;
 
 // A tree node that holds information for a file.
 class FileData : public IKeyboardMapContainer, public IBindable
@@ -145,7 +147,7 @@ public:
 	virtual const MetaDataList& getMetadata() const { return mMetadata; }
 	virtual MetaDataList& getMetadata() { return mMetadata; }
 
-	void setMetadata(MetaDataList value) { getMetadata() = value; } 
+	void setMetadata(MetaDataList value) { getMetadata() = value; MetaDataList::notifyChange(); }
 	
 	std::string getMetadata(MetaDataId key) const { return getMetadata().get(key); }
 	void setMetadata(MetaDataId key, const std::string& value) { return getMetadata().set(key, value); }
@@ -157,6 +159,7 @@ public:
 	void checkCrc32(bool force = false);
 	void checkMd5(bool force = false);
 	void checkCheevosHash(bool force = false);
+	void checkHashes(bool crc32, bool cheevosHash, bool force = false);
 
 	void importP2k(const std::string& p2k);
 	std::string convertP2kFile();
@@ -241,6 +244,7 @@ public:
 
 	inline const std::vector<FileData*>& getChildren() const { return mChildren; }
 	const std::vector<FileData*> getChildrenListToDisplay();
+	void refreshDisplayedChild(FileData* file);
 	std::shared_ptr<std::vector<FileData*>> findChildrenListToDisplayAtCursor(FileData* toFind, std::stack<FileData*>& stack);
 
 	std::vector<FileData*> getFilesRecursive(unsigned int typeMask, bool displayedOnly = false, SystemData* system = nullptr, bool includeVirtualStorage = true) const;
@@ -257,13 +261,32 @@ public:
 	void removeVirtualFolders();
 	void removeFromVirtualFolders(FileData* game);
 
+	// Changes when children are added to or removed from any folder
+	static unsigned int getTreeVersion();
+
 private:
 	void getFilesRecursiveWithContext(std::vector<FileData*>& out, unsigned int typeMask, GetFileContext* filter, bool displayedOnly, SystemData* system, bool includeVirtualStorage) const;
 
+	void onChildrenChanged(FileData* file, bool added);
+
+	void buildPathIndex(FolderData* folder);
+	void updatePathIndexes(FileData* file, bool added);
+	void resetPathIndex();
+
+	void getDisplayListContext(DisplayListContext& context);
+	void updateDisplayCache(FileData* file, bool added);
+	void resetDisplayCache();
 
 	std::vector<FileData*> mChildren;
 	bool	mOwnsChildrens;
 	bool	mIsDisplayableAsVirtualFolder;
+
+	// Files of the subtree by path, built by the first FindByPath. Virtual folders are not indexed, their content is not bound to this tree.
+	std::unordered_multimap<std::string, FileData*>* mPathIndex;
+	std::vector<FolderData*> mPathIndexVirtualFolders;
+
+	// Last result of getChildrenListToDisplay, with the settings, filters and versions it was computed with
+	DisplayListCache* mDisplayCache;
 };
 
 #endif // ES_APP_FILE_DATA_H
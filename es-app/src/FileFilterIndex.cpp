@@ -8,6 +8,7 @@
 #include "LocaleES.h"
 
 #include <pugixml/src/pugixml.hpp>
+#include <algorithm>
 
 #include "SystemData.h"
 #include "FileData.h"
@@ -22,6 +23,20 @@ FileFilterIndex::FileFilterIndex()
 	: filterByFavorites(false), filterByGenre(false), filterByKidGame(false), filterByPlayers(false), filterByPubDev(false), filterByRatings(false), filterByYear(false)
 	, filterByLightGun(false), filterByWheel(false), filterByVertical(false), filterByCheevos(false), filterByPlayed(false), filterByRegion(false), filterByLang(false), filterByFamily(false), filterByHasMedia(false), filterByMissingMedia(false)
 {
+	mVersion = 0;
+	mTextScoresValid = false;
+	mTextScoresVersion = 0;
+	mTextIndexVersion = 0;
+	mIsChinese = false;
+	mGamesVersion = 0;
+	mKeyBitsGamesVersion = 0;
+	mKeyBitsChangeCount = 0;
+	mFilterBitsValid = false;
+	mFilterBitsVersion = 0;
+	mFolderResultsVersion = 0;
+	mFolderResultsGamesVersion = 0;
+	mFolderResultsChangeCount = 0;
+	mFolderResultsTreeVersion = 0;
 	clearAllFilters();
 	FilterDataDecl filterDecls[] = 
 	{
@@ -65,6 +80,15 @@ std::vector<FilterDataDecl> FileFilterIndex::getFilterDataDecls()
 	return ret;
 }
 
+FilterIndexType FileFilterIndex::getFilterType(const std::string& primaryKey)
+{
+	for (auto& it : mFilterDecl)
+		if (it.second.primaryKey == primaryKey)
+			return it.second.type;
+
+	return NONE;
+}
+
 void FileFilterIndex::copyFrom(FileFilterIndex* indexToImport)
 {
 	resetFilters();
@@ -145,6 +169,13 @@ void FileFilterIndex::resetIndex()
 	mTextFilter = "";
 	clearAllFilters();
 
+	mTextIndex.clear();
+
+	mOrdinals.clear();
+	mGames.clear();
+	mFreeOrdinals.clear();
+	mGamesVersion++;
+
 	clearIndex(genreIndexAllKeys);
 	clearIndex(familyIndexAllKeys);
 	clearIndex(playersIndexAllKeys);
@@ -412,6 +443,24 @@ void FileFilterIndex::addToIndex(FileData* game)
 	manageYearEntryInIndex(game);
 	manageLangEntryInIndex(game);
 	manageRegionEntryInIndex(game);		
+
+	mTextIndex.add(game);
+
+	if (mOrdinals.find(game) == mOrdinals.cend())
+	{
+		int ordinal = (int)mGames.size();
+		if (mFreeOrdinals.size() > 0)
+		{
+			ordinal = mFreeOrdinals.back();
+			mFreeOrdinals.pop_back();
+			mGames[ordinal] = game;
+		}
+		else
+			mGames.push_back(game);
+
+		mOrdinals[game] = ordinal;
+		mGamesVersion++;
+	}
 }
 
 void FileFilterIndex::removeFromIndex(FileData* game)
@@ -423,6 +472,17 @@ void FileFilterIndex::removeFromIndex(FileData* game)
 	manageYearEntryInIndex(game, true);
 	manageLangEntryInIndex(game, true);
 	manageRegionEntryInIndex(game, true);	
+
+	mTextIndex.remove(game);
+
+	auto it = mOrdinals.find(game);
+	if (it != mOrdinals.cend())
+	{
+		mGames[it->second] = nullptr;
+		mFreeOrdinals.push_back(it->second);
+		mOrdinals.erase(it);
+		mGamesVersion++;
+	}
 }
 
 void FileFilterIndex::setFilter(FilterIndexType type, std::vector<std::string>* values)
@@ -441,6 +501,7 @@ void FileFilterIndex::setFilter(FilterIndexType type, std::vector<std::string>*
 	FilterDataDecl& filterData = it->second;
 	*(filterData.filteredByRef) = values != nullptr && values->size() > 0;
 	filterData.currentFilteredKeys->clear();
+	mVersion++;
 
 	if (values == nullptr)
 		return;
@@ -468,6 +529,7 @@ void FileFilterIndex::clearAllFilters()
 {
 	mUseRelevency = false;
 	mTextFilter = "";
+	mVersion++;
 
 	for (auto& it : mFilterDecl)
 	{
@@ -486,7 +548,7 @@ void FileFilterIndex::resetFilters()
 
 void FileFilterIndex::setUIModeFilters()
 {
-	if (Settings::getInstance()->getBool("ForceDisableFilters"))
+	if (Settings::ForceDisableFilters())
 		return;
 	
 	if (UIModeController::getInstance()->isUIModeKid())
@@ -501,6 +563,7 @@ void FileFilterIndex::setTextFilter(const std::string text, bool useRelevancy)
 { 
 	mTextFilter = text;
 	mUseRelevency = useRelevancy;
+	mVersion++;
 }
 
 float jw_distance(std::string s1, std::string s2, bool caseSensitive = true) {
@@ -591,6 +654,22 @@ float jw_distance(std::string s1, std::string s2, bool caseSensitive = true) {
 	return weight;
 }
 
+static inline void setBit(FilterBits& bits, int ordinal)
+{
+	bits[ordinal >> 6] |= (1ULL << (ordinal & 63));
+}
+
+static inline bool testBit(const FilterBits& bits, int ordinal)
+{
+	return (size_t)(ordinal >> 6) < bits.size() && (bits[ordinal >> 6] & (1ULL << (ordinal & 63))) != 0;
+}
+
+// Filters which values can't be listed from the game : each selected value is tested
+static inline bool isPerKeyFilter(FilterIndexType type)
+{
+	return type == HASMEDIA_FILTER || type == MISSING_MEDIA_FILTER || type == PLAYER_FILTER;
+}
+
 int FileFilterIndex::showFile(FileData* game)
 {
 	// this shouldn't happen, but just in case let's get it out of the way
@@ -600,326 +679,550 @@ int FileFilterIndex::showFile(FileData* game)
 	// if folder, needs further inspection - i.e. see if folder contains at least one element
 	// that should be shown
 	if (game->getType() == FOLDER) 
-	{
-		std::vector<FileData*> children = ((FolderData*)game)->getChildren();
-		// iterate through all of the children, until there's a match
+		return showFolder((FolderData*)game);
 
-		for (std::vector<FileData*>::const_iterator it = children.cbegin(); it != children.cend(); ++it )
-			if (showFile(*it))
-				return 1;
+	bool hasFilter = false;
 
-		return 0;
+	for (auto& it : mFilterDecl)
+	{
+		if (*(it.second.filteredByRef))
+		{
+			hasFilter = true;
+			break;
+		}
 	}
 
-	bool keepGoing = false;
-	
-	int textScore = 0;
+	if (hasFilter && !matchesFilters(game))
+		return 0;
 
 	if (!mTextFilter.empty())
+		return getTextScore(game);
+
+	return hasFilter ? 1 : 0;
+}
+
+// Each folder is tested once for the current filters : sub folders are read from mFolderResults by the recursion
+int FileFilterIndex::showFolder(FolderData* folder)
+{
+	unsigned int changeCount = MetaDataList::getChangeCount();
+	unsigned int treeVersion = FolderData::getTreeVersion();
+
+	if (mFolderResultsVersion != mVersion || mFolderResultsGamesVersion != mGamesVersion || mFolderResultsChangeCount != changeCount || mFolderResultsTreeVersion != treeVersion)
 	{
-		auto name = game->getSourceFileData()->getName();
-		std::string language = SystemConf::getInstance()->get("system.language");
-		bool isChinese = (language == "zh_CN" || language == "zh_TW");
+		mFolderResults.clear();
+		mFolderResultsVersion = mVersion;
+		mFolderResultsGamesVersion = mGamesVersion;
+		mFolderResultsChangeCount = changeCount;
+		mFolderResultsTreeVersion = treeVersion;
+	}
 
-		if (!mUseRelevency)
+	auto it = mFolderResults.find(folder);
+	if (it != mFolderResults.cend())
+		return it->second;
+
+	int ret = 0;
+
+	// iterate through all of the children, until there's a match
+	for (auto child : folder->getChildren())
+	{
+		if (showFile(child))
 		{
-			if (mTextFilter.find(',') == std::string::npos)
-			{
-				if (Utils::String::containsIgnoreCase(name, mTextFilter))
-				{
-					textScore = 1;
-					keepGoing = true;
-				}
-				else if (isChinese && Utils::String::containsIgnoreCasePinyin(name, mTextFilter)) {
-					textScore = 2;
-					keepGoing = true;
-				}
-			}
-			else
-			{
-				for (auto token : Utils::String::split(mTextFilter, ',', true))
-				{
-					if (Utils::String::containsIgnoreCase(name, Utils::String::trim(token)))
-					{
-						textScore = 1;
-						keepGoing = true;
-						break;  // score=1 need break
-					}
-					else if (isChinese && Utils::String::containsIgnoreCasePinyin(name, Utils::String::trim(token)))
-					{
-						textScore = 2;
-						keepGoing = true;
-					}
-				}
-			}
+			ret = 1;
+			break;
 		}
-		else
+	}
+
+	mFolderResults[folder] = ret;
+	return ret;
+}
+
+bool FileFilterIndex::matchesFilters(FileData* game)
+{
+	auto it = mOrdinals.find(game);
+	if (it == mOrdinals.cend())
+	{
+		// Not indexed, like the games of the systems of a bundle
+		for (auto& decl : mFilterDecl)
+			if (*(decl.second.filteredByRef) && !matchesFilter(game, decl.second))
+				return false;
+
+		return true;
+	}
+
+	updateFilterBits();
+	return testBit(mFilterBits, it->second);
+}
+
+// Values of a filter type the game can be found with
+void FileFilterIndex::getFilterKeys(FileData* game, const FilterDataDecl& filterData, std::vector<std::string>& keys)
+{
+	if (filterData.type == GENRE_FILTER)
+	{
+		for (auto val : Genres::getGenreFiltersNames(&game->getMetadata()))
+			keys.push_back(val);
+
+		return;
+	}
+
+	std::string key = getIndexableKey(game, filterData.type, false);
+
+	if (filterData.type == LANG_FILTER || filterData.type == REGION_FILTER)
+	{
+		for (auto val : Utils::String::split(key, ','))
+			keys.push_back(val);
+
+		return;
+	}
+
+	keys.push_back(key);
+
+	// secondary keys - i.e. publisher and dev
+	if (filterData.hasSecondaryKey)
+	{
+		std::string secKey = getIndexableKey(game, filterData.type, true);
+		if (secKey != UNKNOWN_LABEL)
+			keys.push_back(secKey);
+	}
+}
+
+bool FileFilterIndex::matchesFilterKey(FileData* game, FilterIndexType type, const std::string& key)
+{
+	if (type == HASMEDIA_FILTER)
+	{
+		if (key == "FALSE" || key == "TRUE") // Here for Retrocompatibility
+			return game->hasAnyMedia() == (key == "TRUE");
+
+		std::string path = game->getMetadata().get(key);
+		return !path.empty() && Utils::FileSystem::exists(path);
+	}
+
+	if (type == MISSING_MEDIA_FILTER)
+	{
+		std::string path = game->getMetadata().get(key);
+		return path.empty() || !Utils::FileSystem::exists(path);
+	}
+
+	if (type == PLAYER_FILTER)
+	{
+		auto range = game->parsePlayersRange();
+
+		if (range.first <= 0 && range.second > 0)
+			return key == std::to_string(range.second);
+
+		if (range.second > 0)
 		{
-			if (Utils::String::compareIgnoreCase(name, mTextFilter) == 0)
-			{
-				keepGoing = true;
-				textScore = 1;
-			}
-			else if (Utils::String::startsWithIgnoreCase(name, mTextFilter))
-			{
-				keepGoing = true;
-				textScore = 2;
-			}
-			else if (mTextFilter.find(' ') == std::string::npos && Utils::String::containsIgnoreCase(name, mTextFilter))
-			{
-				keepGoing = true;
-				textScore = 3;
-			}
-			else if (mTextFilter.find(' ') != std::string::npos)
-			{
-				auto simplify = [](const std::string& text)
-				{
-					auto s = Utils::String::toLower(text);
-					s = Utils::String::replace(s, ":", "");
-					s = Utils::String::replace(s, ".", "");
-					s = Utils::String::replace(s, " - ", " ");
-					s = Utils::String::replace(s, "- ", " ");				
+			int val = Utils::String::toInteger(key);
+			return range.first <= val && val <= range.second;
+		}
+	}
 
-					std::vector<std::string> ret;
+	return false;
+}
 
-					for (auto v : Utils::String::split(s, ' '))
-					{
-						if (v.empty() || v.length() <= 2 || v == "and" || v == "not" || v == "for" || v == "the" || v == "les" || v == "des")
-							continue;
+bool FileFilterIndex::matchesFilter(FileData* game, const FilterDataDecl& filterData)
+{
+	auto filteredKeys = filterData.currentFilteredKeys;
 
-						ret.push_back(v);
-					}
+	if (isPerKeyFilter(filterData.type))
+	{
+		for (auto& key : *filteredKeys)
+			if (matchesFilterKey(game, filterData.type, key))
+				return true;
 
-					return ret;
-				};
+		return false;
+	}
 
-				auto filters = simplify(mTextFilter);
-				auto words = simplify(name);
+	std::vector<std::string> keys;
+	getFilterKeys(game, filterData, keys);
 
-				int totalWords = 0;
-				int commonWords = 0;
-				
-				for (int i = 0; i < filters.size(); i++)
-				{
-					auto filter = filters[i];
+	for (auto& key : keys)
+		if (filteredKeys->find(key) != filteredKeys->cend())
+			return true;
 
-					for (auto word : words)
-					{
-						if (word == filter)
-						{
-							commonWords++;
-							break;
-						}
-					}
+	return false;
+}
 
-					totalWords++;
-				}
-				
-				int continuousWords = 0;
-				int maxContinuousWords = 0;
-				int wordsAtStart = 0;
-				bool countStart = true;
+// Indexed games having a filter value
+const FilterBits& FileFilterIndex::getKeyBits(const FilterDataDecl& filterData, const std::string& key)
+{
+	static const FilterBits empty;
 
-				for (int j = 0 ; j < words.size(); j++)
-				{
-					auto word = words[j];
+	size_t words = (mGames.size() + 63) / 64;
+	auto& typeBits = mKeyBits[filterData.type];
 
-					for (int i = 0; i < filters.size(); i++)
-					{
-						auto filter = filters[i];
+	if (isPerKeyFilter(filterData.type))
+	{
+		auto it = typeBits.find(key);
+		if (it != typeBits.cend())
+			return it->second;
 
-						if (word == filter)
-						{
-							if (countStart && i == j)
-								wordsAtStart++;
-							else
-								countStart = false;
+		FilterBits& bits = typeBits[key];
+		bits.resize(words);
 
-							continuousWords++;
+		for (int i = 0; i < (int)mGames.size(); i++)
+			if (mGames[i] != nullptr && matchesFilterKey(mGames[i], filterData.type, key))
+				setBit(bits, i);
 
-							if (maxContinuousWords < continuousWords)
-								maxContinuousWords = continuousWords;
+		return bits;
+	}
 
-							j++;
+	// Every value of the type is collected with a single pass on the games
+	if (mKeyBitsTypes.insert(filterData.type).second)
+	{
+		std::vector<std::string> keys;
 
-							if (j < words.size())
-								word = words[j];
-							else
-								break;
+		for (int i = 0; i < (int)mGames.size(); i++)
+		{
+			if (mGames[i] == nullptr)
+				continue;
 
-							continue;
-						}
-						else
-							countStart = false;
+			keys.clear();
+			getFilterKeys(mGames[i], filterData, keys);
 
-						continuousWords = 0;
-					}					
-				}
-				
-				if (commonWords > 0)
-				{
-					if (commonWords > 1 || (commonWords > 0 && filters.size() == 1))
-					{
-						int sc = ((wordsAtStart * 2) + (maxContinuousWords * 3) + commonWords);
-						textScore = 1000 - sc;
-						keepGoing = true;
-					}
-					else
-					{
-						auto dist = jw_distance(mTextFilter, name, false);
-						if (dist > 0.66)
-						{
-							textScore = 1500 - (500 * dist);
-							keepGoing = true;
-						}
-					}
-				}
+			for (auto& k : keys)
+			{
+				FilterBits& bits = typeBits[k];
+				if (bits.size() != words)
+					bits.resize(words);
+
+				setBit(bits, i);
 			}
 		}
 	}
 
-	bool hasFilter = false;
+	auto it = typeBits.find(key);
+	return it == typeBits.cend() ? empty : it->second;
+}
+
+// Drops the bitsets when games or metadata have changed, returns true if they were
+bool FileFilterIndex::checkKeyBits()
+{
+	unsigned int changeCount = MetaDataList::getChangeCount();
+	if (mKeyBitsGamesVersion == mGamesVersion && mKeyBitsChangeCount == changeCount)
+		return false;
+
+	mKeyBits.clear();
+	mKeyBitsTypes.clear();
+	mKeyBitsGamesVersion = mGamesVersion;
+	mKeyBitsChangeCount = changeCount;
+	mFilterBitsValid = false;
+	return true;
+}
+
+// Active filters are combined with bitwise operations : OR on the values of a type, AND between the types
+void FileFilterIndex::updateFilterBits()
+{
+	checkKeyBits();
+
+	if (mFilterBitsValid && mFilterBitsVersion == mVersion)
+		return;
+
+	size_t words = (mGames.size() + 63) / 64;
+	mFilterBits.assign(words, ~0ULL);
+
+	FilterBits typeBits;
 
 	for (auto& it : mFilterDecl)
 	{
 		FilterDataDecl& filterData = it.second;
 		if (!(*(filterData.filteredByRef)))
 			continue;
-		
-		hasFilter = true;
 
-		bool filterValid = false;
+		typeBits.assign(words, 0);
 
-		if (filterData.type == HASMEDIA_FILTER)
+		for (auto& key : *filterData.currentFilteredKeys)
 		{
-			auto it = mFilterDecl.find(HASMEDIA_FILTER);
-			if (it == mFilterDecl.cend())
-				break;
+			const FilterBits& bits = getKeyBits(filterData, key);
+			for (size_t w = 0; w < bits.size() && w < words; w++)
+				typeBits[w] |= bits[w];
+		}
 
-			auto keys = it->second.currentFilteredKeys;
-			if (keys == nullptr)
-				break;
+		for (size_t w = 0; w < words; w++)
+			mFilterBits[w] &= typeBits[w];
+	}
 
-			for (auto it : *keys)			
-			{
-				if (it == "FALSE" || it == "TRUE") // Here for Retrocompatibility
-				{
-					if (game->hasAnyMedia() == (it == "TRUE"))
-					{
-						filterValid = true;
-						break;
-					}
-				}				
-				else 
-				{
-					std::string path = game->getMetadata().get(it);
-					if (!path.empty() && Utils::FileSystem::exists(path))
-					{
-						filterValid = true;
-						break;
-					}
-				}
+	mFilterBitsValid = true;
+	mFilterBitsVersion = mVersion;
+}
 
-			}
+void FileFilterIndex::findGames(const std::map<FilterIndexType, std::vector<std::string>>& filters, const std::vector<std::string>& texts, std::vector<FileData*>& games)
+{
+	checkKeyBits();
+
+	size_t words = (mGames.size() + 63) / 64;
+
+	FilterBits found(words, ~0ULL);
+	FilterBits typeBits;
+
+	for (auto& filter : filters)
+	{
+		auto decl = mFilterDecl.find(filter.first);
+		if (decl == mFilterDecl.cend())
+			continue;
+
+		typeBits.assign(words, 0);
+
+		for (auto& key : filter.second)
+		{
+			const FilterBits& bits = getKeyBits(decl->second, key);
+			for (size_t w = 0; w < bits.size() && w < words; w++)
+				typeBits[w] |= bits[w];
 		}
-		else if (filterData.type == MISSING_MEDIA_FILTER)
+
+		for (size_t w = 0; w < words; w++)
+			found[w] &= typeBits[w];
+	}
+
+	if (texts.empty())
+	{
+		for (size_t w = 0; w < words; w++)
 		{
-			auto it = mFilterDecl.find(MISSING_MEDIA_FILTER);
-			if (it == mFilterDecl.cend())
-				break;
+			if (found[w] == 0)
+				continue;
+
+			for (int i = (int)(w * 64); i < (int)mGames.size() && i < (int)(w * 64 + 64); i++)
+				if (mGames[i] != nullptr && testBit(found, i))
+					games.push_back(mGames[i]);
+		}
+
+		return;
+	}
+
+	// Only the games having the characters of a text are compared
+	std::vector<FileData*> candidates;
+	mTextIndex.findCandidates(texts, candidates);
+
+	std::vector<int> ordinals;
+
+	for (auto file : candidates)
+	{
+		auto it = mOrdinals.find(file);
+		if (it == mOrdinals.cend() || !testBit(found, it->second))
+			continue;
+
+		std::string name = file->getSourceFileData()->getName();
 
-			auto keys = it->second.currentFilteredKeys;
-			if (keys == nullptr)
+		for (auto& text : texts)
+		{
+			if (Utils::String::containsIgnoreCase(name, text))
+			{
+				ordinals.push_back(it->second);
 				break;
+			}
+		}
+	}
 
-			for (auto it : *keys)
+	std::sort(ordinals.begin(), ordinals.end());
+
+	for (auto ordinal : ordinals)
+		games.push_back(mGames[ordinal]);
+}
+
+int FileFilterIndex::getTextScore(const std::string& name, bool isChinese)
+{
+	int textScore = 0;
+
+	if (!mUseRelevency)
+	{
+		if (mTextFilter.find(',') == std::string::npos)
+		{
+			if (Utils::String::containsIgnoreCase(name, mTextFilter))
 			{
-				std::string path = game->getMetadata().get(it);
-				if (path.empty() || !Utils::FileSystem::exists(path))
-				{
-					filterValid = true;
-					break;
-				}
+				textScore = 1;
+			}
+			else if (isChinese && Utils::String::containsIgnoreCasePinyin(name, mTextFilter)) {
+				textScore = 2;
 			}
 		}
-		else if (filterData.type == GENRE_FILTER)
+		else
 		{
-			for (auto val : Genres::getGenreFiltersNames(&game->getMetadata()))
+			for (auto token : Utils::String::split(mTextFilter, ',', true))
 			{
-				if (isKeyBeingFilteredBy(val, filterData.type))
+				if (Utils::String::containsIgnoreCase(name, Utils::String::trim(token)))
 				{
-					filterValid = true;
-					break;
+					textScore = 1;
+					break;  // score=1 need break
+				}
+				else if (isChinese && Utils::String::containsIgnoreCasePinyin(name, Utils::String::trim(token)))
+				{
+					textScore = 2;
 				}
 			}
 		}
-		else if (filterData.type == PLAYER_FILTER)
+	}
+	else
+	{
+		if (Utils::String::compareIgnoreCase(name, mTextFilter) == 0)
+		{
+			textScore = 1;
+		}
+		else if (Utils::String::startsWithIgnoreCase(name, mTextFilter))
+		{
+			textScore = 2;
+		}
+		else if (mTextFilter.find(' ') == std::string::npos && Utils::String::containsIgnoreCase(name, mTextFilter))
+		{
+			textScore = 3;
+		}
+		else if (mTextFilter.find(' ') != std::string::npos)
 		{
-			auto range = game->parsePlayersRange();
+			auto simplify = [](const std::string& text)
+			{
+				auto s = Utils::String::toLower(text);
+				s = Utils::String::replace(s, ":", "");
+				s = Utils::String::replace(s, ".", "");
+				s = Utils::String::replace(s, " - ", " ");
+				s = Utils::String::replace(s, "- ", " ");				
+
+				std::vector<std::string> ret;
 
-			if (range.first <= 0 && range.second > 0)
-				filterValid = isKeyBeingFilteredBy(std::to_string(range.second), filterData.type);
-			else if (range.second > 0)
+				for (auto v : Utils::String::split(s, ' '))
+				{
+					if (v.empty() || v.length() <= 2 || v == "and" || v == "not" || v == "for" || v == "the" || v == "les" || v == "des")
+						continue;
+
+					ret.push_back(v);
+				}
+
+				return ret;
+			};
+
+			auto filters = simplify(mTextFilter);
+			auto words = simplify(name);
+
+			int totalWords = 0;
+			int commonWords = 0;
+			
+			for (int i = 0; i < filters.size(); i++)
 			{
-				auto it = mFilterDecl.find(PLAYER_FILTER);
-				if (it != mFilterDecl.cend())
+				auto filter = filters[i];
+
+				for (auto word : words)
 				{
-					auto fltKeys = it->second.currentFilteredKeys;					
-					if (fltKeys != nullptr)
+					if (word == filter)
 					{
-						for (auto flt : *fltKeys)
-						{
-							int val = Utils::String::toInteger(flt);
-							if (range.first <= val && val <= range.second)
-							{
-								filterValid = true;
-								break;
-							}
-						}
+						commonWords++;
+						break;
 					}
 				}
-			}			
-		}
-		else
-		{
-			// try to find a match
-			std::string key = getIndexableKey(game, filterData.type, false);
 
-			if (filterData.type == LANG_FILTER || filterData.type == REGION_FILTER)
-			{
-				for (auto val : Utils::String::split(key, ','))
-					if (isKeyBeingFilteredBy(val, filterData.type))
-						filterValid = true;
+				totalWords++;
 			}
-			else
-				filterValid = isKeyBeingFilteredBy(key, filterData.type);
+			
+			int continuousWords = 0;
+			int maxContinuousWords = 0;
+			int wordsAtStart = 0;
+			bool countStart = true;
 
-			// if we didn't find a match, try for secondary keys - i.e. publisher and dev, or first genre
-			if (!filterValid)
+			for (int j = 0 ; j < words.size(); j++)
 			{
-				if (!filterData.hasSecondaryKey)
-					return 0;
+				auto word = words[j];
+
+				for (int i = 0; i < filters.size(); i++)
+				{
+					auto filter = filters[i];
+
+					if (word == filter)
+					{
+						if (countStart && i == j)
+							wordsAtStart++;
+						else
+							countStart = false;
+
+						continuousWords++;
+
+						if (maxContinuousWords < continuousWords)
+							maxContinuousWords = continuousWords;
+
+						j++;
+
+						if (j < words.size())
+							word = words[j];
+						else
+							break;
+
+						continue;
+					}
+					else
+						countStart = false;
 
-				std::string secKey = getIndexableKey(game, filterData.type, true);
-				if (secKey != UNKNOWN_LABEL)
-					filterValid = isKeyBeingFilteredBy(secKey, filterData.type);
+					continuousWords = 0;
+				}					
+			}
+			
+			if (commonWords > 0)
+			{
+				if (commonWords > 1 || (commonWords > 0 && filters.size() == 1))
+				{
+					int sc = ((wordsAtStart * 2) + (maxContinuousWords * 3) + commonWords);
+					textScore = 1000 - sc;
+				}
+				else
+				{
+					auto dist = jw_distance(mTextFilter, name, false);
+					if (dist > 0.66)
+					{
+						textScore = 1500 - (500 * dist);
+					}
+				}
 			}
 		}
+	}
 
-		// if still nothing, then it's not a match
-		if (!filterValid)
-			return 0;		
+	return textScore;
+}
+
+// Text filter score of the game, 0 if its name doesn't match
+int FileFilterIndex::getTextScore(FileData* game)
+{
+	updateTextScores();
 
-		keepGoing = true;
+	// Files which were not added to this index, like the games of the systems of a bundle
+	if (!mTextIndex.contains(game))
+		return getTextScore(game->getSourceFileData()->getName(), mIsChinese);
+
+	auto it = mTextScores.find(game);
+	return it == mTextScores.cend() ? 0 : it->second;
+}
+
+// Scores the indexed games once per text filter, instead of at every showFile. Only the games which name contains the text are tested when possible.
+void FileFilterIndex::updateTextScores()
+{
+	unsigned int indexVersion = mTextIndex.getVersion();
+	if (mTextScoresValid && mTextScoresVersion == mVersion && mTextIndexVersion == indexVersion)
+		return;
+
+	std::string language = SystemConf::getInstance()->get("system.language");
+	mIsChinese = (language == "zh_CN" || language == "zh_TW");
+
+	mTextScores.clear();
+
+	std::vector<FileData*> candidates;
+
+	// Pinyin matches and word matches can't be found from the characters of the name
+	if (mIsChinese || (mUseRelevency && mTextFilter.find(' ') != std::string::npos))
+		mTextIndex.getFiles(candidates);
+	else if (mUseRelevency || mTextFilter.find(',') == std::string::npos)
+		mTextIndex.findCandidates({ mTextFilter }, candidates);
+	else
+	{
+		std::vector<std::string> texts;
+		for (auto token : Utils::String::split(mTextFilter, ',', true))
+			texts.push_back(Utils::String::trim(token));
+
+		mTextIndex.findCandidates(texts, candidates);
 	}
 
-	if (keepGoing && !mTextFilter.empty())
-		return textScore;
-	
-	if (mTextFilter.empty() && !hasFilter)
-		return 0;
-	
-	return keepGoing ? 1 : 0;
+	for (auto file : candidates)
+	{
+		int score = getTextScore(file->getSourceFileData()->getName(), mIsChinese);
+		if (score != 0)
+			mTextScores[file] = score;
+	}
+
+	mTextScoresValid = true;
+	mTextScoresVersion = mVersion;
+	mTextIndexVersion = mTextIndex.getVersion();
 }
 
 bool FileFilterIndex::isKeyBeingFilteredBy(std::string key, FilterIndexType type)
@@ -1127,7 +1430,10 @@ bool CollectionFilter::load(const std::string file)
 		if (name == "system")
 			mSystemFilter.insert(node.text().as_string());
 		else if (name == "text")
+		{
 			mTextFilter = node.text().as_string();
+			mVersion++;
+		}
 		else if (name == "genre")
 		{
 			auto genre = Genres::fromGenreName(node.text().as_string());
@@ -1291,11 +1597,14 @@ void CollectionFilter::setSystemSelected(const std::string name, bool value)
 	}
 	else if (!value)			
 		mSystemFilter.erase(sys);	
+
+	mVersion++;
 }
 
 void CollectionFilter::resetSystemFilter()
 {
 	mSystemFilter.clear();
+	mVersion++;
 }
 
 std::string FileFilterIndex::getDisplayLabel(bool includeText)
@@ -4,12 +4,18 @@
 
 #include <map>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 #include <string>
+#include "TextSearchIndex.h"
 
 class FileData;
+class FolderData;
 class SystemData;
 
+// One bit per indexed game, by ordinal
+typedef std::vector<unsigned long long> FilterBits;
+
 enum FilterIndexType
 {
 	NONE = 0,
@@ -70,6 +76,12 @@ public:
 
 	bool isKeyBeingFilteredBy(std::string key, FilterIndexType type);
 	std::vector<FilterDataDecl> getFilterDataDecls();
+	// Type of the filter which primary key is the name (genre, players, favorite...), NONE if there's none
+	FilterIndexType getFilterType(const std::string& primaryKey);
+
+	// Indexed games having one of the values of each filter type, and which name contains one of the texts, in indexing order.
+	// Independent of the active filters.
+	void findGames(const std::map<FilterIndexType, std::vector<std::string>>& filters, const std::vector<std::string>& texts, std::vector<FileData*>& games);
 
 	void importIndex(FileFilterIndex* indexToImport);
 	void copyFrom(FileFilterIndex* indexToImport);
@@ -84,6 +96,9 @@ public:
 
 	std::string getDisplayLabel(bool includeText = false);
 
+	// Changes when the filters change, so lists filtered by this index can be cached
+	inline unsigned int getVersion() { return mVersion; }
+
 protected:
 	//std::vector<FilterDataDecl> filterDataDecl;
 	std::map<int, FilterDataDecl> mFilterDecl;
@@ -102,6 +117,20 @@ protected:
 
 	void clearIndex(std::map<std::string, int> indexMap);
 
+	void getFilterKeys(FileData* game, const FilterDataDecl& filterData, std::vector<std::string>& keys);
+	bool matchesFilterKey(FileData* game, FilterIndexType type, const std::string& key);
+	bool matchesFilter(FileData* game, const FilterDataDecl& filterData);
+	bool matchesFilters(FileData* game);
+
+	bool checkKeyBits();
+	const FilterBits& getKeyBits(const FilterDataDecl& filterData, const std::string& key);
+	void updateFilterBits();
+	int showFolder(FolderData* folder);
+
+	int getTextScore(FileData* game);
+	int getTextScore(const std::string& name, bool isChinese);
+	void updateTextScores();
+
 	bool filterByGenre;
 	bool filterByFamily;
 	bool filterByPlayers;
@@ -158,6 +187,38 @@ protected:
 
 	std::string mTextFilter;
 	bool		mUseRelevency;
+	unsigned int mVersion;
+
+	// Names of the indexed games, and the text filter scores of the ones matching mTextFilter
+	TextSearchIndex mTextIndex;
+	std::unordered_map<FileData*, int> mTextScores;
+	bool mTextScoresValid;
+	unsigned int mTextScoresVersion;
+	unsigned int mTextIndexVersion;
+	bool mIsChinese;
+
+	// Dense ordinals of the indexed games, and the games having each filter value as bitsets. Built lazily, dropped when games or metadata change.
+	std::unordered_map<FileData*, int> mOrdinals;
+	std::vector<FileData*> mGames; // by ordinal, nullptr once removed
+	std::vector<int> mFreeOrdinals;
+	unsigned int mGamesVersion;
+
+	std::map<int, std::map<std::string, FilterBits>> mKeyBits;
+	std::unordered_set<int> mKeyBitsTypes; // types which keys were all collected in one pass
+	unsigned int mKeyBitsGamesVersion;
+	unsigned int mKeyBitsChangeCount;
+
+	// Games matching every active filter
+	FilterBits mFilterBits;
+	bool mFilterBitsValid;
+	unsigned int mFilterBitsVersion;
+
+	// Folders having at least one displayed child
+	std::unordered_map<FolderData*, int> mFolderResults;
+	unsigned int mFolderResultsVersion;
+	unsigned int mFolderResultsGamesVersion;
+	unsigned int mFolderResultsChangeCount;
+	unsigned int mFolderResultsTreeVersion;
 };
 
 class CollectionFilter : public FileFilterIndex
@@ -3,10 +3,14 @@
 
 #include "utils/StringUtil.h"
 #include "LocaleES.h"
+#include <algorithm>
+#include <mutex>
 
 namespace FileSorts
 {
 	static Singleton* sInstance = nullptr;
+	// getSortType is also called by the web server threads, while the UI can reset the sorts
+	static std::mutex sInstanceLock;
 
 	Singleton* getInstance()
 	{
@@ -18,6 +22,8 @@ namespace FileSorts
 
 	void reset()
 	{
+		std::unique_lock<std::mutex> lock(sInstanceLock);
+
 		if (sInstance != nullptr)
 			delete sInstance;
 
@@ -26,16 +32,20 @@ namespace FileSorts
 
 	const std::vector<SortType>& getSortTypes()
 	{
+		std::unique_lock<std::mutex> lock(sInstanceLock);
 		return getInstance()->mSortTypes;
 	}
 
 	SortType getSortType(int sortId)
 	{
-		for (auto sort : getSortTypes())
+		std::unique_lock<std::mutex> lock(sInstanceLock);
+
+		auto& sortTypes = getInstance()->mSortTypes;
+		for (auto& sort : sortTypes)
 			if (sort.id == sortId)
 				return sort;
 
-		return getSortTypes().at(0);
+		return sortTypes.at(0);
 	}
 
 	Singleton::Singleton()
@@ -223,4 +233,204 @@ namespace FileSorts
 		std::string system2 = ((FileData*)file2)->getSourceFileData()->getSystemName();
 		return Utils::String::compareIgnoreCase(system1, system2) < 0;		
 	}
+
+	// Values compared by a sort type, in comparison order. Texts are upper-cased, so they compare like compareIgnoreCase.
+	struct SortKey
+	{
+		FileData* file;
+		int group;
+		double number;
+		std::string text;
+		double number2;
+		std::string name;
+	};
+
+	static inline bool operator<(const SortKey& a, const SortKey& b)
+	{
+		if (a.number != b.number)
+			return a.number < b.number;
+
+		int cmp = a.text.compare(b.text);
+		if (cmp != 0)
+			return cmp < 0;
+
+		if (a.number2 != b.number2)
+			return a.number2 < b.number2;
+
+		return a.name < b.name;
+	}
+
+	// "YYYYMMDDTHHMMSS" as YYYYMMDDHHMMSS, which keeps the order of the strings
+	static double getIsoDateKey(const std::string& date)
+	{
+		double ret = 0;
+
+		for (auto c : date)
+		{
+			if (c >= '0' && c <= '9')
+				ret = ret * 10 + (c - '0');
+			else if (c != 'T')
+				break;
+		}
+
+		return ret;
+	}
+
+	static double getYearKey(const std::string& date)
+	{
+		return getIsoDateKey(date.substr(0, 4));
+	}
+
+	static std::string getNameKey(FileData* file, bool ignoreLeadingArticles)
+	{
+		if (ignoreLeadingArticles)
+		{
+			static auto articles = Utils::String::commaStringToVector(_("A,AN,THE"));
+			return Utils::String::toUpper(stripLeadingArticle(file->getName(), articles));
+		}
+
+		return Utils::String::toUpper(file->getName());
+	}
+
+	static void fillSortKey(SortKey& key, int sortId, bool ignoreLeadingArticles)
+	{
+		FileData* file = key.file;
+		const MetaDataList& metadata = file->getMetadata();
+
+		switch (sortId)
+		{
+		case FILENAME_ASCENDING:
+		case FILENAME_DESCENDING:
+			key.text = getNameKey(file, ignoreLeadingArticles);
+			break;
+		case RATING_ASCENDING:
+		case RATING_DESCENDING:
+			key.number = metadata.getFloat(MetaDataId::Rating);
+			break;
+		case TIMESPLAYED_ASCENDING:
+		case TIMESPLAYED_DESCENDING:
+			// only games have playcount metadata
+			key.number = metadata.getType() == GAME_METADATA ? metadata.getInt(MetaDataId::PlayCount) : -1;
+			break;
+		case GAMETIME_ASCENDING:
+		case GAMETIME_DESCENDING:
+			key.number = metadata.getType() == GAME_METADATA ? metadata.getInt(MetaDataId::GameTime) : -1;
+			break;
+		case LASTPLAYED_ASCENDING:
+		case LASTPLAYED_DESCENDING:
+			key.number = getIsoDateKey(metadata.get(MetaDataId::LastPlayed));
+			break;
+		case NUMBERPLAYERS_ASCENDING:
+		case NUMBERPLAYERS_DESCENDING:
+			key.number = metadata.getInt(MetaDataId::Players);
+			break;
+		case RELEASEDATE_ASCENDING:
+		case RELEASEDATE_DESCENDING:
+			key.number = getIsoDateKey(metadata.get(MetaDataId::ReleaseDate));
+			break;
+		case GENRE_ASCENDING:
+		case GENRE_DESCENDING:
+			key.text = Utils::String::toUpper(metadata.get(MetaDataId::Genre));
+			break;
+		case DEVELOPER_ASCENDING:
+		case DEVELOPER_DESCENDING:
+			key.text = Utils::String::toUpper(metadata.get(MetaDataId::Developer));
+			break;
+		case PUBLISHER_ASCENDING:
+		case PUBLISHER_DESCENDING:
+			key.text = Utils::String::toUpper(metadata.get(MetaDataId::Publisher));
+			break;
+		case SYSTEM_ASCENDING:
+		case SYSTEM_DESCENDING:
+			key.text = Utils::String::toUpper(file->getSourceFileData()->getSystemName());
+			break;
+		case FILECREATION_DATE_ASCENDING:
+		case FILECREATION_DATE_DESCENDING:
+			key.number = (double)Utils::FileSystem::getFileCreationDate(file->getPath()).getTime();
+			break;
+		case SYSTEM_RELEASEDATE_ASCENDING:
+		case SYSTEM_RELEASEDATE_DESCENDING:
+			key.text = Utils::String::toUpper(file->getSourceFileData()->getSystemName());
+			key.number2 = getYearKey(metadata.get(MetaDataId::ReleaseDate));
+			key.name = Utils::String::toUpper(file->getName());
+			break;
+		case RELEASEDATE_SYSTEM_ASCENDING:
+		case RELEASEDATE_SYSTEM_DESCENDING:
+			key.number = getYearKey(metadata.get(MetaDataId::ReleaseDate));
+			key.text = Utils::String::toUpper(file->getSourceFileData()->getSystemName());
+			key.name = Utils::String::toUpper(file->getName());
+			break;
+		}
+	}
+
+	static void initSortKey(SortKey& key, FileData* file, const SortType& sort, bool foldersFirst, bool favoritesFirst, const std::unordered_map<FileData*, int>* scores, bool ignoreLeadingArticles)
+	{
+		key.file = file;
+		key.group = 0;
+		key.number = 0;
+		key.number2 = 0;
+
+		if (scores != nullptr)
+		{
+			auto it = scores->find(file);
+			if (it != scores->cend())
+				key.group = it->second;
+		}
+		else
+		{
+			if (favoritesFirst && !file->getFavorite())
+				key.group += 2;
+
+			if (foldersFirst && file->getType() != FOLDER)
+				key.group += 1;
+		}
+
+		fillSortKey(key, sort.id, ignoreLeadingArticles);
+	}
+
+	static inline bool isSortedBefore(const SortKey& a, const SortKey& b, bool ascending)
+	{
+		if (a.group != b.group)
+			return a.group < b.group;
+
+		return ascending ? a < b : b < a;
+	}
+
+	void sortFiles(std::vector<FileData*>& files, const SortType& sort, bool foldersFirst, bool favoritesFirst, const std::unordered_map<FileData*, int>* scores)
+	{
+		if (files.size() < 2)
+			return;
+
+		bool ignoreLeadingArticles = Settings::IgnoreLeadingArticles();
+
+		std::vector<SortKey> keys(files.size());
+		for (size_t i = 0; i < files.size(); i++)
+			initSortKey(keys[i], files[i], sort, foldersFirst, favoritesFirst, scores, ignoreLeadingArticles);
+
+		// Relevance orders are always ascending
+		bool ascending = sort.ascending || scores != nullptr;
+
+		std::sort(keys.begin(), keys.end(), [ascending](const SortKey& a, const SortKey& b) { return isSortedBefore(a, b, ascending); });
+
+		for (size_t i = 0; i < files.size(); i++)
+			files[i] = keys[i].file;
+	}
+
+	void insertFile(std::vector<FileData*>& files, FileData* file, const SortType& sort, bool foldersFirst, bool favoritesFirst)
+	{
+		bool ignoreLeadingArticles = Settings::IgnoreLeadingArticles();
+
+		SortKey key;
+		initSortKey(key, file, sort, foldersFirst, favoritesFirst, nullptr, ignoreLeadingArticles);
+
+		// Binary search : only the keys of the compared files are extracted
+		auto it = std::upper_bound(files.begin(), files.end(), key, [&](const SortKey& value, FileData* item)
+		{
+			SortKey itemKey;
+			initSortKey(itemKey, item, sort, foldersFirst, favoritesFirst, nullptr, ignoreLeadingArticles);
+			return isSortedBefore(value, itemKey, sort.ascending);
+		});
+
+		files.insert(it, file);
+	}
 };
@@ -3,6 +3,7 @@
 #define ES_APP_FILE_SORTS_H
 
 #include "FileData.h"
+#include <unordered_map>
 #include <vector>
 
 namespace FileSorts
@@ -63,9 +64,18 @@ namespace FileSorts
 	};
 
 	void reset();
+	// Copy of the sort type, safe to use from any thread. The first sort type if sortId is unknown
 	SortType getSortType(int sortId);
+	// Only valid until the next reset : use it from the UI thread
 	const std::vector<SortType>& getSortTypes();
 
+	// Sorts files with the order of the sort type. Values compared by the sort type are extracted once per file, instead of at every comparison.
+	// scores is the relevance of the files when filtering, lower scores first. Files without score are considered as 0.
+	void sortFiles(std::vector<FileData*>& files, const SortType& sort, bool foldersFirst = false, bool favoritesFirst = false, const std::unordered_map<FileData*, int>* scores = nullptr);
+
+	// Inserts a file into a list sorted by sortFiles, at its sorted position
+	void insertFile(std::vector<FileData*>& files, FileData* file, const SortType& sort, bool foldersFirst = false, bool favoritesFirst = false);
+
 	bool compareName(const FileData* file1, const FileData* file2);
 	bool compareRating(const FileData* file1, const FileData* file2);
 	bool compareTimesPlayed(const FileData* file1, const FileData* fil2);
@@ -2,14 +2,19 @@
 
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
+#include "utils/TaskScheduler.h"
 #include "FileData.h"
 #include "FileFilterIndex.h"
+#include "GamelistJournal.h"
 #include "Log.h"
+#include "Tracer.h"
 #include "Settings.h"
 #include "SystemData.h"
 #include <pugixml/src/pugixml.hpp>
 #include "Genres.h"
 #include "Paths.h"
+#include <algorithm>
+#include <string.h>
 
 #ifdef WIN32
 #include <Windows.h>
@@ -18,6 +23,52 @@
 #include <unistd.h>
 #endif
 
+// Gamelists with less entries are decoded on the calling thread
+#define PARALLEL_GAMELIST_MIN_NODES	1024
+#define PARALLEL_GAMELIST_CHUNK		256
+
+// Metadata of a <game> or <folder> node, decoded by a worker before the FileData it belongs to is known
+struct GamelistRecord
+{
+	GamelistRecord() : metadata(GAME_METADATA) { }
+
+	std::string path;
+	MetaDataList metadata;
+};
+
+// Resolves paths and decodes metadata of the nodes in parallel chunks. Only reads the document, which pugixml allows from several threads.
+static std::vector<GamelistRecord> decodeGamelistNodes(const std::vector<pugi::xml_node>& nodes, SystemData* system)
+{
+	std::vector<GamelistRecord> records(nodes.size());
+
+	std::string relativeTo = system->getStartPath();
+
+	Utils::TaskGroup group;
+
+	for (size_t start = 0; start < nodes.size(); start += PARALLEL_GAMELIST_CHUNK)
+	{
+		size_t end = std::min(start + PARALLEL_GAMELIST_CHUNK, nodes.size());
+
+		group.run([&nodes, &records, &relativeTo, system, start, end]
+		{
+			for (size_t i = start; i < end; i++)
+			{
+				pugi::xml_node fileNode = nodes[i];
+				GamelistRecord& record = records[i];
+
+				record.path = Utils::FileSystem::resolveRelativePath(fileNode.child("path").text().get(), relativeTo, false);
+				record.metadata.loadFromXML(strcmp(fileNode.name(), "folder") == 0 ? FOLDER_METADATA : GAME_METADATA, fileNode, system);
+				record.metadata.migrate(nullptr, fileNode);
+
+				Genres::convertGenreToGenreIds(&record.metadata);
+			}
+		});
+	}
+
+	group.wait();
+	return records;
+}
+
 std::string getGamelistRecoveryPath(SystemData* system)
 {
 	return Utils::FileSystem::getGenericPath(Paths::getUserEmulationStationPath() + "/recovery/" + system->getName());
@@ -141,18 +192,27 @@ std::vector<FileData*> loadGamelistFile(const std::string xmlpath, SystemData* s
 	std::string relativeTo = system->getStartPath();
 	bool trustGamelist = Settings::ParseGamelistOnly();
 
+	std::vector<pugi::xml_node> nodes;
 	for (pugi::xml_node fileNode : root.children())
 	{
-		FileType type = GAME;
-
 		std::string tag = fileNode.name();
+		if (tag == "game" || tag == "folder")
+			nodes.push_back(fileNode);
+	}
 
-		if (tag == "folder")
-			type = FOLDER;
-		else if (tag != "game")
-			continue;
+	// Decoding is done ahead in parallel, only the tree insertion stays serial
+	std::vector<GamelistRecord> records;
+	if (Settings::ParallelGamelistParsing() && nodes.size() >= PARALLEL_GAMELIST_MIN_NODES)
+		records = decodeGamelistNodes(nodes, system);
 
-		const std::string path = Utils::FileSystem::resolveRelativePath(fileNode.child("path").text().get(), relativeTo, false);
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		pugi::xml_node fileNode = nodes[i];
+		GamelistRecord* record = records.empty() ? nullptr : &records[i];
+
+		FileType type = strcmp(fileNode.name(), "folder") == 0 ? FOLDER : GAME;
+
+		const std::string path = record != nullptr ? record->path : Utils::FileSystem::resolveRelativePath(fileNode.child("path").text().get(), relativeTo, false);
 		
 		FileData* file = nullptr;
 
@@ -184,8 +244,14 @@ std::vector<FileData*> loadGamelistFile(const std::string xmlpath, SystemData* s
 		if (!trustGamelist || !file->isArcadeAsset()) // arcade assets already filtered when !trustGamelist
 		{
 			MetaDataList& mdl = file->getMetadata();
-			mdl.loadFromXML(type == FOLDER ? FOLDER_METADATA : GAME_METADATA, fileNode, system);
-			mdl.migrate(file, fileNode);
+
+			// A decoded record can't be used on a file already filled by a previous node with the same path
+			bool decoded = record != nullptr && mdl.moveFrom(record->metadata);
+			if (!decoded)
+			{
+				mdl.loadFromXML(type == FOLDER ? FOLDER_METADATA : GAME_METADATA, fileNode, system);
+				mdl.migrate(file, fileNode);
+			}
 
 			// Make sure name gets set if one didn't exist
 			if (mdl.getName().empty())
@@ -194,7 +260,8 @@ std::vector<FileData*> loadGamelistFile(const std::string xmlpath, SystemData* s
 			if (!trustGamelist && !file->getHidden() && Utils::FileSystem::isHidden(path))
 				mdl.set(MetaDataId::Hidden, "true");
 
-			Genres::convertGenreToGenreIds(&mdl);
+			if (!decoded)
+				Genres::convertGenreToGenreIds(&mdl);
 
 			if (checkSize != SIZE_MAX)
 				mdl.setDirty();
@@ -214,14 +281,28 @@ void clearTemporaryGamelistRecovery(SystemData* system)
 	Utils::FileSystem::deleteDirectoryFiles(path, true);
 }
 
+bool hasGamelistRecovery(SystemData* system)
+{
+	auto path = getGamelistRecoveryPath(system);
+	if (!Utils::FileSystem::isDirectory(path))
+		return false;
+
+	return Utils::FileSystem::getDirContent(path, true).size() > 0;
+}
+
 void parseGamelist(SystemData* system, std::unordered_map<std::string, FileData*>& fileMap)
 {
+	TRACE_SCOPE_ARG("parseGamelist", system->getName());
+
 	std::string xmlpath = system->getGamelistPath(false);
 
 	auto size = Utils::FileSystem::getFileSize(xmlpath);
 	if (size != 0)
 		loadGamelistFile(xmlpath, system, fileMap, SIZE_MAX, true);
 
+	// Saved changes are replayed before the recovery files, which are newer
+	GamelistJournal::replay(system, fileMap);
+
 	auto files = Utils::FileSystem::getDirContent(getGamelistRecoveryPath(system), true);
 	for (auto file : files)
 		loadGamelistFile(file, system, fileMap, size, true);
@@ -230,7 +311,7 @@ void parseGamelist(SystemData* system, std::unordered_map<std::string, FileData*
 		system->setGamelistHash(size);	
 }
 
-bool addFileDataNode(pugi::xml_node& parent, FileData* file, const char* tag, SystemData* system, bool fullPaths = false)
+bool addFileDataNode(pugi::xml_node& parent, FileData* file, const char* tag, SystemData* system, bool fullPaths)
 {
 	//create game and add to parent node
 	pugi::xml_node newNode = parent.append_child(tag);
@@ -382,6 +463,22 @@ void updateGamelist(SystemData* system)
 		return;
 	}
 
+	if (Settings::GamelistJournal())
+	{
+		// Only the changed files are written, gamelist.xml is rewritten by the next compaction
+		if (GamelistJournal::append(system, dirtyFiles))
+		{
+			for (auto file : dirtyFiles)
+				file->getMetadata().resetChangedFlag();
+
+			LOG(LogInfo) << "Journaled " << dirtyFiles.size() << " entities for '" << system->getName() << "'";
+			clearTemporaryGamelistRecovery(system);
+			return;
+		}
+	}
+	else if (Utils::FileSystem::exists(GamelistJournal::getJournalPath(system)))
+		GamelistJournal::compact(system);
+
 	int numUpdated = 0;
 
 	pugi::xml_document doc;
@@ -505,6 +602,10 @@ void cleanupGamelist(SystemData* system)
 		return;
 	}
 
+	// Journaled changes must be in gamelist.xml before it's rewritten
+	if (Utils::FileSystem::exists(GamelistJournal::getJournalPath(system)))
+		GamelistJournal::compact(system);
+
 	std::string xmlReadPath = system->getGamelistPath(false);
 	if (!Utils::FileSystem::exists(xmlReadPath))
 		return;
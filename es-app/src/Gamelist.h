@@ -7,8 +7,11 @@
 #include <vector>
 #include <string>
 
+#include "FileData.h"
+
 class SystemData;
-class FileData;
+
+namespace pugi { class xml_node; }
 
 // Loads gamelist.xml data into a SystemData.
 void parseGamelist(SystemData* system, std::unordered_map<std::string, FileData*>& fileMap);
@@ -24,6 +27,12 @@ bool removeFromGamelistRecovery(FileData* file);
 bool saveToXml(FileData* file, const std::string& fileName, bool fullPaths = false);
 
 bool hasDirtyFile(SystemData* system);
+bool hasGamelistRecovery(SystemData* system);
+
+FileData* findOrCreateFile(SystemData* system, const std::string& path, FileType type, std::unordered_map<std::string, FileData*>& fileMap);
+
+// Appends the <game>/<folder> node of file to parent. Returns false, and appends nothing, if file only has default values
+bool addFileDataNode(pugi::xml_node& parent, FileData* file, const char* tag, SystemData* system, bool fullPaths = false);
 
 std::vector<FileData*> loadGamelistFile(const std::string xmlpath, SystemData* system, std::unordered_map<std::string, FileData*>& fileMap, size_t checkSize = SIZE_MAX, bool fromFile = true);
 
@@ -0,0 +1,221 @@
+#include "GamelistBenchmark.h"
+
+#include "utils/FileSystemUtil.h"
+#include "FileData.h"
+#include "FileSorts.h"
+#include "Gamelist.h"
+#include "Log.h"
+#include "Settings.h"
+#include "SystemData.h"
+#include <SDL_timer.h>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#define BENCHMARK_RUNS	3
+
+static std::string createSyntheticGamelist(const std::string& folder, int gameCount)
+{
+	static const char* genres[] = { "Shooter", "Platform", "Fighting", "Sports / Soccer", "Puzzle", "Racing, Driving" };
+
+	std::stringstream ss;
+	ss << "<?xml version=\"1.0\"?>\n<gameList>\n";
+
+	for (int i = 0; i < gameCount; i++)
+	{
+		std::string name = "Game " + std::to_string(i);
+
+		ss << "\t<game id=\"" << i << "\" source=\"ScreenScraper.fr\">\n";
+		ss << "\t\t<path>./" << (i % 10 == 0 ? "subfolder/" : "") << name << ".zip</path>\n";
+		ss << "\t\t<name>" << name << "</name>\n";
+		ss << "\t\t<desc>Synthetic description of " << name << ". It is long enough to look like a real scraped description, with several sentences describing the game, its story and how it plays.</desc>\n";
+		ss << "\t\t<image>./images/" << name << "-image.png</image>\n";
+		ss << "\t\t<thumbnail>./images/" << name << "-thumb.png</thumbnail>\n";
+		ss << "\t\t<video>./videos/" << name << "-video.mp4</video>\n";
+		ss << "\t\t<rating>0." << (i % 10) << "</rating>\n";
+		ss << "\t\t<releasedate>19" << (80 + i % 20) << "0101T000000</releasedate>\n";
+		ss << "\t\t<developer>Developer " << (i % 50) << "</developer>\n";
+		ss << "\t\t<publisher>Publisher " << (i % 30) << "</publisher>\n";
+		ss << "\t\t<genre>" << genres[i % 6] << "</genre>\n";
+		ss << "\t\t<players>1-" << (1 + i % 4) << "</players>\n";
+		ss << "\t\t<playcount>" << (i % 7) << "</playcount>\n";
+		ss << "\t\t<lastplayed>20200101T1200" << (10 + i % 50) << "</lastplayed>\n";
+		ss << "\t\t<hash>" << std::hex << (0x10000000 + i) << std::dec << "</hash>\n";
+		ss << "\t\t<scrap name=\"ScreenScraper\" date=\"20200101T120000\" />\n";
+		ss << "\t</game>\n";
+	}
+
+	ss << "</gameList>\n";
+
+	std::string path = folder + "/gamelist.xml";
+	Utils::FileSystem::writeAllText(path, ss.str());
+	return path;
+}
+
+// Heap bytes a std::map<MetaDataId, std::string> based MetaDataList would use for the same values (libstdc++, 64 bits)
+static size_t estimateMapLayoutUsage(const MetaDataList& mdl)
+{
+	size_t ret = 0;
+
+	for (auto& mdd : MetaDataList::getMDD())
+	{
+		if (mdd.id == MetaDataId::Name)
+			continue;
+
+		std::string value = mdl.get(mdd.id, false);
+		if (value == mdd.defaultValue)
+			continue;
+
+		ret += 80; // rb-tree node + std::string, rounded by malloc
+		if (value.size() > 15)
+			ret += ((value.size() + 1 + 8 + 15) / 16) * 16;
+	}
+
+	return ret;
+}
+
+static void reportMetadataMemory(SystemData* system)
+{
+	size_t compact = 0;
+	size_t legacy = 0;
+	size_t count = 0;
+
+	for (auto file : system->getRootFolder()->getFilesRecursive(GAME | FOLDER))
+	{
+		compact += file->getMetadata().getMemoryUsage();
+		legacy += estimateMapLayoutUsage(file->getMetadata());
+		count++;
+	}
+
+	std::stringstream result;
+	result << "Metadata memory (" << count << " entries) : " << (compact / 1024) << "KB, std::map layout estimate : " << (legacy / 1024) << "KB";
+
+	std::cout << result.str() << std::endl;
+	LOG(LogInfo) << result.str();
+}
+
+// Times every sort type with the former comparator based sort, and with FileSorts::sortFiles
+static void timeSorting(SystemData* system)
+{
+	std::vector<FileData*> files = system->getRootFolder()->getFilesRecursive(GAME | FOLDER);
+	std::shuffle(files.begin(), files.end(), std::mt19937(42));
+
+	std::cout << "Sorting " << files.size() << " entries (comparators / sort keys) :" << std::endl;
+
+	for (auto& sort : FileSorts::getSortTypes())
+	{
+		int comparatorTime = -1;
+		int keysTime = -1;
+
+		for (int run = 0; run < BENCHMARK_RUNS; run++)
+		{
+			std::vector<FileData*> list = files;
+
+			auto compf = sort.comparisonFunction;
+			bool ascending = sort.ascending;
+
+			int start = SDL_GetTicks();
+			std::sort(list.begin(), list.end(), [compf, ascending](const FileData* file1, const FileData* file2) { return ascending ? compf(file1, file2) : compf(file2, file1); });
+			int time = SDL_GetTicks() - start;
+
+			if (comparatorTime < 0 || time < comparatorTime)
+				comparatorTime = time;
+
+			list = files;
+
+			start = SDL_GetTicks();
+			FileSorts::sortFiles(list, sort);
+			time = SDL_GetTicks() - start;
+
+			if (keysTime < 0 || time < keysTime)
+				keysTime = time;
+		}
+
+		std::stringstream result;
+		result << "  " << sort.description << " : " << comparatorTime << "ms / " << keysTime << "ms";
+
+		std::cout << result.str() << std::endl;
+		LOG(LogInfo) << result.str();
+	}
+}
+
+static int timeGamelistLoading(SystemData* system, const std::string& gamelistPath, bool parallel, size_t& gameCount)
+{
+	Settings::getInstance()->setBool("ParallelGamelistParsing", parallel);
+
+	int best = -1;
+
+	for (int run = 0; run < BENCHMARK_RUNS; run++)
+	{
+		FolderData* root = system->getRootFolder();
+		root->clear();
+
+		std::unordered_map<std::string, FileData*> fileMap;
+		fileMap[system->getStartPath()] = root;
+
+		int start = SDL_GetTicks();
+		gameCount = loadGamelistFile(gamelistPath, system, fileMap).size();
+		int time = SDL_GetTicks() - start;
+
+		if (best < 0 || time < best)
+			best = time;
+	}
+
+	return best;
+}
+
+void runGamelistBenchmark(int gameCount)
+{
+	std::string folder = Utils::FileSystem::getTempPath() + "/gamelist-benchmark";
+	Utils::FileSystem::createDirectory(folder);
+
+	std::string gamelistPath = createSyntheticGamelist(folder, gameCount);
+
+	auto settings = Settings::getInstance();
+
+	bool parseGamelistOnly = settings->getBool("ParseGamelistOnly");
+	bool ignoreGamelist = settings->getBool("IgnoreGamelist");
+	bool gamelistSnapshots = settings->getBool("GamelistSnapshots");
+	bool parallelGamelistParsing = settings->getBool("ParallelGamelistParsing");
+
+	// The roms don't exist : trust the gamelist, and let the benchmark load it itself
+	settings->setBool("ParseGamelistOnly", true);
+	settings->setBool("IgnoreGamelist", true);
+	settings->setBool("GamelistSnapshots", false);
+
+	SystemEnvironmentData* envData = new SystemEnvironmentData();
+	envData->mStartPath = folder;
+	envData->mSearchExtensions.insert(".zip");
+
+	SystemMetadata md;
+	md.name = "benchmark";
+	md.fullName = "Gamelist benchmark";
+	md.releaseYear = 0;
+
+	SystemData* system = new SystemData(md, envData, nullptr, false, false, false);
+
+	size_t serialCount = 0;
+	size_t parallelCount = 0;
+
+	int serialTime = timeGamelistLoading(system, gamelistPath, false, serialCount);
+	int parallelTime = timeGamelistLoading(system, gamelistPath, true, parallelCount);
+
+	std::stringstream result;
+	result << "Gamelist benchmark (" << gameCount << " games, best of " << BENCHMARK_RUNS << ") : serial " << serialTime << "ms (" << serialCount << " loaded), parallel " << parallelTime << "ms (" << parallelCount << " loaded)";
+
+	std::cout << result.str() << std::endl;
+	LOG(LogInfo) << result.str();
+
+	reportMetadataMemory(system);
+	timeSorting(system);
+
+	delete system;
+
+	settings->setBool("ParseGamelistOnly", parseGamelistOnly);
+	settings->setBool("IgnoreGamelist", ignoreGamelist);
+	settings->setBool("GamelistSnapshots", gamelistSnapshots);
+	settings->setBool("ParallelGamelistParsing", parallelGamelistParsing);
+
+	Utils::FileSystem::deleteDirectoryFiles(folder, true);
+}
@@ -0,0 +1,9 @@
+#pragma once
+#ifndef ES_APP_GAMELIST_BENCHMARK_H
+#define ES_APP_GAMELIST_BENCHMARK_H
+
+// Generates a synthetic gamelist of gameCount games, then times loadGamelistFile with serial and parallel decoding.
+// Run with --benchmark-gamelist [count], results are printed and logged, with the memory used by the loaded metadata and the time of each sort type.
+void runGamelistBenchmark(int gameCount);
+
+#endif // ES_APP_GAMELIST_BENCHMARK_H
@@ -0,0 +1,408 @@
+#include "GamelistJournal.h"
+
+#include "utils/FileSystemUtil.h"
+#include "utils/MappedFile.h"
+#include "utils/StringUtil.h"
+#include "utils/TaskScheduler.h"
+#include "FileData.h"
+#include "Gamelist.h"
+#include "Genres.h"
+#include "Log.h"
+#include "Paths.h"
+#include "Settings.h"
+#include "SystemData.h"
+#include <pugixml/src/pugixml.hpp>
+#include <SDL_timer.h>
+#include <algorithm>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JOURNAL_HEADER				"ESJOURNAL "
+#define JOURNAL_VERSION				3
+#define JOURNAL_MIN_COMPACTION_SIZE	(64 * 1024)
+
+// Serializes appends and compactions, which may come from the http server or the background compaction
+static std::mutex sJournalLock;
+
+static std::mutex sCompactionGroupLock;
+static Utils::TaskGroup* sCompactionGroup = nullptr;
+
+class XmlStringWriter : public pugi::xml_writer
+{
+public:
+	void write(const void* data, size_t size) override { result.append((const char*)data, size); }
+
+	std::string result;
+};
+
+// State of gamelist.xml when the journal was started
+struct GamelistBinding
+{
+	GamelistBinding() : size(0), time(-1) { }
+
+	unsigned long long size;
+	long long time; // -1 in version 1 journals, which only know the size
+};
+
+static GamelistBinding getGamelistBinding(const std::string& gamelistPath)
+{
+	GamelistBinding binding;
+	binding.size = Utils::FileSystem::getFileSize(gamelistPath);
+	binding.time = (long long)Utils::FileSystem::getFileModificationDate(gamelistPath).getTime();
+	return binding;
+}
+
+static std::string formatHeader(const GamelistBinding& binding)
+{
+	return JOURNAL_HEADER + std::to_string(JOURNAL_VERSION) + " " + std::to_string(binding.size) + " " + std::to_string(binding.time) + "\n";
+}
+
+// "ESJOURNAL <version> <size>[ <modification time>]". Version 2 journals also have a crc32, which is ignored
+static bool parseHeader(const std::string& line, GamelistBinding& binding)
+{
+	size_t headerLength = strlen(JOURNAL_HEADER);
+	if (line.size() < headerLength || line.compare(0, headerLength, JOURNAL_HEADER) != 0)
+		return false;
+
+	auto values = Utils::String::split(Utils::String::trim(line.substr(headerLength)), ' ', true);
+	if (values.size() < 2)
+		return false;
+
+	int version = Utils::String::toInteger(values[0]);
+	if (version < 1 || version > JOURNAL_VERSION || (version >= 2 && values.size() < 3))
+		return false;
+
+	binding.size = strtoull(values[1].c_str(), nullptr, 10);
+
+	if (version >= 2)
+		binding.time = strtoll(values[2].c_str(), nullptr, 10);
+
+	return true;
+}
+
+// False if gamelist.xml was rewritten by something else since the journal was started
+static bool isBoundTo(const GamelistBinding& binding, const std::string& gamelistPath)
+{
+	if (binding.size != Utils::FileSystem::getFileSize(gamelistPath))
+		return false;
+
+	return binding.time < 0 || binding.time == (long long)Utils::FileSystem::getFileModificationDate(gamelistPath).getTime();
+}
+
+// Record format : "<length>\n<xml node>\n". A record cut by a crash is ignored, with the ones following it.
+static bool readJournal(const std::string& path, GamelistBinding& binding, std::vector<std::string>& records)
+{
+	Utils::MappedFile file;
+	if (!file.open(path))
+		return false;
+
+	const char* data = (const char*)file.data();
+	const char* end = data + file.size();
+
+	const char* eol = (const char*)memchr(data, '\n', file.size());
+	if (eol == nullptr || !parseHeader(std::string(data, eol), binding))
+	{
+		LOG(LogWarning) << "GamelistJournal : " << path << " is not a valid journal";
+		return false;
+	}
+
+	const char* ptr = eol + 1;
+	while (ptr < end)
+	{
+		eol = (const char*)memchr(ptr, '\n', end - ptr);
+		if (eol == nullptr)
+			break;
+
+		size_t length = (size_t)strtoull(std::string(ptr, eol).c_str(), nullptr, 10);
+		const char* payload = eol + 1;
+
+		if (length == 0 || (size_t)(end - payload) < length)
+		{
+			LOG(LogWarning) << "GamelistJournal : " << path << " is truncated, ignoring its last records";
+			break;
+		}
+
+		records.push_back(std::string(payload, length));
+		ptr = payload + length + 1;
+	}
+
+	return true;
+}
+
+// Reads only the header of the journal
+static bool readJournalBinding(const std::string& path, GamelistBinding& binding)
+{
+#if defined(_WIN32)
+	FILE* fp = _wfopen(Utils::String::convertToWideString(path).c_str(), L"rb");
+#else
+	FILE* fp = fopen(path.c_str(), "rb");
+#endif
+	if (fp == nullptr)
+		return false;
+
+	char header[128];
+	bool ret = fgets(header, sizeof(header), fp) != nullptr && parseHeader(header, binding);
+
+	fclose(fp);
+	return ret;
+}
+
+std::string GamelistJournal::getJournalPath(SystemData* system)
+{
+	return Paths::getUserEmulationStationPath() + "/journal/" + system->getName() + ".journal";
+}
+
+bool GamelistJournal::append(SystemData* system, const std::vector<FileData*>& files)
+{
+	if (system == nullptr || files.size() == 0)
+		return false;
+
+	std::string records;
+
+	for (auto file : files)
+	{
+		pugi::xml_document doc;
+		pugi::xml_node root = doc.append_child("gameList");
+
+		const char* tag = (file->getType() == GAME) ? "game" : "folder";
+
+		if (!addFileDataNode(root, file, tag, system))
+		{
+			// Only default values : a node with just the path removes the file from gamelist.xml
+			std::string path = Utils::FileSystem::createRelativePath(file->getPath(), system->getStartPath(), false);
+			if (path.empty() && file->getType() == FOLDER)
+				path = ".";
+
+			root.append_child(tag).append_child("path").text().set(path.c_str());
+		}
+
+		XmlStringWriter writer;
+		root.first_child().print(writer, "", pugi::format_raw);
+
+		records += std::to_string(writer.result.size()) + "\n" + writer.result + "\n";
+	}
+
+	std::unique_lock<std::mutex> lock(sJournalLock);
+
+	std::string path = getJournalPath(system);
+	std::string gamelistPath = system->getGamelistPath(false);
+
+	// A journal bound to another gamelist.xml is still merged over it : only an invalid journal is started again
+	GamelistBinding binding;
+	bool isNew = Utils::FileSystem::getFileSize(path) == 0 || !readJournalBinding(path, binding);
+	if (isNew)
+	{
+		Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(path));
+		records = formatHeader(getGamelistBinding(gamelistPath)) + records;
+	}
+
+#if defined(_WIN32)
+	FILE* fp = _wfopen(Utils::String::convertToWideString(path).c_str(), isNew ? L"wb" : L"ab");
+#else
+	FILE* fp = fopen(path.c_str(), isNew ? "wb" : "ab");
+#endif
+	if (fp == nullptr)
+	{
+		LOG(LogError) << "GamelistJournal : Unable to open " << path;
+		return false;
+	}
+
+	bool ret = fwrite(records.c_str(), 1, records.size(), fp) == records.size();
+	ret = (fclose(fp) == 0) && ret;
+
+	if (!ret)
+	{
+		LOG(LogError) << "GamelistJournal : Unable to write " << path;
+	}
+
+	return ret;
+}
+
+void GamelistJournal::replay(SystemData* system, std::unordered_map<std::string, FileData*>& fileMap)
+{
+	std::unique_lock<std::mutex> lock(sJournalLock);
+
+	std::string path = getJournalPath(system);
+
+	GamelistBinding binding;
+	std::vector<std::string> records;
+	if (!readJournal(path, binding, records))
+		return;
+
+	// The saved changes win over the ones made by another program to the same games
+	if (!isBoundTo(binding, system->getGamelistPath(false)))
+	{
+		LOG(LogWarning) << "GamelistJournal : gamelist of " << system->getName() << " was modified by another program, replaying " << path << " over it";
+	}
+
+	std::string relativeTo = system->getStartPath();
+	bool trustGamelist = Settings::ParseGamelistOnly();
+
+	for (auto& record : records)
+	{
+		pugi::xml_document doc;
+		if (!doc.load_string(record.c_str()))
+			continue;
+
+		pugi::xml_node fileNode = doc.first_child();
+		FileType type = strcmp(fileNode.name(), "folder") == 0 ? FOLDER : GAME;
+
+		std::string filePath = Utils::FileSystem::resolveRelativePath(fileNode.child("path").text().get(), relativeTo, false);
+
+		FileData* file = nullptr;
+
+		auto it = fileMap.find(filePath);
+		if (it != fileMap.cend())
+			file = it->second;
+		else if (trustGamelist || Utils::FileSystem::exists(filePath))
+			file = findOrCreateFile(system, filePath, type, fileMap);
+
+		if (file == nullptr || (trustGamelist && file->isArcadeAsset()))
+			continue;
+
+		// A record holds every non default value : unlike loadGamelistFile, values missing from it are reset
+		MetaDataList mdl(type == FOLDER ? FOLDER_METADATA : GAME_METADATA);
+		mdl.loadFromXML(type == FOLDER ? FOLDER_METADATA : GAME_METADATA, fileNode, system);
+		mdl.migrate(file, fileNode);
+
+		if (mdl.getName().empty())
+			mdl.set(MetaDataId::Name, file->getDisplayName());
+
+		if (!trustGamelist && Utils::FileSystem::isHidden(filePath))
+			mdl.set(MetaDataId::Hidden, "true");
+
+		Genres::convertGenreToGenreIds(&mdl);
+		mdl.resetChangedFlag();
+
+		file->setMetadata(mdl);
+	}
+
+	LOG(LogInfo) << "GamelistJournal : " << records.size() << " changes replayed for " << system->getName();
+}
+
+bool GamelistJournal::compact(SystemData* system)
+{
+	std::unique_lock<std::mutex> lock(sJournalLock);
+
+	std::string path = getJournalPath(system);
+	std::string gamelistPath = system->getGamelistPath(false);
+
+	GamelistBinding binding;
+	std::vector<std::string> records;
+	if (!readJournal(path, binding, records))
+		return false;
+
+	if (!isBoundTo(binding, gamelistPath))
+	{
+		LOG(LogWarning) << "GamelistJournal : gamelist of " << system->getName() << " was modified by another program, merging " << path << " over it";
+	}
+
+	int startTicks = SDL_GetTicks();
+
+	pugi::xml_document doc;
+	pugi::xml_node root;
+
+	if (Utils::FileSystem::getFileSize(gamelistPath) > 0)
+	{
+		pugi::xml_parse_result result = doc.load_file(WINSTRINGW(gamelistPath).c_str());
+		if (!result)
+		{
+			LOG(LogError) << "GamelistJournal : Error parsing XML file \"" << gamelistPath << "\"!\n	" << result.description();
+			return false;
+		}
+
+		root = doc.child("gameList");
+	}
+
+	if (!root)
+		root = doc.append_child("gameList");
+
+	std::string relativeTo = system->getStartPath();
+
+	std::unordered_map<std::string, pugi::xml_node> xmlMap;
+	for (pugi::xml_node fileNode : root.children())
+	{
+		pugi::xml_node pathNode = fileNode.child("path");
+		if (pathNode)
+			xmlMap[Utils::FileSystem::getCanonicalPath(Utils::FileSystem::resolveRelativePath(pathNode.text().get(), relativeTo, true))] = fileNode;
+	}
+
+	// Records are applied in order, the last one of a file wins
+	for (auto& record : records)
+	{
+		pugi::xml_document recordDoc;
+		if (!recordDoc.load_string(record.c_str()))
+			continue;
+
+		pugi::xml_node recordNode = recordDoc.first_child();
+		std::string filePath = Utils::FileSystem::getCanonicalPath(Utils::FileSystem::resolveRelativePath(recordNode.child("path").text().get(), relativeTo, true));
+
+		auto it = xmlMap.find(filePath);
+		if (it != xmlMap.cend())
+		{
+			root.remove_child(it->second);
+			xmlMap.erase(it);
+		}
+
+		// A node with only a path is a removal
+		if (recordNode.first_child().next_sibling())
+			xmlMap[filePath] = root.append_copy(recordNode);
+	}
+
+	std::string writePath = system->getGamelistPath(true);
+	Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(writePath));
+
+	std::string tmpPath = writePath + ".tmp";
+
+	if (!doc.save_file(WINSTRINGW(tmpPath).c_str()) || !Utils::FileSystem::renameFile(tmpPath, writePath))
+	{
+		LOG(LogError) << "GamelistJournal : Error saving gamelist.xml to \"" << writePath << "\" (for system " << system->getName() << ")!";
+		Utils::FileSystem::removeFile(tmpPath);
+		return false;
+	}
+
+	Utils::FileSystem::removeFile(path);
+
+	// Recovery files are bound to the gamelist size
+	system->setGamelistHash(Utils::FileSystem::getFileSize(writePath));
+
+	LOG(LogInfo) << "GamelistJournal : " << records.size() << " changes merged into '" << writePath << "' in " << (SDL_GetTicks() - startTicks) << "ms";
+	return true;
+}
+
+bool GamelistJournal::needsCompaction(SystemData* system)
+{
+	auto journalSize = Utils::FileSystem::getFileSize(getJournalPath(system));
+	if (journalSize == 0)
+		return false;
+
+	auto gamelistSize = Utils::FileSystem::getFileSize(system->getGamelistPath(false));
+	return journalSize > std::max<unsigned long long>(JOURNAL_MIN_COMPACTION_SIZE, gamelistSize / 10);
+}
+
+void GamelistJournal::compactInBackground(SystemData* system)
+{
+	std::unique_lock<std::mutex> lock(sCompactionGroupLock);
+
+	if (sCompactionGroup == nullptr)
+		sCompactionGroup = new Utils::TaskGroup();
+
+	sCompactionGroup->run([system] { compact(system); });
+}
+
+void GamelistJournal::compactAllInBackground()
+{
+	for (auto system : SystemData::sSystemVector)
+		if (!system->isCollection() && Utils::FileSystem::exists(getJournalPath(system)))
+			compactInBackground(system);
+}
+
+void GamelistJournal::waitForCompaction()
+{
+	std::unique_lock<std::mutex> lock(sCompactionGroupLock);
+
+	if (sCompactionGroup != nullptr)
+		sCompactionGroup->wait();
+}
@@ -0,0 +1,36 @@
+#pragma once
+#ifndef ES_APP_GAMELIST_JOURNAL_H
+#define ES_APP_GAMELIST_JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class SystemData;
+class FileData;
+
+// Append-only log of gamelist changes, so saving costs O(changed games) instead of rewriting gamelist.xml.
+// Each record is the complete <game>/<folder> node of a changed file (a node with only a <path> resets the file to its defaults).
+// The journal is replayed over gamelist.xml when the system is loaded, and merged into it once it gets too big, when the screensaver starts and on exit.
+// It's bound to the size and date of gamelist.xml at its creation : if something else modified gamelist.xml since, the journal is still merged over it.
+class GamelistJournal
+{
+public:
+	static bool append(SystemData* system, const std::vector<FileData*>& files);
+	static void replay(SystemData* system, std::unordered_map<std::string, FileData*>& fileMap);
+
+	// Merges the journal into gamelist.xml, then deletes it
+	static bool compact(SystemData* system);
+
+	static bool needsCompaction(SystemData* system);
+	static void compactInBackground(SystemData* system);
+	// Compacts the journals of all the systems, when ES is idle
+	static void compactAllInBackground();
+
+	// Must be called before deleting systems
+	static void waitForCompaction();
+
+	static std::string getJournalPath(SystemData* system);
+};
+
+#endif // ES_APP_GAMELIST_JOURNAL_H
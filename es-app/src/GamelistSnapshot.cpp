@@ -0,0 +1,294 @@
+#include "GamelistSnapshot.h"
+
+#include "utils/BinaryStream.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/MappedFile.h"
+#include "utils/StringUtil.h"
+#include "FileData.h"
+#include "Gamelist.h"
+#include "GamelistJournal.h"
+#include "Log.h"
+#include "Paths.h"
+#include "Settings.h"
+#include "SystemData.h"
+#include <stack>
+#include <unordered_map>
+
+#define SNAPSHOT_MAGIC		0x4C475345 // "ESGL"
+#define SNAPSHOT_VERSION	2
+
+std::string GamelistSnapshot::getSnapshotPath(SystemData* system)
+{
+	return Paths::getUserEmulationStationPath() + "/cache/gamelists/" + system->getName() + ".cache";
+}
+
+std::string GamelistSnapshot::getFingerPrint(SystemData* system)
+{
+	bool showHidden = Settings::ShowHiddenFiles();
+
+	int shv = system->getShowHiddenFilesOverride();
+	if (shv == 1) showHidden = true;
+	else if (shv == 0) showHidden = false;
+
+	std::string ret = system->getStartPath();
+	ret += "|" + Utils::String::join(std::vector<std::string>(system->getExtensions().cbegin(), system->getExtensions().cend()), ",");
+	ret += "|" + std::to_string(showHidden ? 1 : 0);
+	ret += std::to_string(Settings::ParseGamelistOnly() ? 1 : 0);
+	ret += std::to_string(Settings::PreloadMedias() ? 1 : 0);
+	ret += std::to_string(Settings::RemoveMultiDiskContent() ? 1 : 0);
+	ret += "|" + std::to_string(MetaDataList::getMDD().size());
+	return ret;
+}
+
+void GamelistSnapshot::remove(SystemData* system)
+{
+	Utils::FileSystem::removeFile(getSnapshotPath(system));
+}
+
+static void writeFileData(Utils::BinaryWriter& writer, FileData* file, unsigned int parentIndex, const std::string& rootPath)
+{
+	writer.writeByte((unsigned char)file->getType());
+	writer.writeInt(parentIndex);
+
+	bool contains = false;
+	std::string relative = Utils::FileSystem::removeCommonPath(file->getPath(), rootPath, contains);
+	writer.writeByte(contains ? 1 : 0);
+	writer.writeString(relative);
+}
+
+bool GamelistSnapshot::save(SystemData* system, FolderData* root, const std::vector<std::string>& scannedFolders)
+{
+	if (system == nullptr || root == nullptr)
+		return false;
+
+	std::string gamelistPath = system->getGamelistPath(false);
+
+	Utils::BinaryWriter writer;
+	writer.writeInt(SNAPSHOT_MAGIC);
+	writer.writeInt(SNAPSHOT_VERSION);
+	writer.writeString(getFingerPrint(system));
+	writer.writeLong((long long)Utils::FileSystem::getFileSize(gamelistPath));
+	writer.writeLong((long long)Utils::FileSystem::getFileModificationDate(gamelistPath).getTime());
+
+	// The snapshot includes the changes replayed from the journal
+	std::string journalPath = GamelistJournal::getJournalPath(system);
+	writer.writeLong((long long)Utils::FileSystem::getFileSize(journalPath));
+	writer.writeLong((long long)Utils::FileSystem::getFileModificationDate(journalPath).getTime());
+
+	writer.writeInt((unsigned int)scannedFolders.size());
+	for (auto folder : scannedFolders)
+	{
+		writer.writeString(folder);
+		writer.writeLong((long long)Utils::FileSystem::getFileModificationDate(folder).getTime());
+	}
+
+	// Flatten the tree : parents are always written before their children
+	std::vector<FileData*> nodes;
+	std::unordered_map<FileData*, unsigned int> folderIndexes;
+	folderIndexes[root] = 0;
+
+	std::stack<FolderData*> stack;
+	stack.push(root);
+
+	while (stack.size())
+	{
+		FolderData* current = stack.top();
+		stack.pop();
+
+		for (auto child : current->getChildren())
+		{
+			if (child->getMetadata().wasChanged())
+				return false; // Unsaved changes : the snapshot would not reflect gamelist.xml
+
+			nodes.push_back(child);
+
+			if (child->getType() == FOLDER)
+			{
+				// Same order as the folders are read back : the root is 0
+				unsigned int index = (unsigned int)folderIndexes.size();
+				folderIndexes[child] = index;
+				stack.push((FolderData*)child);
+			}
+		}
+	}
+
+	const std::string& rootPath = root->getPath();
+
+	writer.writeInt((unsigned int)nodes.size());
+	for (auto file : nodes)
+	{
+		writeFileData(writer, file, folderIndexes[file->getParent()], rootPath);
+
+		const MetaDataList& mdl = file->getMetadata();
+		writer.writeString(mdl.mName);
+
+		unsigned int valueCount = 0;
+		for (size_t id = 0; id < mdl.mSlots.size(); id++)
+			if (mdl.hasStoredValue((MetaDataId)id))
+				valueCount++;
+
+		writer.writeInt(valueCount);
+		for (size_t id = 0; id < mdl.mSlots.size(); id++)
+		{
+			if (!mdl.hasStoredValue((MetaDataId)id))
+				continue;
+
+			writer.writeByte((unsigned char)id);
+			writer.writeString(mdl.getStoredValue((MetaDataId)id));
+		}
+
+		writer.writeInt((unsigned int)mdl.mUnKnownElements.size());
+		for (auto& element : mdl.mUnKnownElements)
+		{
+			writer.writeString(*element.name);
+			writer.writeString(element.value);
+			writer.writeByte(element.isElement ? 1 : 0);
+		}
+
+		writer.writeInt((unsigned int)mdl.mScrapeDates.size());
+		for (auto& scrapeDate : mdl.mScrapeDates)
+		{
+			writer.writeInt((unsigned int)scrapeDate.first);
+			writer.writeLong((long long)scrapeDate.second);
+		}
+	}
+
+	std::string path = getSnapshotPath(system);
+	std::string tmpPath = path + ".tmp";
+
+	Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(path));
+	Utils::FileSystem::writeAllText(tmpPath, writer.getBuffer());
+
+	if (Utils::FileSystem::getFileSize(tmpPath) != writer.getBuffer().size() || !Utils::FileSystem::renameFile(tmpPath, path))
+	{
+		LOG(LogError) << "GamelistSnapshot : Unable to write " << path;
+		Utils::FileSystem::removeFile(tmpPath);
+		return false;
+	}
+
+	return true;
+}
+
+bool GamelistSnapshot::load(SystemData* system, FolderData* root)
+{
+	if (system == nullptr || root == nullptr)
+		return false;
+
+	// Pending recovery files are merged by parseGamelist
+	if (hasGamelistRecovery(system))
+		return false;
+
+	Utils::MappedFile file;
+	if (!file.open(getSnapshotPath(system)))
+		return false;
+
+	Utils::BinaryReader reader(file.data(), file.size());
+
+	if (reader.readInt() != SNAPSHOT_MAGIC || reader.readInt() != SNAPSHOT_VERSION)
+		return false;
+
+	if (reader.readString() != getFingerPrint(system))
+		return false;
+
+	std::string gamelistPath = system->getGamelistPath(false);
+
+	long long gamelistSize = reader.readLong();
+	long long gamelistTime = reader.readLong();
+	if (reader.failed() || gamelistSize != (long long)Utils::FileSystem::getFileSize(gamelistPath) || gamelistTime != (long long)Utils::FileSystem::getFileModificationDate(gamelistPath).getTime())
+		return false;
+
+	std::string journalPath = GamelistJournal::getJournalPath(system);
+
+	long long journalSize = reader.readLong();
+	long long journalTime = reader.readLong();
+	if (reader.failed() || journalSize != (long long)Utils::FileSystem::getFileSize(journalPath) || journalTime != (long long)Utils::FileSystem::getFileModificationDate(journalPath).getTime())
+		return false;
+
+	unsigned int folderCount = reader.readInt();
+	for (unsigned int i = 0; i < folderCount && !reader.failed(); i++)
+	{
+		std::string folder = reader.readString();
+		long long time = reader.readLong();
+
+		if (time != (long long)Utils::FileSystem::getFileModificationDate(folder).getTime())
+		{
+			LOG(LogDebug) << "GamelistSnapshot : " << folder << " has changed";
+			return false;
+		}
+	}
+
+	std::string rootPath = root->getPath();
+
+	std::vector<FolderData*> folders;
+	folders.push_back(root);
+
+	bool corrupted = false;
+
+	unsigned int nodeCount = reader.readInt();
+	for (unsigned int i = 0; i < nodeCount && !reader.failed(); i++)
+	{
+		FileType type = (FileType)reader.readByte();
+		unsigned int parentIndex = reader.readInt();
+		bool relative = reader.readByte() != 0;
+		std::string path = reader.readString();
+
+		if (reader.failed() || parentIndex >= folders.size() || (type != GAME && type != FOLDER))
+		{
+			corrupted = true;
+			break;
+		}
+
+		if (relative)
+			path = rootPath + "/" + path;
+
+		FileData* item;
+		if (type == FOLDER)
+		{
+			FolderData* folder = new FolderData(path, system);
+			folders.push_back(folder);
+			item = folder;
+		}
+		else
+			item = new FileData(GAME, path, system);
+
+		folders[parentIndex]->addChild(item);
+
+		MetaDataList& mdl = item->getMetadata();
+		mdl.mRelativeTo = system;
+		mdl.mName = reader.readString();
+
+		unsigned int count = reader.readInt();
+		for (unsigned int m = 0; m < count && !reader.failed(); m++)
+		{
+			MetaDataId id = (MetaDataId)reader.readByte();
+			mdl.storeValue(id, reader.readString());
+		}
+
+		count = reader.readInt();
+		for (unsigned int m = 0; m < count && !reader.failed(); m++)
+		{
+			std::string name = reader.readString();
+			std::string value = reader.readString();
+			bool isElement = reader.readByte() != 0;
+			mdl.addUnknownElement(name, value, isElement);
+		}
+
+		count = reader.readInt();
+		for (unsigned int m = 0; m < count && !reader.failed(); m++)
+		{
+			int scraperId = (int)reader.readInt();
+			mdl.setScrapeDate(scraperId, (time_t)reader.readLong());
+		}
+
+		mdl.resetChangedFlag();
+	}
+
+	if (corrupted || reader.failed())
+	{
+		LOG(LogWarning) << "GamelistSnapshot : " << getSnapshotPath(system) << " is corrupted";
+		root->clear();
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#ifndef ES_APP_GAMELIST_SNAPSHOT_H
+#define ES_APP_GAMELIST_SNAPSHOT_H
+
+#include <string>
+#include <vector>
+
+class SystemData;
+class FolderData;
+
+// Binary image of a fully loaded system tree (rom folder scan + gamelist.xml + recovery files).
+// A snapshot is only valid while gamelist.xml size/mtime, the mtimes of every scanned rom folder and the settings affecting the scan are unchanged.
+class GamelistSnapshot
+{
+public:
+	// Rebuilds the children of root from the snapshot. Returns false (and leaves root empty) when the snapshot is missing or stale
+	static bool load(SystemData* system, FolderData* root);
+
+	// scannedFolders contains every folder enumerated by SystemData::populateFolder
+	static bool save(SystemData* system, FolderData* root, const std::vector<std::string>& scannedFolders);
+
+	static void remove(SystemData* system);
+
+	static std::string getSnapshotPath(SystemData* system);
+
+private:
+	static std::string getFingerPrint(SystemData* system);
+};
+
+#endif // ES_APP_GAMELIST_SNAPSHOT_H
@@ -0,0 +1,257 @@
+#include "HashCache.h"
+
+#include "utils/BinaryStream.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/MappedFile.h"
+#include "utils/StringUtil.h"
+#include "Log.h"
+#include "Paths.h"
+#include <mutex>
+#include <unordered_map>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#define stat64 _stat64
+#endif
+
+#define HASHCACHE_MAGIC		0x48435345 // "ESCH"
+#define HASHCACHE_VERSION	1
+
+// Pending entries are written by batches
+#define HASHCACHE_FLUSH_COUNT	32
+
+struct HashCacheEntry
+{
+	long long size;
+	long long modificationTime;
+	long long inode;
+	std::string value;
+};
+
+static std::mutex sLock;
+static bool sLoaded = false;
+static std::unordered_map<std::string, HashCacheEntry> sEntries;
+
+static std::string sPending;
+static int sPendingCount = 0;
+
+static std::string getCachePath()
+{
+	return Paths::getUserEmulationStationPath() + "/cache/hashes.bin";
+}
+
+static std::string getEntryKey(const std::string& path, const std::string& kind)
+{
+	return kind + "|" + path;
+}
+
+static bool getFileStamp(const std::string& path, long long& size, long long& modificationTime, long long& inode)
+{
+	struct stat64 info;
+
+#if defined(_WIN32)
+	if (_wstat64(Utils::String::convertToWideString(path).c_str(), &info) != 0)
+		return false;
+
+	inode = 0; // Not reliable on Windows
+#else
+	if (stat64(path.c_str(), &info) != 0)
+		return false;
+
+	inode = (long long)info.st_ino;
+#endif
+
+	size = (long long)info.st_size;
+	modificationTime = (long long)info.st_mtime;
+	return true;
+}
+
+static void writeRecord(Utils::BinaryWriter& writer, const std::string& key, const HashCacheEntry& entry)
+{
+	Utils::BinaryWriter record;
+	record.writeString(key);
+	record.writeLong(entry.size);
+	record.writeLong(entry.modificationTime);
+	record.writeLong(entry.inode);
+	record.writeString(entry.value);
+
+	writer.writeString(record.getBuffer());
+}
+
+static void rewrite()
+{
+	Utils::BinaryWriter writer;
+	writer.writeInt(HASHCACHE_MAGIC);
+	writer.writeInt(HASHCACHE_VERSION);
+
+	for (auto& entry : sEntries)
+		writeRecord(writer, entry.first, entry.second);
+
+	std::string path = getCachePath();
+	std::string tmpPath = path + ".tmp";
+
+	Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(path));
+	Utils::FileSystem::writeAllText(tmpPath, writer.getBuffer());
+
+	if (Utils::FileSystem::getFileSize(tmpPath) != writer.getBuffer().size() || !Utils::FileSystem::renameFile(tmpPath, path))
+	{
+		LOG(LogError) << "HashCache : Unable to write " << path;
+		Utils::FileSystem::removeFile(tmpPath);
+	}
+}
+
+static void load()
+{
+	if (sLoaded)
+		return;
+
+	sLoaded = true;
+
+	int records = 0;
+	bool truncated = false;
+
+	Utils::MappedFile file;
+	if (file.open(getCachePath()))
+	{
+		Utils::BinaryReader reader(file.data(), file.size());
+		if (reader.readInt() != HASHCACHE_MAGIC || reader.readInt() != HASHCACHE_VERSION)
+		{
+			LOG(LogWarning) << "HashCache : Ignoring outdated cache";
+			file.close();
+			Utils::FileSystem::removeFile(getCachePath());
+			return;
+		}
+
+		size_t position = 2 * sizeof(unsigned int);
+
+		while (position < file.size())
+		{
+			std::string data = reader.readString();
+			if (reader.failed())
+			{
+				// Record cut by a crash : new records can't be appended after it
+				truncated = true;
+				break;
+			}
+
+			position += sizeof(unsigned int) + data.size();
+
+			Utils::BinaryReader record((const unsigned char*)data.c_str(), data.size());
+
+			std::string key = record.readString();
+
+			HashCacheEntry entry;
+			entry.size = record.readLong();
+			entry.modificationTime = record.readLong();
+			entry.inode = record.readLong();
+			entry.value = record.readString();
+
+			if (record.failed())
+			{
+				truncated = true;
+				break;
+			}
+
+			// Last record wins
+			sEntries[key] = entry;
+			records++;
+		}
+	}
+
+	LOG(LogInfo) << "HashCache : " << sEntries.size() << " entries loaded";
+
+	// Drop overwritten records
+	if (truncated || records > (int)sEntries.size() * 2 + 256)
+		rewrite();
+}
+
+bool HashCache::get(const std::string& path, const std::string& kind, std::string& value)
+{
+	long long size, modificationTime, inode;
+	if (!getFileStamp(path, size, modificationTime, inode))
+		return false;
+
+	std::unique_lock<std::mutex> lock(sLock);
+	load();
+
+	auto it = sEntries.find(getEntryKey(path, kind));
+	if (it == sEntries.cend())
+		return false;
+
+	auto& entry = it->second;
+	if (entry.size != size || entry.modificationTime != modificationTime || entry.inode != inode)
+		return false;
+
+	value = entry.value;
+	return true;
+}
+
+void HashCache::set(const std::string& path, const std::string& kind, const std::string& value)
+{
+	HashCacheEntry entry;
+	if (value.empty() || !getFileStamp(path, entry.size, entry.modificationTime, entry.inode))
+		return;
+
+	entry.value = value;
+
+	std::string key = getEntryKey(path, kind);
+
+	std::unique_lock<std::mutex> lock(sLock);
+	load();
+
+	sEntries[key] = entry;
+
+	Utils::BinaryWriter writer;
+	writeRecord(writer, key, entry);
+	sPending += writer.getBuffer();
+	sPendingCount++;
+
+	if (sPendingCount >= HASHCACHE_FLUSH_COUNT)
+	{
+		lock.unlock();
+		flush();
+	}
+}
+
+void HashCache::flush()
+{
+	std::unique_lock<std::mutex> lock(sLock);
+	if (sPending.empty())
+		return;
+
+	std::string path = getCachePath();
+	Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(path));
+
+#if defined(_WIN32)
+	FILE* fp = _wfopen(Utils::String::convertToWideString(path).c_str(), L"ab");
+#else
+	FILE* fp = fopen(path.c_str(), "ab");
+#endif
+	if (fp == nullptr)
+	{
+		LOG(LogError) << "HashCache : Unable to write " << path;
+		return;
+	}
+
+	Utils::BinaryWriter header;
+
+	fseek(fp, 0, SEEK_END);
+	if (ftell(fp) == 0)
+	{
+		header.writeInt(HASHCACHE_MAGIC);
+		header.writeInt(HASHCACHE_VERSION);
+	}
+
+	const std::string& headerData = header.getBuffer();
+	bool ok = fwrite(headerData.c_str(), 1, headerData.size(), fp) == headerData.size() && fwrite(sPending.c_str(), 1, sPending.size(), fp) == sPending.size();
+	ok = (fclose(fp) == 0) && ok;
+
+	if (!ok)
+	{
+		LOG(LogError) << "HashCache : Unable to write " << path;
+	}
+
+	sPending.clear();
+	sPendingCount = 0;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#ifndef ES_APP_HASH_CACHE_H
+#define ES_APP_HASH_CACHE_H
+
+#include <string>
+
+// Persistent cache of ROM hashes (crc32, md5, cheevos...), so they survive gamelist resets.
+// Entries are keyed by path and hash kind, and are only valid while the size, modification time and inode of the file are unchanged.
+// New entries are appended to <user>/cache/hashes.bin, which is rewritten at loading when it contains too many outdated records.
+class HashCache
+{
+public:
+	static bool get(const std::string& path, const std::string& kind, std::string& value);
+	static void set(const std::string& path, const std::string& kind, const std::string& value);
+
+	// Writes pending entries
+	static void flush();
+};
+
+#endif // ES_APP_HASH_CACHE_H
@@ -9,14 +9,43 @@
 #include "Settings.h"
 #include "FileData.h"
 #include "ImageIO.h"
+#include <algorithm>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_set>
 
 std::vector<MetaDataDecl> MetaDataList::mMetaDataDecls;
+std::atomic<unsigned int> MetaDataList::sChangeCount(0);
 
 static std::map<MetaDataId, int> mMetaDataIndexes;
 static std::string* mDefaultGameMap = nullptr;
 static MetaDataType* mGameTypeMap = nullptr;
 static std::map<std::string, MetaDataId> mGameIdMap;
 
+// Number of slots of a MetaDataList : highest MetaDataId + 1
+static size_t mSlotCount = 0;
+
+// Low-cardinality values are interned : a 40k games library only has a few hundred developers or genres
+static bool* mInternedIds = nullptr;
+
+static std::unordered_set<std::string> mInternedStrings;
+static std::mutex mInternedStringsLock;
+
+static const std::string* internString(const std::string& value)
+{
+	std::unique_lock<std::mutex> lock(mInternedStringsLock);
+	return &(*mInternedStrings.insert(value).first); // Elements of an unordered_set never move
+}
+
+static std::string floatToString(float value)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%g", value);
+	return buffer;
+}
+
 static std::map<std::string, int> KnowScrapersIds =
 {
 	{ "ScreenScraper", 0 },
@@ -117,12 +146,245 @@ void MetaDataList::initMetadata()
 	for (int i = 0; i < maxID; i++)
 		mGameTypeMap[i] = MD_STRING;
 		
+	mSlotCount = 0;
+
 	for (auto iter = mMetaDataDecls.cbegin(); iter != mMetaDataDecls.cend(); iter++)
 	{
 		mDefaultGameMap[iter->id] = iter->defaultValue;
 		mGameTypeMap[iter->id] = iter->type;
 		mGameIdMap[iter->key] = iter->id;
+
+		if (iter->id >= mSlotCount)
+			mSlotCount = iter->id + 1;
+	}
+
+	if (mInternedIds != nullptr)
+		delete[] mInternedIds;
+
+	mInternedIds = new bool[mSlotCount];
+	for (size_t i = 0; i < mSlotCount; i++)
+		mInternedIds[i] = false;
+
+	for (auto id : { Emulator, Core, Developer, Publisher, Genre, GenreIds, ArcadeSystemName, Players, Language, Region, Family })
+		if (id < mSlotCount)
+			mInternedIds[id] = true;
+}
+
+MetaDataList::Slot::Slot(const Slot& other) : kind(EMPTY), string(nullptr)
+{
+	*this = other;
+}
+
+MetaDataList::Slot::Slot(Slot&& other) : kind(other.kind), time(other.time)
+{
+	other.kind = EMPTY;
+	other.string = nullptr;
+}
+
+MetaDataList::Slot& MetaDataList::Slot::operator=(const Slot& other)
+{
+	if (this == &other)
+		return *this;
+
+	clear();
+
+	kind = other.kind;
+	time = other.time;
+
+	if (kind == STRING && other.string != nullptr)
+		string = strdup(other.string);
+
+	return *this;
+}
+
+MetaDataList::Slot& MetaDataList::Slot::operator=(Slot&& other)
+{
+	if (this == &other)
+		return *this;
+
+	clear();
+
+	kind = other.kind;
+	time = other.time;
+
+	other.kind = EMPTY;
+	other.string = nullptr;
+	return *this;
+}
+
+void MetaDataList::Slot::clear()
+{
+	if (kind == STRING && string != nullptr)
+		free(string);
+
+	kind = EMPTY;
+	time = 0;
+}
+
+// Dates are kept as written, "YYYYMMDDTHHMMSS" packed as the number YYYYMMDDHHMMSS : no time zone conversion, so the value always reads back the same
+static bool packDate(const std::string& value, long long& packed)
+{
+	if (value.size() != 15 || value[8] != 'T')
+		return false;
+
+	packed = 0;
+
+	for (int i = 0; i < 15; i++)
+	{
+		if (i == 8)
+			continue;
+
+		if (value[i] < '0' || value[i] > '9')
+			return false;
+
+		packed = packed * 10 + (value[i] - '0');
+	}
+
+	return true;
+}
+
+static std::string unpackDate(long long packed)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%08lldT%06lld", packed / 1000000LL, packed % 1000000LL);
+	return buffer;
+}
+
+void MetaDataList::storeValue(MetaDataId id, const std::string& value)
+{
+	if (id >= mSlotCount)
+		return;
+
+	if (mSlots.size() == 0)
+		mSlots.resize(mSlotCount);
+
+	Slot& slot = mSlots[id];
+	slot.clear();
+
+	switch (mGameTypeMap[id])
+	{
+	case MD_BOOL:
+		if (value == "true" || value == "false")
+		{
+			slot.kind = Slot::BOOLEAN;
+			slot.intValue = (value == "true") ? 1 : 0;
+			return;
+		}
+		break;
+
+	case MD_INT:
+		if (!value.empty())
+		{
+			int intValue = atoi(value.c_str());
+			if (std::to_string(intValue) == value)
+			{
+				slot.kind = Slot::INTEGER;
+				slot.intValue = intValue;
+				return;
+			}
+		}
+		break;
+
+	case MD_FLOAT:
+	case MD_RATING:
+		if (!value.empty())
+		{
+			float floatValue = Utils::String::toFloat(value);
+			if (floatToString(floatValue) == value)
+			{
+				slot.kind = Slot::FLOAT;
+				slot.floatValue = floatValue;
+				return;
+			}
+		}
+		break;
+
+	case MD_DATE:
+	case MD_TIME:
+		if (packDate(value, slot.time))
+		{
+			slot.kind = Slot::DATE;
+			return;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	if (mInternedIds[id])
+	{
+		slot.kind = Slot::INTERNED;
+		slot.interned = internString(value);
+		return;
 	}
+
+	slot.kind = Slot::STRING;
+	slot.string = value.empty() ? nullptr : strdup(value.c_str());
+}
+
+std::string MetaDataList::getStoredValue(MetaDataId id) const
+{
+	if (id >= mSlots.size())
+		return mDefaultGameMap[id];
+
+	const Slot& slot = mSlots[id];
+
+	switch (slot.kind)
+	{
+	case Slot::STRING:
+		return slot.string == nullptr ? std::string() : std::string(slot.string);
+	case Slot::INTERNED:
+		return *slot.interned;
+	case Slot::INTEGER:
+		return std::to_string(slot.intValue);
+	case Slot::FLOAT:
+		return floatToString(slot.floatValue);
+	case Slot::BOOLEAN:
+		return slot.intValue ? "true" : "false";
+	case Slot::DATE:
+		return unpackDate(slot.time);
+	default:
+		break;
+	}
+
+	return mDefaultGameMap[id];
+}
+
+bool MetaDataList::hasValues() const
+{
+	for (auto& slot : mSlots)
+		if (slot.kind != Slot::EMPTY)
+			return true;
+
+	return false;
+}
+
+void MetaDataList::addUnknownElement(const std::string& name, const std::string& value, bool isElement)
+{
+	UnknownElement element;
+	element.name = internString(name);
+	element.value = value;
+	element.isElement = isElement;
+	mUnKnownElements.push_back(element);
+}
+
+size_t MetaDataList::getMemoryUsage() const
+{
+	size_t ret = mName.capacity() > 15 ? mName.capacity() + 1 : 0;
+	ret += mSlots.capacity() * sizeof(Slot);
+
+	for (auto& slot : mSlots)
+		if (slot.kind == Slot::STRING && slot.string != nullptr)
+			ret += strlen(slot.string) + 1;
+
+	ret += mUnKnownElements.capacity() * sizeof(UnknownElement);
+	for (auto& element : mUnKnownElements)
+		if (element.value.capacity() > 15)
+			ret += element.value.capacity() + 1;
+
+	ret += mScrapeDates.capacity() * sizeof(std::pair<int, time_t>);
+	return ret;
 }
 
 MetaDataType MetaDataList::getType(MetaDataId id) const
@@ -176,7 +438,7 @@ void MetaDataList::loadFromXML(MetaDataListType type, pugi::xml_node& node, Syst
 				if (!dateTime.isValid())
 					continue;
 								
-				mScrapeDates[scraperId->second] = dateTime;
+				setScrapeDate(scraperId->second, dateTime.getTime());
 			}		
 								
 			continue;
@@ -190,7 +452,7 @@ void MetaDataList::loadFromXML(MetaDataListType type, pugi::xml_node& node, Syst
 
 			value = xelement.text().get();
 			if (!value.empty())
-				mUnKnownElements.push_back(std::tuple<std::string, std::string, bool>(name, value, true));
+				addUnknownElement(name, value, true);
 
 			continue;
 		}
@@ -235,7 +497,7 @@ void MetaDataList::loadFromXML(MetaDataListType type, pugi::xml_node& node, Syst
 		{
 			value = xattr.value();
 			if (!value.empty())
-				mUnKnownElements.push_back(std::tuple<std::string, std::string, bool>(name, value, false));
+				addUnknownElement(name, value, false);
 
 			continue;
 		}
@@ -290,16 +552,15 @@ void MetaDataList::appendToXML(pugi::xml_node& parent, bool ignoreDefaults, cons
 		if (mddIter->id == MetaDataId::GenreIds)
 			continue;
 
-		auto mapIter = mMap.find(mddIter->id);
-		if(mapIter != mMap.cend())
+		if (hasStoredValue(mddIter->id))
 		{
 			// we have this value!
 			// if it's just the default (and we ignore defaults), don't write it
-			if (ignoreDefaults && mapIter->second == mddIter->defaultValue)
+			std::string value = getStoredValue(mddIter->id);
+			if (ignoreDefaults && value == mddIter->defaultValue)
 				continue;
 
 			// try and make paths relative if we can
-			std::string value = mapIter->second;
 			if (mddIter->type == MD_PATH)
 			{
 				if (fullPaths && mRelativeTo != nullptr)
@@ -315,13 +576,12 @@ void MetaDataList::appendToXML(pugi::xml_node& parent, bool ignoreDefaults, cons
 		}
 	}
 
-	for (std::tuple<std::string, std::string, bool> element : mUnKnownElements)
+	for (auto& element : mUnKnownElements)
 	{	
-		bool isElement = std::get<2>(element);
-		if (isElement)
-			parent.append_child(std::get<0>(element).c_str()).text().set(std::get<1>(element).c_str());
+		if (element.isElement)
+			parent.append_child(element.name->c_str()).text().set(element.value.c_str());
 		else 
-			parent.append_attribute(std::get<0>(element).c_str()).set_value(std::get<1>(element).c_str());
+			parent.append_attribute(element.name->c_str()).set_value(element.value.c_str());
 	}
 
 	if (mScrapeDates.size() > 0)
@@ -343,7 +603,7 @@ void MetaDataList::appendToXML(pugi::xml_node& parent, bool ignoreDefaults, cons
 			{
 				auto scraper = parent.append_child("scrap");
 				scraper.append_attribute("name").set_value(name.c_str());
-				scraper.append_attribute("date").set_value(scrapeDate.second.getIsoString().c_str());
+				scraper.append_attribute("date").set_value(Utils::Time::timeToString(scrapeDate.second).c_str());
 			}
 		}
 	}
@@ -358,6 +618,7 @@ void MetaDataList::set(MetaDataId id, const std::string& value)
 
 		mName = value;
 		mWasChanged = true;
+		sChangeCount++;
 		return;
 	}
 
@@ -368,16 +629,16 @@ void MetaDataList::set(MetaDataId id, const std::string& value)
 	// 	return;
 	// }
 
-	auto prev = mMap.find(id);
-	if (prev != mMap.cend() && prev->second == value)
+	if (hasStoredValue(id) && getStoredValue(id) == value)
 		return;
 
 	if (mGameTypeMap[id] == MD_PATH && mRelativeTo != nullptr) // if it's a path, resolve relative paths				
-		mMap[id] = Utils::FileSystem::createRelativePath(value, mRelativeTo->getStartPath(), true);
+		storeValue(id, Utils::FileSystem::createRelativePath(value, mRelativeTo->getStartPath(), true));
 	else
-		mMap[id] = Utils::String::trim(value);
+		storeValue(id, Utils::String::trim(value));
 
 	mWasChanged = true;
+	sChangeCount++;
 }
 
 const std::string MetaDataList::get(MetaDataId id, bool resolveRelativePaths) const
@@ -385,13 +646,12 @@ const std::string MetaDataList::get(MetaDataId id, bool resolveRelativePaths) co
 	if (id == MetaDataId::Name)
 		return mName;
 
-	auto it = mMap.find(id);
-	if (it != mMap.end())
+	if (hasStoredValue(id))
 	{
 		if (resolveRelativePaths && mGameTypeMap[id] == MD_PATH && mRelativeTo != nullptr) // if it's a path, resolve relative paths				
-			return Utils::FileSystem::resolveRelativePath(it->second, mRelativeTo->getStartPath(), true);
+			return Utils::FileSystem::resolveRelativePath(getStoredValue(id), mRelativeTo->getStartPath(), true);
 
-		return it->second;
+		return getStoredValue(id);
 	}
 
 	return mDefaultGameMap[id];
@@ -420,14 +680,40 @@ const std::string MetaDataList::get(const std::string& key, bool resolveRelative
 
 int MetaDataList::getInt(MetaDataId id) const
 {
+	if (hasStoredValue(id) && (mSlots[id].kind == Slot::INTEGER || mSlots[id].kind == Slot::BOOLEAN))
+		return mSlots[id].intValue;
+
 	return atoi(get(id).c_str());
 }
 
 float MetaDataList::getFloat(MetaDataId id) const
 {
+	if (hasStoredValue(id) && mSlots[id].kind == Slot::FLOAT)
+		return mSlots[id].floatValue;
+
 	return Utils::String::toFloat(get(id));
 }
 
+bool MetaDataList::moveFrom(MetaDataList& source)
+{
+	if (hasValues() || !mUnKnownElements.empty() || !mScrapeDates.empty())
+		return false;
+
+	mType = source.mType;
+	mRelativeTo = source.mRelativeTo;
+
+	// Same as loadFromXML : the current name is only replaced by a <name> element
+	if (!source.mName.empty())
+		mName = std::move(source.mName);
+
+	mSlots = std::move(source.mSlots);
+	mUnKnownElements = std::move(source.mUnKnownElements);
+	mScrapeDates = std::move(source.mScrapeDates);
+	mWasChanged = true;
+	sChangeCount++;
+	return true;
+}
+
 bool MetaDataList::wasChanged() const
 {
 	return mWasChanged;
@@ -560,19 +846,30 @@ void MetaDataList::setScrapeDate(const std::string& scraper)
 	if (it == KnowScrapersIds.cend())
 		return;
 
-	mScrapeDates[it->second] = Utils::Time::DateTime::now();
+	setScrapeDate(it->second, Utils::Time::now());
 	mWasChanged = true;
+	sChangeCount++;
+}
+
+void MetaDataList::setScrapeDate(int scraperId, time_t date)
+{
+	// Kept sorted by scraper id, like the map it replaces, so gamelist.xml is written in the same order
+	auto it = std::lower_bound(mScrapeDates.begin(), mScrapeDates.end(), scraperId, [](const std::pair<int, time_t>& item, int id) { return item.first < id; });
+	if (it != mScrapeDates.end() && it->first == scraperId)
+		it->second = date;
+	else
+		mScrapeDates.insert(it, std::pair<int, time_t>(scraperId, date));
 }
 
-Utils::Time::DateTime* MetaDataList::getScrapeDate(const std::string& scraper)
+Utils::Time::DateTime MetaDataList::getScrapeDate(const std::string& scraper)
 {
 	auto it = KnowScrapersIds.find(scraper);
 	if (it != KnowScrapersIds.cend())
 	{
-		auto itd = mScrapeDates.find(it->second);
-		if (itd != mScrapeDates.cend())
-			return &itd->second;
+		for (auto& scrapeDate : mScrapeDates)
+			if (scrapeDate.first == it->second)
+				return Utils::Time::DateTime(scrapeDate.second);
 	}
 
-	return nullptr;
+	return Utils::Time::DateTime();
 }
\ No newline at end of file
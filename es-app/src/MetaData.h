@@ -2,6 +2,7 @@
 #ifndef ES_APP_META_DATA_H
 #define ES_APP_META_DATA_H
 
+#include <atomic>
 #include <map>
 #include <vector>
 #include <functional>
@@ -131,6 +132,8 @@ enum MetaDataListType
 
 class MetaDataList
 {
+	friend class GamelistSnapshot;
+
 public:
 	static void initMetadata();
 
@@ -139,6 +142,9 @@ public:
 
 	void migrate(FileData* file, pugi::xml_node& node);
 
+	// Takes the values decoded by loadFromXML into a standalone list. Returns false, leaving both lists untouched, if this list already holds values.
+	bool moveFrom(MetaDataList& source);
+
 	MetaDataList(MetaDataListType type);
 	
 	void set(MetaDataId id, const std::string& value);
@@ -161,8 +167,13 @@ public:
 	const void setDirty() 
 	{ 
 		mWasChanged = true; 
+		sChangeCount++;
 	}
 
+	// Incremented at every change of any list : caches built from metadata values compare it to know if they're outdated
+	static unsigned int getChangeCount() { return sChangeCount; }
+	static void notifyChange() { sChangeCount++; }
+
 	inline MetaDataListType getType() const { return mType; }
 	static const std::vector<MetaDataDecl>& getMDD() { return mMetaDataDecls; }
 	inline const std::string& getName() const { return mName; }
@@ -174,20 +185,78 @@ public:
 	std::string getRelativeRootPath();
 
 	void setScrapeDate(const std::string& scraper);
-	Utils::Time::DateTime* getScrapeDate(const std::string& scraper);
+	Utils::Time::DateTime getScrapeDate(const std::string& scraper);
+
+	// Heap bytes used by the values of this list
+	size_t getMemoryUsage() const;
 
 private:
-	std::map<int, Utils::Time::DateTime> mScrapeDates;
+	// One slot per MetaDataId. Values are stored typed when they convert back to the exact same string,
+	// low-cardinality strings are shared with the other lists, and the others are owned C strings.
+	class Slot
+	{
+	public:
+		enum Kind : unsigned char
+		{
+			EMPTY = 0,
+			STRING,
+			INTERNED,
+			INTEGER,
+			FLOAT,
+			BOOLEAN,
+			DATE
+		};
+
+		Slot() : kind(EMPTY), string(nullptr) { }
+		Slot(const Slot& other);
+		Slot(Slot&& other);
+		~Slot() { clear(); }
+
+		Slot& operator=(const Slot& other);
+		Slot& operator=(Slot&& other);
+
+		void clear();
+
+		Kind kind;
+
+		union
+		{
+			char*				string;		// nullptr for an empty string
+			const std::string*	interned;
+			int					intValue;
+			float				floatValue;
+			long long			time;		// DATE : YYYYMMDDHHMMSS
+		};
+	};
+
+	struct UnknownElement
+	{
+		const std::string*	name; // interned
+		std::string			value;
+		bool				isElement;
+	};
+
+	// Stores a value that has already been trimmed or made relative
+	void storeValue(MetaDataId id, const std::string& value);
+	std::string getStoredValue(MetaDataId id) const;
+	bool hasStoredValue(MetaDataId id) const { return id < mSlots.size() && mSlots[id].kind != Slot::EMPTY; }
+	bool hasValues() const;
+
+	void addUnknownElement(const std::string& name, const std::string& value, bool isElement);
+	void setScrapeDate(int scraperId, time_t date);
+
+	std::vector<std::pair<int, time_t>> mScrapeDates;
 
 	std::string		mName;
 	MetaDataListType mType;
-	std::map<MetaDataId, std::string> mMap;
+	std::vector<Slot> mSlots; // Empty until a value is set
 	bool mWasChanged;
 	SystemData*		mRelativeTo;
 
 	static std::vector<MetaDataDecl> mMetaDataDecls;
+	static std::atomic<unsigned int> sChangeCount;
 
-	std::vector<std::tuple<std::string, std::string, bool>> mUnKnownElements;
+	std::vector<UnknownElement> mUnKnownElements;
 };
 
 #endif // ES_APP_META_DATA_H
@@ -518,22 +518,33 @@ std::string RetroAchievements::getCheevosHashFromFile(int consoleId, const std::
 	return "00000000000000000000000000000000";	
 }
 
-std::string RetroAchievements::getCheevosHash( SystemData* system, const std::string fileName)
+int RetroAchievements::getConsoleId(SystemData* system)
 {
-	bool fromZipContents = system->shouldExtractHashesFromArchives();
-
-	int consoleId = 0;
-
 	for (auto pid : system->getPlatformIds())
 	{
 		auto it = cheevosConsoleID.find(pid);
 		if (it != cheevosConsoleID.cend())
-		{
-			consoleId = it->second;
-			break;
-		}
+			return it->second;
 	}
 
+	return 0;
+}
+
+bool RetroAchievements::isFileMd5Hash(SystemData* system)
+{
+	int consoleId = getConsoleId(system);
+	if (consoleId == RC_CONSOLE_ARCADE)
+		return false;
+
+	return consoleId == 0 || consolesWithmd5hashes.find(consoleId) != consolesWithmd5hashes.cend();
+}
+
+std::string RetroAchievements::getCheevosHash( SystemData* system, const std::string fileName)
+{
+	bool fromZipContents = system->shouldExtractHashesFromArchives();
+
+	int consoleId = getConsoleId(system);
+
 	if (consoleId == RC_CONSOLE_ARCADE)
 		return getCheevosHashFromFile(consoleId, fileName);
 
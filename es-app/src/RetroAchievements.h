@@ -199,8 +199,11 @@ public:
 	static std::map<std::string, std::string>	getCheevosHashes();
 
 	static std::string				getCheevosHash(SystemData* pSystem, const std::string fileName);
+	// True if the cheevos hash of the system's roms is the plain md5 of the file
+	static bool						isFileMd5Hash(SystemData* pSystem);
 	static bool						testAccount(const std::string& username, const std::string& password, std::string& tokenOrError);
 
 private:
+	static int						getConsoleId(SystemData* pSystem);
 	static std::string				getCheevosHashFromFile(int consoleId, const std::string fileName);
 };
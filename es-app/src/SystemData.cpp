@@ -2,14 +2,18 @@
 
 #include "SystemConf.h"
 #include "utils/FileSystemUtil.h"
-#include "utils/ThreadPool.h"
+#include "utils/TaskScheduler.h"
 #include "CollectionSystemManager.h"
 #include "FileFilterIndex.h"
 #include "FileSorts.h"
 #include "Gamelist.h"
+#include "GamelistJournal.h"
+#include "GamelistSnapshot.h"
 #include "Log.h"
+#include "Tracer.h"
 #include "utils/Platform.h"
 #include "Settings.h"
+#include "SettingsRegistry.h"
 #include "ThemeData.h"
 #include "views/UIModeController.h"
 #include <fstream>
@@ -24,6 +28,7 @@
 #include <functional>
 #include "SaveStateRepository.h"
 #include "Paths.h"
+#include <SDL_timer.h>
 
 #if WIN32
 #include "Win32ApiSystem.h"
@@ -58,6 +63,8 @@ static std::map<std::string, std::function<BindableProperty(SystemData*)>> prope
 VectorEx<SystemData*> SystemData::sSystemVector;
 bool SystemData::IsManufacturerSupported = false;
 
+static std::atomic<unsigned int> sGamesVersion(0);
+
 SystemData::SystemData(const SystemMetadata& meta, SystemEnvironmentData* envData, std::vector<EmulatorData>* pEmulators, bool CollectionSystem, bool groupedSystem, bool withTheme, bool loadThemeOnlyIfElements) :
 	mMetadata(meta), mEnvData(envData), mIsCollectionSystem(CollectionSystem), mIsGameSystem(true)
 {
@@ -65,10 +72,15 @@ SystemData::SystemData(const SystemMetadata& meta, SystemEnvironmentData* envDat
 	mIsCheevosSupported = -1;
 	mIsGroupSystem = groupedSystem;
 	mGameListHash = 0;
+	mGamesVersion = ++sGamesVersion;
 	mGameCountInfo = nullptr;
 	mSortId = Settings::getInstance()->getInt(getName() + ".sort");
 	mGridSizeOverride = Vector2f(0, 0);
 
+	mShowHiddenFilesSetting = SettingsRegistry::getString(getName() + ".ShowHiddenFiles");
+	mFolderViewModeSetting = SettingsRegistry::getString(getName() + ".FolderViewMode");
+	mHiddenExtSetting = SettingsRegistry::getList(getName() + ".HiddenExt", ';', true);
+
 	mFilterIndex = nullptr;
 
 	if (pEmulators != nullptr)
@@ -85,12 +97,16 @@ SystemData::SystemData(const SystemMetadata& meta, SystemEnvironmentData* envDat
 		mRootFolder = new FolderData(mEnvData->mStartPath, this);
 		mRootFolder->getMetadata().set(MetaDataId::Name, mMetadata.fullName);
 
-		std::unordered_map<std::string, FileData*> fileMap;
-		fileMap[mEnvData->mStartPath] = mRootFolder;
+		bool useSnapshot = Settings::GamelistSnapshots() && !Settings::IgnoreGamelist();
+
+		int startTicks = SDL_GetTicks();
 
-		if (!Settings::ParseGamelistOnly())
+		if (useSnapshot && GamelistSnapshot::load(this, mRootFolder))
 		{
-			populateFolder(mRootFolder, fileMap);
+			LOG(LogInfo) << "Loaded system " << getName() << " from snapshot in " << (SDL_GetTicks() - startTicks) << "ms";
+
+			// Recovery files are bound to the gamelist size, which parseGamelist sets otherwise
+			setGamelistHash(Utils::FileSystem::getFileSize(getGamelistPath(false)));
 
 			if (!UIModeController::LoadEmptySystems())
 			{
@@ -101,12 +117,47 @@ SystemData::SystemData(const SystemMetadata& meta, SystemEnvironmentData* envDat
 					return;
 			}
 		}
+		else
+		{
+			std::unordered_map<std::string, FileData*> fileMap;
+			fileMap[mEnvData->mStartPath] = mRootFolder;
 
-		if (!Settings::IgnoreGamelist())
-			parseGamelist(this, fileMap);		
-		
-		if (Settings::RemoveMultiDiskContent())
-			removeMultiDiskContent(fileMap);
+			std::vector<std::string> scannedFolders;
+
+			if (!Settings::ParseGamelistOnly())
+			{
+				populateFolder(mRootFolder, fileMap, &scannedFolders);
+
+				if (!UIModeController::LoadEmptySystems())
+				{
+					if (mRootFolder->getChildren().size() == 0)
+						return;
+
+					if (mHidden && !Settings::HiddenSystemsShowGames())
+						return;
+				}
+			}
+
+			int scanTicks = SDL_GetTicks();
+
+			if (!Settings::IgnoreGamelist())
+				parseGamelist(this, fileMap);		
+
+			int gamelistTicks = SDL_GetTicks();
+
+			if (!Settings::IgnoreGamelist() && GamelistJournal::needsCompaction(this))
+				GamelistJournal::compactInBackground(this);
+
+			if (Settings::RemoveMultiDiskContent())
+				removeMultiDiskContent(fileMap);
+
+			int multiDiskTicks = SDL_GetTicks();
+
+			if (useSnapshot)
+				GamelistSnapshot::save(this, mRootFolder, scannedFolders);
+
+			LOG(LogInfo) << "Loaded system " << getName() << " in " << (SDL_GetTicks() - startTicks) << "ms (scan " << (scanTicks - startTicks) << "ms, gamelist " << (gamelistTicks - scanTicks) << "ms, multidisk " << (multiDiskTicks - gamelistTicks) << "ms, snapshot " << (SDL_GetTicks() - multiDiskTicks) << "ms)";
+		}
 	}
 	else
 	{
@@ -217,12 +268,16 @@ void SystemData::setIsGameSystemStatus()
 	mIsGameSystem = (mMetadata.name != "retropie" && mMetadata.name != "retrobat");
 }
 
-void SystemData::populateFolder(FolderData* folder, std::unordered_map<std::string, FileData*>& fileMap)
+void SystemData::populateFolder(FolderData* folder, std::unordered_map<std::string, FileData*>& fileMap, std::vector<std::string>* scannedFolders)
 {
 	const std::string& folderPath = folder->getPath();
 
 	if(!Utils::FileSystem::isDirectory(folderPath))
 		return;
+
+	if (scannedFolders != nullptr)
+		scannedFolders->push_back(folderPath);
+
 	/*
 	// [Obsolete] make sure that this isn't a symlink to a thing we already have
 	// Deactivated because it's slow & useless : users should to be carefull not to make recursive simlinks
@@ -242,9 +297,9 @@ void SystemData::populateFolder(FolderData* folder, std::unordered_map<std::stri
 	bool showHidden = Settings::ShowHiddenFiles();
 	bool preloadMedias = Settings::PreloadMedias();
 
-	auto shv = Settings::getInstance()->getString(getName() + ".ShowHiddenFiles");
-	if (shv == "1") showHidden = true;
-	else if (shv == "0") showHidden = false;
+	int shv = getShowHiddenFilesOverride();
+	if (shv == 1) showHidden = true;
+	else if (shv == 0) showHidden = false;
 
 	Utils::FileSystem::fileList dirContent = Utils::FileSystem::getDirectoryFiles(folderPath);
 	for (auto fileInfo : dirContent)
@@ -315,7 +370,7 @@ void SystemData::populateFolder(FolderData* folder, std::unordered_map<std::stri
 				continue;			
 
 			FolderData* newFolder = new FolderData(filePath, this);
-			populateFolder(newFolder, fileMap);
+			populateFolder(newFolder, fileMap, scannedFolders);
 
 			//ignore folders that do not contain games
 			if(newFolder->getChildren().size() == 0)
@@ -769,6 +824,8 @@ void SystemData::loadAdditionnalConfig(pugi::xml_node& srcSystems)
 //creates systems from information located in a config file
 bool SystemData::loadConfig(Window* window)
 {
+	TRACE_SCOPE("SystemData::loadConfig");
+
 	deleteSystems();
 	ThemeData::setDefaultTheme(nullptr);
 	UIModeController::getInstance(); // Init UIModeController before loading systems
@@ -826,28 +883,28 @@ bool SystemData::loadConfig(Window* window)
 
 	typedef SystemData* SystemDataPtr;
 
-	ThreadPool* pThreadPool = NULL;
+	TaskGroup* pTaskGroup = NULL;
 	SystemDataPtr* systems = NULL;
 
 	// Allow threaded loading only if processor threads > 1 so it does not apply on machines like Pi0.
 	if (std::thread::hardware_concurrency() > 1 && Settings::ThreadedLoading())
 	{
-		pThreadPool = new ThreadPool();
+		pTaskGroup = new TaskGroup();
 
 		systems = new SystemDataPtr[systemCount];
 		for (int i = 0; i < systemCount; i++)
 			systems[i] = nullptr;
 
-		pThreadPool->queueWorkItem([] { CollectionSystemManager::get()->loadCollectionSystems(); });
+		pTaskGroup->run([] { CollectionSystemManager::get()->loadCollectionSystems(); });
 	}
 
-	int processedSystem = 0;
+	std::atomic<int> processedSystem(0);
 
 	for (pugi::xml_node system = systemList.child("system"); system; system = system.next_sibling("system"))
 	{
-		if (pThreadPool != NULL)
+		if (pTaskGroup != NULL)
 		{
-			pThreadPool->queueWorkItem([system, currentSystem, systems, &processedSystem]
+			pTaskGroup->run([system, currentSystem, systems, &processedSystem]
 			{
 				systems[currentSystem] = loadSystem(system);
 				processedSystem++;
@@ -870,11 +927,11 @@ bool SystemData::loadConfig(Window* window)
 		currentSystem++;
 	}
 
-	if (pThreadPool != NULL)
+	if (pTaskGroup != NULL)
 	{
 		if (window != NULL)
 		{
-			pThreadPool->wait([window, &processedSystem, systemCount, &systemsNames]
+			pTaskGroup->wait([window, &processedSystem, systemCount, &systemsNames]
 			{
 				int px = processedSystem - 1;
 				if (px >= 0 && px < systemsNames.size())
@@ -882,7 +939,7 @@ bool SystemData::loadConfig(Window* window)
 			}, 50);
 		}
 		else
-			pThreadPool->wait();
+			pTaskGroup->wait();
 
 		for (int i = 0; i < systemCount; i++)
 		{
@@ -892,7 +949,7 @@ bool SystemData::loadConfig(Window* window)
 		}
 
 		delete[] systems;
-		delete pThreadPool;
+		delete pTaskGroup;
 
 		if (window != NULL)
 			window->renderSplashScreen(_("Collections"), systemCount == 0 ? 0 : currentSystem / systemCount);
@@ -1010,6 +1067,8 @@ std::map<std::string, std::string> SystemData::getKnownSystemNames()
 
 SystemData* SystemData::loadSystem(pugi::xml_node system, bool fullMode)
 {
+	TRACE_SCOPE_ARG("SystemData::loadSystem", system.child("name").text().get());
+
 	std::string path, cmd; // , name, fullname, themeFolder;
 
 	path = system.child("path").text().get();
@@ -1193,6 +1252,9 @@ bool SystemData::hasDirtySystems()
 
 void SystemData::deleteSystems()
 {
+	// A compaction may still be merging the journal of a system
+	GamelistJournal::waitForCompaction();
+
 	bool saveOnExit = !Settings::IgnoreGamelist() && Settings::SaveGamelistsOnExit();
 
 	for (unsigned int i = 0; i < sSystemVector.size(); i++)
@@ -1203,6 +1265,10 @@ void SystemData::deleteSystems()
 		if (saveOnExit && !pData->mIsCollectionSystem)
 			updateGamelist(pData);
 
+		// gamelist.xml must hold all the changes for the other programs
+		if (!Settings::IgnoreGamelist() && !pData->mIsCollectionSystem && Utils::FileSystem::exists(GamelistJournal::getJournalPath(pData)))
+			GamelistJournal::compact(pData);
+
 		delete pData;
 	}
 
@@ -1441,6 +1507,11 @@ GameCountInfo* SystemData::getGameCountInfo()
 	return mGameCount;*/
 }
 
+void SystemData::onGamesChanged()
+{
+	mGamesVersion = ++sGamesVersion;
+}
+
 void SystemData::updateDisplayedGameCount()
 {
 	if (mGameCountInfo != nullptr)
@@ -1451,6 +1522,8 @@ void SystemData::updateDisplayedGameCount()
 
 void SystemData::loadTheme()
 {
+	TRACE_SCOPE_ARG("SystemData::loadTheme", getName());
+
 	mTheme = std::make_shared<ThemeData>();
 
 	std::string path = getThemePath();
@@ -1984,6 +2057,16 @@ bool SystemData::getBoolSetting(const std::string& settingName)
 	return show;
 }
 
+int SystemData::getShowHiddenFilesOverride()
+{
+	return mShowHiddenFilesSetting->getOverride();
+}
+
+std::shared_ptr<const std::vector<std::string>> SystemData::getHiddenExtensions()
+{
+	return mHiddenExtSetting->get();
+}
+
 bool SystemData::getShowParentFolder()
 {
 	return getBoolSetting("ShowParentFolder");
@@ -1994,9 +2077,11 @@ std::string SystemData::getFolderViewMode()
 	if (this == CollectionSystemManager::get()->getCustomCollectionsBundle())
 		return "always";
 
-	std::string showFoldersMode = Settings::getInstance()->getString("FolderViewMode");
+	static StringSetting* folderViewMode = SettingsRegistry::getString("FolderViewMode");
+
+	std::string showFoldersMode = *folderViewMode->get();
 
-	auto fvm = Settings::getInstance()->getString(getName() + ".FolderViewMode");
+	auto fvm = *mFolderViewModeSetting->get();
 	if (!fvm.empty() && fvm != "auto") 
 		showFoldersMode = fvm;
 
@@ -4,6 +4,7 @@
 
 #include "PlatformId.h"
 #include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -24,6 +25,8 @@ class FolderData;
 class ThemeData;
 class Window;
 class SaveStateRepository;
+class StringSetting;
+class ListSetting;
 
 struct GameCountInfo
 {
@@ -160,6 +163,10 @@ public:
 	void setGamelistHash(size_t size) { mGameListHash = size; }
 	size_t getGamelistHash() { return mGameListHash; }
 
+	// Changes when games are added to or removed from the folders of the system. Never reused, even by another system at the same address
+	unsigned int getGamesVersion() { return mGamesVersion; }
+	void onGamesChanged();
+
 	bool isNetplaySupported();
 	bool isCheevosSupported();
 
@@ -206,6 +213,11 @@ public:
 	std::string getFolderViewMode();
 	bool getBoolSetting(const std::string& settingName);
 
+	// Value of <system>.ShowHiddenFiles : 1 or 0 when it overrides the global setting, -1 otherwise
+	int getShowHiddenFilesOverride();
+	// <system>.HiddenExt, in lower case & without the dot
+	std::shared_ptr<const std::vector<std::string>> getHiddenExtensions();
+
 	static void resetSettings();
 
 	SaveStateRepository* getSaveStateRepository();
@@ -218,7 +230,8 @@ private:
 	std::string getKeyboardMappingFilePath();
 	static void createGroupedSystems();
 
-	size_t mGameListHash;
+	std::atomic<size_t> mGameListHash;
+	std::atomic<unsigned int> mGamesVersion;
 
 	bool mIsCollectionSystem;
 	bool mIsGameSystem;
@@ -231,7 +244,7 @@ private:
 	SystemEnvironmentData* mEnvData;
 	std::shared_ptr<ThemeData> mTheme;
 
-	void populateFolder(FolderData* folder, std::unordered_map<std::string, FileData*>& fileMap);
+	void populateFolder(FolderData* folder, std::unordered_map<std::string, FileData*>& fileMap, std::vector<std::string>* scannedFolders = nullptr);
 	void indexAllGameFilters(const FolderData* folder);
 	void setIsGameSystemStatus();
 	void removeMultiDiskContent(std::unordered_map<std::string, FileData*>& fileMap);
@@ -251,6 +264,10 @@ private:
 	
 	std::shared_ptr<bool> mShowFilenames;
 
+	StringSetting* mShowHiddenFilesSetting;
+	StringSetting* mFolderViewModeSetting;
+	ListSetting* mHiddenExtSetting;
+
 	GameCountInfo* mGameCountInfo;
 	SaveStateRepository* mSaveRepository;
 
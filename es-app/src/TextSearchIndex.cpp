@@ -0,0 +1,176 @@
+#include "TextSearchIndex.h"
+
+#include "FileData.h"
+#include "MetaData.h"
+#include <algorithm>
+#include <iterator>
+
+static inline unsigned char foldAscii(char c)
+{
+	return (c >= 'a' && c <= 'z') ? (unsigned char)(c - 0x20) : (unsigned char)c;
+}
+
+static inline unsigned int getTrigram(const std::string& text, size_t pos)
+{
+	return ((unsigned int)(unsigned char)text[pos] << 16) | ((unsigned int)(unsigned char)text[pos + 1] << 8) | (unsigned int)(unsigned char)text[pos + 2];
+}
+
+static std::string foldText(const std::string& text)
+{
+	std::string ret = text;
+	for (auto& c : ret)
+		c = (char)foldAscii(c);
+
+	return ret;
+}
+
+TextSearchIndex::TextSearchIndex() : mDirty(true), mSeenChangeCount(0), mVersion(0)
+{
+}
+
+void TextSearchIndex::add(FileData* file)
+{
+	if (mFiles.insert(file).second)
+	{
+		mDirty = true;
+		mVersion++;
+	}
+}
+
+void TextSearchIndex::remove(FileData* file)
+{
+	if (mFiles.erase(file) > 0)
+	{
+		mDirty = true;
+		mVersion++;
+	}
+}
+
+void TextSearchIndex::clear()
+{
+	mFiles.clear();
+	mEntries.clear();
+	mTrigrams.clear();
+	mDirty = true;
+	mVersion++;
+}
+
+unsigned int TextSearchIndex::getVersion()
+{
+	// Names may have changed
+	unsigned int changeCount = MetaDataList::getChangeCount();
+	if (mSeenChangeCount != changeCount)
+	{
+		mSeenChangeCount = changeCount;
+		mDirty = true;
+		mVersion++;
+	}
+
+	return mVersion;
+}
+
+void TextSearchIndex::ensureBuilt()
+{
+	getVersion();
+	if (!mDirty)
+		return;
+
+	mEntries.clear();
+	mTrigrams.clear();
+
+	mEntries.reserve(mFiles.size());
+	for (auto file : mFiles)
+		mEntries.push_back({ file, foldText(file->getSourceFileData()->getName()) });
+
+	std::vector<unsigned int> trigrams;
+
+	for (int id = 0; id < (int)mEntries.size(); id++)
+	{
+		const std::string& name = mEntries[id].name;
+		if (name.size() < 3)
+			continue;
+
+		trigrams.clear();
+		for (size_t i = 0; i + 2 < name.size(); i++)
+			trigrams.push_back(getTrigram(name, i));
+
+		std::sort(trigrams.begin(), trigrams.end());
+		trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+		// Ids are increasing : posting lists stay sorted
+		for (auto trigram : trigrams)
+			mTrigrams[trigram].push_back(id);
+	}
+
+	mDirty = false;
+}
+
+// Returns false if the text can't be searched with trigrams
+bool TextSearchIndex::findCandidates(const std::string& text, std::vector<int>& ids)
+{
+	if (text.size() < 3)
+		return false;
+
+	for (auto c : text)
+		if ((c & 0x80) != 0)
+			return false;
+
+	std::string folded = foldText(text);
+
+	std::vector<const std::vector<int>*> postings;
+	for (size_t i = 0; i + 2 < folded.size(); i++)
+	{
+		auto it = mTrigrams.find(getTrigram(folded, i));
+		if (it == mTrigrams.cend())
+			return true; // No name has this trigram
+
+		postings.push_back(&it->second);
+	}
+
+	// Intersect from the shortest list
+	std::sort(postings.begin(), postings.end(), [](const std::vector<int>* a, const std::vector<int>* b) { return a->size() < b->size(); });
+
+	std::vector<int> current = *postings[0];
+	std::vector<int> next;
+
+	for (size_t i = 1; i < postings.size() && !current.empty(); i++)
+	{
+		next.clear();
+		std::set_intersection(current.begin(), current.end(), postings[i]->begin(), postings[i]->end(), std::back_inserter(next));
+		current.swap(next);
+	}
+
+	// Trigrams can be found in any order : check the whole text
+	for (auto id : current)
+		if (mEntries[id].name.find(folded) != std::string::npos)
+			ids.push_back(id);
+
+	return true;
+}
+
+void TextSearchIndex::findCandidates(const std::vector<std::string>& texts, std::vector<FileData*>& candidates)
+{
+	ensureBuilt();
+
+	std::vector<int> ids;
+
+	for (auto& text : texts)
+	{
+		if (!findCandidates(text, ids))
+		{
+			getFiles(candidates);
+			return;
+		}
+	}
+
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+	for (auto id : ids)
+		candidates.push_back(mEntries[id].file);
+}
+
+void TextSearchIndex::getFiles(std::vector<FileData*>& files)
+{
+	files.insert(files.end(), mFiles.cbegin(), mFiles.cend());
+}
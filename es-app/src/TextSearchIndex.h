@@ -0,0 +1,55 @@
+#pragma once
+#ifndef ES_APP_TEXT_SEARCH_INDEX_H
+#define ES_APP_TEXT_SEARCH_INDEX_H
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class FileData;
+
+// Trigram index over the names of the games of a FileFilterIndex, to find the games which name may contain a text without testing every name.
+// Names are read again when metadata changed since the index was built.
+class TextSearchIndex
+{
+public:
+	TextSearchIndex();
+
+	void add(FileData* file);
+	void remove(FileData* file);
+	void clear();
+
+	bool contains(FileData* file) const { return mFiles.find(file) != mFiles.cend(); }
+
+	// Increases when files are added or removed, or when the index is rebuilt after a metadata change
+	unsigned int getVersion();
+
+	// Indexed files which name contains one of the texts, ignoring ASCII case like Utils::String::containsIgnoreCase.
+	// Texts shorter than a trigram or with non ASCII characters can't use the index : every file is returned.
+	void findCandidates(const std::vector<std::string>& texts, std::vector<FileData*>& candidates);
+
+	// Every indexed file
+	void getFiles(std::vector<FileData*>& files);
+
+private:
+	struct Entry
+	{
+		FileData* file;
+		std::string name; // ASCII upper-cased
+	};
+
+	void ensureBuilt();
+	bool findCandidates(const std::string& text, std::vector<int>& ids);
+
+	std::unordered_set<FileData*> mFiles;
+
+	std::vector<Entry> mEntries;
+	std::unordered_map<unsigned int, std::vector<int>> mTrigrams; // sorted entry ids by trigram
+
+	bool mDirty;
+	unsigned int mSeenChangeCount;
+	unsigned int mVersion;
+};
+
+#endif // ES_APP_TEXT_SEARCH_INDEX_H
@@ -4,6 +4,7 @@
 #include "components/AsyncNotificationComponent.h"
 #include "guis/GuiMsgBox.h"
 #include "Gamelist.h"
+#include "HashCache.h"
 #include "RetroAchievements.h"
 #include "SystemConf.h"
 #include "SystemData.h"
@@ -11,6 +12,7 @@
 #include "ApiSystem.h"
 #include "utils/StringUtil.h"
 #include "Log.h"
+#include "Tracer.h"
 #include <unordered_set>
 #include <queue>
 
@@ -65,6 +67,8 @@ ThreadedHasher::~ThreadedHasher()
 	mWndNotification->close();
 	mWndNotification = nullptr;
 
+	HashCache::flush();
+
 	ThreadedHasher::mInstance = nullptr;
 }
 
@@ -84,6 +88,8 @@ void ThreadedHasher::updateUI(const std::string label)
 
 void ThreadedHasher::run()
 {
+	Tracer::setThreadName("Hasher");
+
 	std::unique_lock<std::mutex> lock(mLoaderLock);
 
 	bool cheevos = ((mType & HASH_CHEEVOS_MD5) == HASH_CHEEVOS_MD5);
@@ -111,17 +117,15 @@ void ThreadedHasher::run()
 			}
 		}		
 
-		if (netplay)
+		LOG(LogDebug) << "CheckHashes : " << label;
+
 		{
-			LOG(LogDebug) << "CheckCrc32 : " << label;
-			game->checkCrc32(mForce);
+			TRACE_SCOPE_ARG("ThreadedHasher::checkHashes", game->getPath());
+			game->checkHashes(netplay, cheevos, mForce);
 		}
 
 		if (cheevos)
 		{
-			LOG(LogDebug) << "CheckCheevosHash : " << label;
-			game->checkCheevosHash(mForce);
-
 			auto hash = Utils::String::toUpper(game->getMetadata(MetaDataId::CheevosHash));
 			if (!hash.empty())
 			{
@@ -347,11 +347,11 @@ void GuiImageViewer::loadPdf(const std::string& imagePath)
 	
 	if (pages > INITIALPAGES)
 	{
-		mPdfThreads = new Utils::ThreadPool(1);
+		mPdfThreads = new Utils::TaskGroup();
 
 		for (int i = INITIALPAGES; i < pages; i += PAGESPERTHREAD)
 		{
-			mPdfThreads->queueWorkItem([this, imagePath, window, i]
+			mPdfThreads->run([this, imagePath, window, i]
 			{
 				auto fl = ApiSystem::getInstance()->extractPdfImages(imagePath, i + 1, PAGESPERTHREAD);
 				if (fl.size() == 0 || !g_isGuiImageViewerRunning)
@@ -371,8 +371,6 @@ void GuiImageViewer::loadPdf(const std::string& imagePath)
 				});
 			});
 		}
-
-		mPdfThreads->start();
 	}
 	
 	window->pushGui(new GuiLoading<std::vector<std::string>>(window, _("Loading..."),
@@ -489,12 +487,12 @@ void GuiImageViewer::loadCbz(const std::string& imagePath)
 
 	if (pages > INITIALPAGES)
 	{
-		mPdfThreads = new Utils::ThreadPool(1);
+		mPdfThreads = new Utils::TaskGroup();
 
 		for (int i = INITIALPAGES; i < pages; i += PAGESPERTHREAD)
 		{
 			auto fileToExtract = files[i];
-			mPdfThreads->queueWorkItem([this, imagePath, fileToExtract, window, i]
+			mPdfThreads->run([this, imagePath, fileToExtract, window, i]
 			{
 				auto localFile = _extractZipFile(imagePath, fileToExtract);
 				if (localFile.empty() || !g_isGuiImageViewerRunning)
@@ -510,8 +508,6 @@ void GuiImageViewer::loadCbz(const std::string& imagePath)
 				});
 			});
 		}
-
-		mPdfThreads->start();
 	}
 
 	window->pushGui(new GuiLoading<std::vector<std::string>>(window, _("Loading..."),
@@ -553,7 +549,7 @@ GuiImageViewer::~GuiImageViewer()
 
 	if (mPdfThreads != nullptr)
 	{
-		mPdfThreads->stop();
+		mPdfThreads->cancel();
 		delete mPdfThreads;
 	}
 
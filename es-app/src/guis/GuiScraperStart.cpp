@@ -52,10 +52,10 @@ GuiScraperStart::GuiScraperStart(Window* window)
 	auto isOlderThan = [now](const std::string& scraper, FileData* f, int days)
 	{
 		auto date = f->getMetadata().getScrapeDate(scraper);
-		if (date == nullptr || !date->isValid())
+		if (!date.isValid())
 			return true;
 
-		return date->getTime() <= (now - (days * 86400));
+		return date.getTime() <= (now - (days * 86400));
 	};
 
 //	int idx = Settings::RecentlyScrappedFilter();
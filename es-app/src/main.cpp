@@ -10,8 +10,10 @@
 #include "EmulationStation.h"
 #include "InputManager.h"
 #include "Log.h"
+#include "Tracer.h"
 #include "MameNames.h"
 #include "Genres.h"
+#include "GamelistBenchmark.h"
 #include "utils/Platform.h"
 #include "PowerSaver.h"
 #include "Settings.h"
@@ -29,6 +31,7 @@
 #include "NetworkThread.h"
 #include "scrapers/ThreadedScraper.h"
 #include "ThreadedHasher.h"
+#include "HashCache.h"
 #include <FreeImage.h>
 #include "ImageIO.h"
 #include "components/VideoVlcComponent.h"
@@ -49,6 +52,9 @@
 
 static std::string gPlayVideo;
 static int gPlayVideoDuration = 0;
+static int gGamelistBenchmark = 0;
+static bool gTrace = false;
+static std::string gTracePath;
 static bool enable_startup_game = true;
 
 bool parseArgs(int argc, char* argv[])
@@ -84,6 +90,24 @@ bool parseArgs(int argc, char* argv[])
 			gPlayVideo = argv[i + 1];
 			i++; // skip the argument value
 		}
+		else if (strcmp(argv[i], "--benchmark-gamelist") == 0)
+		{
+			gGamelistBenchmark = 50000;
+			if (i < argc - 1 && atoi(argv[i + 1]) > 0)
+			{
+				gGamelistBenchmark = atoi(argv[i + 1]);
+				i++; // skip the argument value
+			}
+		}
+		else if (strcmp(argv[i], "--trace") == 0)
+		{
+			gTrace = true;
+			if (i < argc - 1 && argv[i + 1][0] != '-')
+			{
+				gTracePath = argv[i + 1];
+				i++; // skip the argument value
+			}
+		}
 		else if (strcmp(argv[i], "--monitor") == 0)
 		{
 			if (i >= argc - 1)
@@ -247,6 +271,8 @@ bool parseArgs(int argc, char* argv[])
 				"--force-kiosk		Force the UI mode to be Kiosk\n"
 				"--force-disable-filters		Force the UI to ignore applied filters in gamelist\n"
 				"--home [path]		Directory to use as home path\n"
+				"--benchmark-gamelist [count]	time gamelist parsing on a synthetic gamelist (50000 games by default) and exit\n"
+				"--trace [file]			record a performance trace (chrome://tracing or ui.perfetto.dev), written on exit to es_trace.json by default\n"
 				"--help, -h			summon a sentient, angry tuba\n\n"
 				"--monitor [index]			monitor index\n\n"				
 				"More information available in README.md.\n";
@@ -308,6 +334,9 @@ bool loadSystemConfigFile(Window* window, const char** errorString)
 //called on exit, assuming we get far enough to have the log initialized
 void onExit()
 {
+	// Exits that don't go through the end of main, like quitES
+	HashCache::flush();
+	Tracer::stop();
 	Log::close();
 }
 
@@ -515,6 +544,12 @@ int main(int argc, char* argv[])
 	//always close the log on exit
 	atexit(&onExit);
 
+	if (gTrace)
+	{
+		Tracer::start(gTracePath.empty() ? Paths::getUserEmulationStationPath() + "/es_trace.json" : gTracePath);
+		Tracer::setThreadName("Main");
+	}
+
 	// Set locale
 	setLocale(argv[0]);	
 
@@ -531,6 +566,12 @@ int main(int argc, char* argv[])
 	Genres::init();
 	MetaDataList::initMetadata();
 
+	if (gGamelistBenchmark > 0)
+	{
+		runGamelistBenchmark(gGamelistBenchmark);
+		return 0;
+	}
+
 	Window window;
 	SystemScreenSaver screensaver(&window);
 	ViewController::init(&window);
@@ -730,8 +771,7 @@ int main(int argc, char* argv[])
 */
 
 		Renderer::swapBuffers();
-
-		Log::flush();
+		TRACE_FRAME();
 	}
 
 	if (Utils::Platform::isFastShutdown())
@@ -750,6 +790,7 @@ int main(int argc, char* argv[])
 		window.renderSplashScreen(_("SAVING METADATAS. PLEASE WAIT..."));
 
 	ImageIO::saveImageCache();
+	HashCache::flush();
 	MameNames::deinit();
 	ViewController::saveState();
 	CollectionSystemManager::deinit();
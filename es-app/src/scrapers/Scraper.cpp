@@ -354,15 +354,17 @@ void ScraperHttpRequest::update()
 	setError(Utils::String::removeHtmlTags(mRequest->getErrorMsg()));
 }
 
-std::unique_ptr<MDResolveHandle> ScraperSearchResult::resolveMetaDataAssets(const ScraperSearchParams& search)
+std::unique_ptr<MDResolveHandle> ScraperSearchResult::resolveMetaDataAssets(const ScraperSearchParams& search, bool deferResize)
 {
-	return std::unique_ptr<MDResolveHandle>(new MDResolveHandle(*this, search));
+	return std::unique_ptr<MDResolveHandle>(new MDResolveHandle(*this, search, deferResize));
 }
 
 // metadata resolving stuff
-MDResolveHandle::MDResolveHandle(const ScraperSearchResult& result, const ScraperSearchParams& search) : mResult(result)
+MDResolveHandle::MDResolveHandle(const ScraperSearchResult& result, const ScraperSearchParams& search, bool deferResize) : mResult(result)
 {
 	mPercent = -1;
+	mDeferResize = deferResize;
+	mDownloadedBytes = 0;
 
 	bool overWriteMedias = Settings::getInstance()->getBool("ScrapeOverWrite") && search.overWriteMedias;
 
@@ -416,14 +418,23 @@ MDResolveHandle::MDResolveHandle(const ScraperSearchResult& result, const Scrape
 		mFuncs.push_back(new ResolvePair(
 			[this, url, resourcePath, resize] 
 			{ 
-				return downloadImageAsync(url.second.url, resourcePath, resize); 
+				auto handle = downloadImageAsync(url.second.url, resourcePath, resize); 
+				handle->setDeferResize(mDeferResize);
+				return handle;
 			},
 			[this, url](ImageDownloadHandle* result)
 			{
 				auto finalFile = result->getImageFileName();
 
-				if (Utils::FileSystem::getFileSize(finalFile) > 0)
+				auto size = Utils::FileSystem::getFileSize(finalFile);
+				if (size > 0)
+				{
 					mResult.mdl.set(url.first, finalFile);
+					mDownloadedBytes += (long long)size;
+
+					if (result->needsResize())
+						mPendingResizes.push_back({ finalFile, result->getMaxWidth(), result->getMaxHeight() });
+				}
 
 				if (mResult.urls.find(url.first) != mResult.urls.cend())
 					mResult.urls[url.first].url = "";
@@ -498,6 +509,8 @@ std::unique_ptr<ImageDownloadHandle> MDResolveHandle::downloadImageAsync(const s
 ImageDownloadHandle::ImageDownloadHandle(const std::string& url, const std::string& path, int maxWidth, int maxHeight) : 
 	mSavePath(path), mMaxWidth(maxWidth), mMaxHeight(maxHeight)
 {
+	mDeferResize = false;
+	mNeedsResize = false;
 	mRetryCount = 0;
 	mOverQuotaPendingTime = 0;
 	mOverQuotaRetryDelay = OVERQUOTA_RETRY_DELAY;
@@ -631,8 +644,13 @@ void ImageDownloadHandle::update()
 		// It's an image ?
 		if (mSavePath.find("-fanart") == std::string::npos && mSavePath.find("-bezel") == std::string::npos && mSavePath.find("-map") == std::string::npos && (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" || ext == ".gif"))
 		{
-			try { resizeImage(mSavePath, mMaxWidth, mMaxHeight); }
-			catch(...) { }
+			if (mDeferResize)
+				mNeedsResize = (mMaxWidth > 0 || mMaxHeight > 0);
+			else
+			{
+				try { resizeImage(mSavePath, mMaxWidth, mMaxHeight); }
+				catch (...) {}
+			}
 		}
 	}
 
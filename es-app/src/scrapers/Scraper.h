@@ -68,7 +68,15 @@ struct ScraperSearchResult
 		return false;
 	}
 
-	std::unique_ptr<MDResolveHandle> resolveMetaDataAssets(const ScraperSearchParams& search);
+	std::unique_ptr<MDResolveHandle> resolveMetaDataAssets(const ScraperSearchParams& search, bool deferResize = false);
+};
+
+// Downloaded image which resizing was left to the caller
+struct ScraperImageResize
+{
+	std::string path;
+	int maxWidth;
+	int maxHeight;
 };
 
 class ScraperRequest : public AsyncHandle
@@ -137,9 +145,18 @@ public:
 	virtual int getPercent();
 	std::string getImageFileName() { return mSavePath; }
 
+	// The downloaded image is not resized by update() : needsResize tells if resizeImage must be called
+	void setDeferResize(bool value) { mDeferResize = value; }
+	bool needsResize() { return mNeedsResize; }
+	int getMaxWidth() { return mMaxWidth; }
+	int getMaxHeight() { return mMaxHeight; }
+
 private:
 	HttpReq* mRequest;
 
+	bool mDeferResize;
+	bool mNeedsResize;
+
 	int	mRetryCount;
 	int mOverQuotaPendingTime;
 	int mOverQuotaRetryDelay;
@@ -155,7 +172,7 @@ private:
 class MDResolveHandle : public AsyncHandle
 {
 public:
-	MDResolveHandle(const ScraperSearchResult& result, const ScraperSearchParams& search);
+	MDResolveHandle(const ScraperSearchResult& result, const ScraperSearchParams& search, bool deferResize = false);
 
 	void update() override;
 	inline const ScraperSearchResult& getResult() const { return mResult; } //  assert(mStatus == ASYNC_DONE); -> FCA : Why ???
@@ -172,6 +189,10 @@ public:
 		return mPercent;
 	}
 
+	// Images to resize when the handle was created with deferResize
+	const std::vector<ScraperImageResize>& getPendingResizes() { return mPendingResizes; }
+	long long getDownloadedBytes() { return mDownloadedBytes; }
+
 	std::unique_ptr<ImageDownloadHandle> downloadImageAsync(const std::string& url, const std::string& saveAs, bool resize = true);
 
 private:
@@ -207,6 +228,10 @@ private:
 	std::string mCurrentItem;
 	std::string mSource;
 	int mPercent;
+
+	bool mDeferResize;
+	std::vector<ScraperImageResize> mPendingResizes;
+	long long mDownloadedBytes;
 };
 
 class Scraper
@@ -6,9 +6,16 @@
 #include "guis/GuiMsgBox.h"
 #include "Gamelist.h"
 #include "Log.h"
+#include "Tracer.h"
+#include <SDL_timer.h>
+#include <algorithm>
 
 #define GUIICON _U("\uF03E ")
 
+// Items waiting between two stages, per worker of the next stage
+#define PIPELINE_QUEUE_FACTOR	2
+#define STATISTICS_LOG_DELAY	30000
+
 ThreadedScraper* ThreadedScraper::mInstance = nullptr;
 bool ThreadedScraper::mPaused = false;
 
@@ -17,21 +24,33 @@ ThreadedScraper::ThreadedScraper(Window* window, const std::queue<ScraperSearchP
 {
 	mExitCode = ASYNC_IN_PROGRESS;
 	mTotal = (int) mSearchQueue.size();
+	mResizing = 0;
+	mGamesDone = 0;
+	mDownloadedBytes = 0;
+	mStartTime = SDL_GetTicks();
+	mLastStatisticsTime = mStartTime;
+
+	// Resizing is cpu bound, unlike the network stages
+	mResizeThreadCount = std::max(1, (int)std::thread::hardware_concurrency() / 2);
 
 	mWndNotification = mWindow->createAsyncNotificationComponent();
 	mWndNotification->updateTitle(GUIICON + _("SCRAPING"));
 
 	for (int i = 0; i < threadCount; i++)
+	{
+		mScraperThreads.push_back(new ScraperThread(i));
+		mMediaThreads.push_back(new ScraperMediaThread(i));
+	}
+
+	for (auto thread : mScraperThreads)
 	{
 		if (mSearchQueue.size() == 0)
 			break;
 
-		ScraperThread* thread = new ScraperThread(i);
-		mScraperThreads.push_back(thread);
 		ProcessNextGame(thread);
-	}	
+	}
 
-	mHandle = new std::thread(&ThreadedScraper::run, this);	
+	mHandle = new std::thread(&ThreadedScraper::run, this);
 }
 
 void ThreadedScraper::ProcessNextGame(ScraperThread* thread)
@@ -57,6 +76,11 @@ ThreadedScraper::~ThreadedScraper()
 
 	mScraperThreads.clear();
 
+	for (auto mediaThread : mMediaThreads)
+		delete mediaThread;
+
+	mMediaThreads.clear();
+
 	ThreadedScraper::mInstance = nullptr;
 }
 
@@ -68,6 +92,7 @@ std::string ThreadedScraper::formatGameName(FileData* game)
 ScraperThread::ScraperThread(int threadId)
 {
 	mThreadId = threadId;
+	mRunning = false;
 	mErrorStatus = 0;
 	mStatus = ASYNC_IN_PROGRESS;
 }
@@ -75,11 +100,11 @@ ScraperThread::ScraperThread(int threadId)
 void ScraperThread::run(const ScraperSearchParams& params)
 {
 	mResult = ScraperSearchResult();
+	mRunning = true;
 	mErrorStatus = 0;
 	mStatusString = "";
 	mStatus = ASYNC_IN_PROGRESS;
 	mSearch = params;
-	mMDResolveHandle.reset();
 
 	mSearchHandle = Scraper::getScraper()->search(params);
 }
@@ -100,12 +125,7 @@ int ScraperThread::updateState()
 		if (status == ASYNC_DONE)
 		{
 			if (results.size() > 0)
-			{
-				if (results[0].hasMedia())
-					mMDResolveHandle = results[0].resolveMetaDataAssets(mSearch);
-				else
-					acceptResult(results[0]);
-			}
+				acceptResult(results[0]);
 			else
 			{
 				mStatus = ASYNC_DONE;
@@ -116,21 +136,57 @@ int ScraperThread::updateState()
 			processError(httpCode, statusString);
 	}
 
+	return mStatus;
+}
+
+ScraperMediaThread::ScraperMediaThread(int threadId)
+{
+	mThreadId = threadId;
+	mRunning = false;
+	mErrorStatus = 0;
+	mDownloadedBytes = 0;
+	mStatus = ASYNC_IN_PROGRESS;
+}
+
+void ScraperMediaThread::run(const ScraperPipelineItem& item)
+{
+	mItem = item;
+	mRunning = true;
+	mErrorStatus = 0;
+	mDownloadedBytes = 0;
+	mStatusString = "";
+	mStatus = ASYNC_IN_PROGRESS;
+
+	mMDResolveHandle = mItem.result.resolveMetaDataAssets(mItem.search, true);
+}
+
+int ScraperMediaThread::updateState()
+{
 	if (mMDResolveHandle && mMDResolveHandle->status() != ASYNC_IN_PROGRESS)
 	{
 		auto status = mMDResolveHandle->status();
-		auto result = mMDResolveHandle->getResult();
 		auto statusString = mMDResolveHandle->getStatusString();
 		auto httpCode = mMDResolveHandle->getErrorCode();
 
 		LOG(LogInfo) << "[Thread " << mThreadId << "] ResolveResponse : " << statusString;
 
-		mMDResolveHandle.reset();
+		mDownloadedBytes = mMDResolveHandle->getDownloadedBytes();
 
 		if (status == ASYNC_DONE)
-			acceptResult(result);
+		{
+			mItem.result = mMDResolveHandle->getResult();
+			mItem.resizes = mMDResolveHandle->getPendingResizes();
+			mStatus = ASYNC_DONE;
+			mErrorStatus = 0;
+		}
 		else if (status == ASYNC_ERROR)
-			processError(httpCode, statusString);
+		{
+			mStatus = ASYNC_ERROR;
+			mErrorStatus = httpCode;
+			mStatusString = statusString;
+		}
+
+		mMDResolveHandle.reset();
 	}
 
 	return mStatus;
@@ -138,7 +194,7 @@ int ScraperThread::updateState()
 
 void ThreadedScraper::processError(int status, const std::string statusString)
 {
-	if (status == HttpReq::REQ_430_TOOMANYSCRAPS || status == HttpReq::REQ_430_TOOMANYFAILURES || 
+	if (status == HttpReq::REQ_430_TOOMANYSCRAPS || status == HttpReq::REQ_430_TOOMANYFAILURES ||
 		status == HttpReq::REQ_426_BLACKLISTED || status == HttpReq::REQ_FILESTREAM_ERROR || status == HttpReq::REQ_426_SERVERMAINTENANCE ||
 		status == HttpReq::REQ_403_BADLOGIN || status == HttpReq::REQ_401_FORBIDDEN)
 	{
@@ -150,8 +206,151 @@ void ThreadedScraper::processError(int status, const std::string statusString)
 		mErrors.push_back(statusString);
 }
 
+// Search stage : results with medias go to the media queue, unless it's full
+bool ThreadedScraper::updateSearches()
+{
+	bool changed = false;
+
+	for (auto thread : mScraperThreads)
+	{
+		if (mExitCode != ASYNC_IN_PROGRESS)
+			break;
+
+		if (thread->isRunning())
+		{
+			int state = thread->updateState();
+			if (state == ASYNC_IN_PROGRESS)
+				continue;
+
+			thread->setIdle();
+			changed = true;
+
+			if (state == ASYNC_ERROR)
+			{
+				processError(thread->getError(), thread->getErrorString());
+				mGamesDone++;
+			}
+			else if (thread->getResult().hasMedia())
+				mMediaQueue.push({ thread->getSearchParams(), thread->getResult() });
+			else
+			{
+				acceptResult(thread->getSearchParams(), thread->getResult());
+				mGamesDone++;
+			}
+		}
+
+		if (mExitCode == ASYNC_IN_PROGRESS && !mSearchQueue.empty() && mMediaQueue.size() < mMediaThreads.size() * PIPELINE_QUEUE_FACTOR)
+		{
+			ProcessNextGame(thread);
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+// Media fetch stage : downloaded images go to the resize queue, unless it's full
+bool ThreadedScraper::updateMedias()
+{
+	bool changed = false;
+
+	for (auto thread : mMediaThreads)
+	{
+		if (mExitCode != ASYNC_IN_PROGRESS)
+			break;
+
+		if (thread->isRunning())
+		{
+			int state = thread->updateState();
+			if (state == ASYNC_IN_PROGRESS)
+				continue;
+
+			thread->setIdle();
+			changed = true;
+
+			mDownloadedBytes += thread->getDownloadedBytes();
+
+			auto& item = thread->getItem();
+
+			if (state == ASYNC_ERROR)
+			{
+				processError(thread->getError(), thread->getErrorString());
+				mGamesDone++;
+			}
+			else if (item.resizes.size() > 0)
+				mResizeQueue.push(item);
+			else
+			{
+				acceptResult(item.search, item.result);
+				mGamesDone++;
+			}
+		}
+
+		if (mExitCode == ASYNC_IN_PROGRESS && !mMediaQueue.empty() && mResizeQueue.size() < (size_t)(mResizeThreadCount * PIPELINE_QUEUE_FACTOR))
+		{
+			thread->run(mMediaQueue.front());
+			mMediaQueue.pop();
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+// Resize stage, on the task scheduler, then gamelist update
+bool ThreadedScraper::updateResizes()
+{
+	bool changed = false;
+
+	std::queue<ScraperPipelineItem> resized;
+
+	{
+		std::unique_lock<std::mutex> lock(mResizedLock);
+		resized.swap(mResizedItems);
+	}
+
+	while (!resized.empty())
+	{
+		auto& item = resized.front();
+
+		mResizing--;
+		mGamesDone++;
+
+		if (mExitCode == ASYNC_IN_PROGRESS)
+			acceptResult(item.search, item.result);
+
+		resized.pop();
+		changed = true;
+	}
+
+	while (mExitCode == ASYNC_IN_PROGRESS && mResizing < mResizeThreadCount && !mResizeQueue.empty())
+	{
+		auto item = mResizeQueue.front();
+		mResizeQueue.pop();
+		mResizing++;
+
+		mResizeGroup.run([this, item]
+		{
+			for (auto& resize : item.resizes)
+			{
+				try { resizeImage(resize.path, resize.maxWidth, resize.maxHeight); }
+				catch (...) {}
+			}
+
+			std::unique_lock<std::mutex> lock(mResizedLock);
+			mResizedItems.push(item);
+		});
+
+		changed = true;
+	}
+
+	return changed;
+}
+
 void ThreadedScraper::run()
 {
+	Tracer::setThreadName("Scraper");
+
 	while (mExitCode == ASYNC_IN_PROGRESS)
 	{
 		if (mPaused)
@@ -162,49 +361,47 @@ void ThreadedScraper::run()
 				std::this_thread::sleep_for(std::chrono::milliseconds(500));
 			}
 		}
-		
-		for (auto iter = mScraperThreads.cbegin(); iter != mScraperThreads.cend(); ++iter)
-		{
-			if (mExitCode != ASYNC_IN_PROGRESS)
-				break;
 
-			auto mScraperThread = *iter;
+		// Last stages first : they free room in the queues the previous stages are waiting for
+		bool changed = updateResizes();
+		changed = updateMedias() || changed;
+		changed = updateSearches() || changed;
 
-			int state = mScraperThread->updateState();
-			switch (state)
-			{
-			case ASYNC_DONE:
-				acceptResult(*mScraperThread);
-				break;
-
-			case ASYNC_ERROR:
-				processError(mScraperThread->getError(), mScraperThread->getErrorString());
-				break;
-
-			default:
-				//std::this_thread::yield();
-				// std::this_thread::sleep_for(std::chrono::milliseconds(10));
-				break;
-			}
+		if (mExitCode != ASYNC_IN_PROGRESS)
+			break;
 
-			if (mExitCode == ASYNC_IN_PROGRESS && state != ASYNC_IN_PROGRESS)
-			{
-				if (!mSearchQueue.empty())
-					ProcessNextGame(mScraperThread);
-				else
-				{					
-					mScraperThreads.erase(iter);
-					if (mScraperThreads.size() == 0)
-					{
-						mExitCode = ASYNC_DONE;
-						LOG(LogDebug) << "ThreadedScraper::finished";
-					}
-					break;
-				}
-			}
+		bool running = mResizing > 0 || !mSearchQueue.empty() || !mMediaQueue.empty() || !mResizeQueue.empty();
+
+		for (auto thread : mScraperThreads)
+			running = running || thread->isRunning();
+
+		for (auto thread : mMediaThreads)
+			running = running || thread->isRunning();
+
+		if (!running)
+		{
+			mExitCode = ASYNC_DONE;
+			LOG(LogDebug) << "ThreadedScraper::finished";
+			break;
+		}
+
+		if (changed)
+			updateUI();
+
+		if (SDL_GetTicks() - mLastStatisticsTime > STATISTICS_LOG_DELAY)
+		{
+			mLastStatisticsTime = SDL_GetTicks();
+			logStatistics();
 		}
+
+		// Requests complete on the network thread : polling them doesn't need to be faster
+		if (!changed)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
 	}
-	
+
+	mResizeGroup.wait();
+	logStatistics();
+
 	if (mExitCode == ASYNC_DONE)
 		mWindow->displayNotificationMessage(GUIICON + _("SCRAPING FINISHED") + std::string(". ") + _("UPDATE GAMELISTS TO APPLY CHANGES."));
 
@@ -214,31 +411,46 @@ void ThreadedScraper::run()
 
 void ThreadedScraper::updateUI()
 {
-	int remaining = mTotal + 1 - mSearchQueue.size() - mScraperThreads.size();
-	if (remaining < 0)
-		remaining = 0;
+	int done = std::min(mGamesDone, mTotal);
 
-	std::string idx = std::to_string(remaining) + "/" + std::to_string(mTotal);	
-	int percentDone = remaining * 100 / (mTotal + 1);
+	std::string idx = std::to_string(done) + "/" + std::to_string(mTotal);
+	int percentDone = mTotal == 0 ? 100 : done * 100 / mTotal;
+
+	float minutes = (SDL_GetTicks() - mStartTime) / 60000.0f;
+	float seconds = minutes * 60.0f;
+
+	char statistics[128];
+	snprintf(statistics, sizeof(statistics), "%.1f games/min - %lld KB/s - %d/%d/%d",
+		minutes > 0 ? mGamesDone / minutes : 0.0f,
+		seconds > 0 ? (long long)(mDownloadedBytes / 1024 / seconds) : 0LL,
+		(int)mMediaQueue.size(), (int)mResizeQueue.size(), mResizing);
 
 	mWndNotification->updateTitle(GUIICON + _("SCRAPING") + " " + idx);
-	mWndNotification->updateText(mCurrentGame);
+	mWndNotification->updateText(mCurrentGame, statistics);
 	mWndNotification->updatePercent(percentDone);
 }
 
-void ThreadedScraper::acceptResult(ScraperThread& thread)
+void ThreadedScraper::logStatistics()
+{
+	int elapsed = SDL_GetTicks() - mStartTime;
+
+	LOG(LogInfo) << "ThreadedScraper : " << mGamesDone << "/" << mTotal << " games in " << (elapsed / 1000) << "s"
+		<< ", " << (elapsed > 0 ? mGamesDone * 60000LL / elapsed : 0) << " games/min"
+		<< ", " << (elapsed > 0 ? mDownloadedBytes * 1000LL / elapsed / 1024 : 0) << " KB/s"
+		<< ", queues : search " << mSearchQueue.size() << " media " << mMediaQueue.size() << " resize " << mResizeQueue.size() << " (" << mResizing << " resizing)";
+}
+
+void ThreadedScraper::acceptResult(ScraperSearchParams& search, ScraperSearchResult& result)
 {
 	LOG(LogDebug) << "ThreadedScraper::acceptResult >>";
 
-	ScraperSearchResult& result = thread.getResult();
 	if (result.mdl.getName().empty())
-	{		
+	{
 		auto scraperName = Scraper::getScraperName(Scraper::getScraper());
-		thread.getSearchParams().game->getMetadata().setScrapeDate(scraperName);
+		search.game->getMetadata().setScrapeDate(scraperName);
 		return;
 	}
 
-	ScraperSearchParams& search = thread.getSearchParams();
 	auto game = search.game;
 
 	mWindow->postToUiThread([game, result]()
@@ -287,4 +499,3 @@ void ThreadedScraper::stop()
 	}
 	catch (...) {}
 }
-
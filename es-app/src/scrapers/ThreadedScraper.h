@@ -1,9 +1,21 @@
 #pragma once
 
 #include <thread>
+#include <mutex>
+#include <atomic>
 #include "Scraper.h"
 #include "components/AsyncNotificationComponent.h"
+#include "utils/TaskScheduler.h"
 
+// A game going through the scraping pipeline : search -> media fetch -> image resize -> gamelist update
+struct ScraperPipelineItem
+{
+	ScraperSearchParams search;
+	ScraperSearchResult result;
+	std::vector<ScraperImageResize> resizes;
+};
+
+// Search stage slot
 class ScraperThread
 {
 public:
@@ -11,6 +23,9 @@ public:
 	void run(const ScraperSearchParams& params);
 	int updateState();
 
+	bool isRunning() { return mRunning; }
+	void setIdle() { mRunning = false; }
+
 	ScraperSearchParams& getSearchParams() { return mSearch; }
 	ScraperSearchResult& getResult() { return mResult; }
 
@@ -34,7 +49,7 @@ private:
 		mStatusString = statusString;
 	}
 
-	
+	bool mRunning;
 	int mStatus;
 	int mErrorStatus;
 	std::string mStatusString;
@@ -42,9 +57,37 @@ private:
 	ScraperSearchResult mResult;
 	ScraperSearchParams mSearch;
 	std::unique_ptr<ScraperSearchHandle> mSearchHandle;
-	std::unique_ptr<MDResolveHandle> mMDResolveHandle;
 };
 
+// Media fetch stage slot. Images are downloaded but not resized.
+class ScraperMediaThread
+{
+public:
+	ScraperMediaThread(int threadId);
+	void run(const ScraperPipelineItem& item);
+	int updateState();
+
+	bool isRunning() { return mRunning; }
+	void setIdle() { mRunning = false; }
+
+	ScraperPipelineItem& getItem() { return mItem; }
+	long long getDownloadedBytes() { return mDownloadedBytes; }
+
+	int getError() { return mErrorStatus; }
+	std::string getErrorString() { return mStatusString; }
+
+	int mThreadId;
+
+private:
+	bool mRunning;
+	int mStatus;
+	int mErrorStatus;
+	std::string mStatusString;
+	long long mDownloadedBytes;
+
+	ScraperPipelineItem mItem;
+	std::unique_ptr<MDResolveHandle> mMDResolveHandle;
+};
 
 class ThreadedScraper
 {
@@ -52,7 +95,7 @@ public:
 	static void start(Window* window, const std::queue<ScraperSearchParams>& searches);
 	static void stop();
 	static bool isRunning() { return mInstance != nullptr; }
-	
+
 	static void pause() { mPaused = true; }
 	static void resume() { mPaused = false; }
 
@@ -66,25 +109,46 @@ private:
 
 	Window* mWindow;
 	AsyncNotificationComponent* mWndNotification;
-	
+
 	std::string		mCurrentGame;
 
 	std::vector<std::string> mErrors;
 
 	void run();
+	bool updateSearches();
+	bool updateMedias();
+	bool updateResizes();
 
 	std::thread* mHandle;
 	std::queue<ScraperSearchParams> mSearchQueue;
 
+	// Stages, with bounded queues between them
 	std::vector<ScraperThread*> mScraperThreads;
-	
-	void acceptResult(ScraperThread& thread);
+	std::queue<ScraperPipelineItem> mMediaQueue;
+
+	std::vector<ScraperMediaThread*> mMediaThreads;
+	std::queue<ScraperPipelineItem> mResizeQueue;
+
+	int mResizeThreadCount;
+	int mResizing;
+	std::mutex mResizedLock;
+	std::queue<ScraperPipelineItem> mResizedItems;
+	Utils::TaskGroup mResizeGroup; // destroyed before mResizedItems : it waits for the tasks filling it
+
+	void acceptResult(ScraperSearchParams& search, ScraperSearchResult& result);
 	void processError(int status, const std::string statusString);
 	void updateUI();
+	void logStatistics();
 
 	int mTotal;
 	int mExitCode;
 
+	// Throughput
+	int mStartTime;
+	int mLastStatisticsTime;
+	int mGamesDone;
+	long long mDownloadedBytes;
+
 	static bool mPaused;
 	static ThreadedScraper* mInstance;
 };
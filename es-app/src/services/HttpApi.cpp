@@ -15,9 +15,30 @@
 #include "utils/StringUtil.h"
 #include "utils/md5.h"
 #include "scrapers/Scraper.h"
+#include "Settings.h"
+#include "FileFilterIndex.h"
+#include "FileSorts.h"
+#include "Tracer.h"
+#include <rapidjson/writer.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
-void HttpApi::getSystemDataJson(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, SystemData* sys, bool localpaths)
+// The counters restart with the process : the start time keeps the tags of a previous run from matching
+static const std::string sETagEpoch = std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+
+static std::string formatETag(const std::string& state)
+{
+	char etag[32];
+	snprintf(etag, sizeof(etag), "\"%zx\"", std::hash<std::string>()(sETagEpoch + "|" + state));
+	return etag;
+}
+
+template<typename JsonWriter>
+void HttpApi::getSystemDataJson(JsonWriter& writer, SystemData* sys, bool localpaths)
 {
 	writer.StartObject();
 	writer.Key("name"); writer.String(sys->getName().c_str());
@@ -87,7 +108,7 @@ void HttpApi::getSystemDataJson(rapidjson::PrettyWriter<rapidjson::StringBuffer>
 std::string HttpApi::getSystemList()
 {
 	rapidjson::StringBuffer s;
-	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
+	rapidjson::Writer<rapidjson::StringBuffer> writer(s);
 
 	writer.StartArray();
 
@@ -99,6 +120,17 @@ std::string HttpApi::getSystemList()
 	return s.GetString();
 }
 
+std::string HttpApi::getSystemListETag()
+{
+	// Game counts follow the games, visibility follows the settings
+	std::string state = std::to_string(FolderData::getTreeVersion()) + "|" + std::to_string(MetaDataList::getChangeCount()) + "|" + Settings::HiddenSystems();
+
+	for (auto sys : SystemData::sSystemVector)
+		state += "|" + sys->getName() + (sys->isVisible() ? "1" : "0") + std::to_string((size_t)sys->getTheme().get());
+
+	return formatETag(state);
+}
+
 std::string HttpApi::getFileDataId(FileData* game)
 {
 	MD5 md5;
@@ -129,37 +161,42 @@ FileData* HttpApi::findFileData(SystemData* system, const std::string& id)
 	return nullptr;
 }
 
-void HttpApi::getFileDataJson(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, FileData* game, bool localpaths)
+template<typename JsonWriter>
+void HttpApi::getFileDataJson(JsonWriter& writer, FileData* game, bool localpaths, const std::set<std::string>* fields)
 {
 	if (game->getType() != GAME)
 		return;
 
+	static const std::string scraperIdKey = "scraperId";
+
+	auto hasField = [fields](const std::string& key) { return fields == nullptr || fields->empty() || fields->find(key) != fields->cend(); };
+
 	std::string id = getFileDataId(game);
 
 	writer.StartObject();
-	writer.Key("id"); writer.String(id.c_str());
-	writer.Key("path"); writer.String(game->getPath().c_str());
-	writer.Key("name"); writer.String(game->getName().c_str());
+	if (hasField("id")) { writer.Key("id"); writer.String(id.c_str()); }
+	if (hasField("path")) { writer.Key("path"); writer.String(game->getPath().c_str()); }
+	if (hasField("name")) { writer.Key("name"); writer.String(game->getName().c_str()); }
 
-	writer.Key("systemName"); writer.String(game->getSystemName().c_str());
+	if (hasField("systemName")) { writer.Key("systemName"); writer.String(game->getSystemName().c_str()); }
 
-	auto meta = game->getMetadata();
-	for (auto mdd : MetaDataList::getMDD())
+	auto& meta = game->getMetadata();
+	for (auto& mdd : MetaDataList::getMDD())
 	{
 		if (mdd.id == MetaDataId::Name)
 			continue;
 
+		const std::string& key = mdd.id == MetaDataId::ScraperId ? scraperIdKey : mdd.key;
+		if (!hasField(key))
+			continue;
+
 		std::string value = game->getMetadata(mdd.id);
 		if (!value.empty())
 		{
 			if (meta.getType(mdd.id) == MD_PATH && localpaths == false)
 				value = "/systems/" + game->getSourceFileData()->getSystemName() + "/games/" + id + "/media/" + mdd.key;
 
-			if (mdd.id == MetaDataId::ScraperId)
-				writer.Key("scraperId");
-			else 
-				writer.Key(mdd.key.c_str());
-
+			writer.Key(key.c_str());
 			writer.String(value.c_str());
 		}
 	}
@@ -280,13 +317,8 @@ std::string HttpApi::ToJson(SystemData* system, bool localpaths)
 	return s.GetString();
 }
 
-std::string HttpApi::getSystemGames(SystemData* system)
+std::vector<FileData*> HttpApi::getSystemGames(SystemData* system, const ListOptions& options, size_t* total)
 {
-	rapidjson::StringBuffer s;
-	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
-
-	writer.StartArray();
-
 	std::vector<FileData*> files;
 
 	std::stack<FolderData*> stack;
@@ -299,18 +331,320 @@ std::string HttpApi::getSystemGames(SystemData* system)
 
 		for (auto it : current->getChildren())
 		{
-			files.push_back(it);
-			if (it->getType() == FOLDER)
+			if (it->getType() == GAME)
+				files.push_back(it);
+			else if (it->getType() == FOLDER)
 				stack.push((FolderData*)it);
 		}
 	}
 
-	for (auto game : files)
-		getFileDataJson(writer, game);
+	if (total != nullptr)
+		*total = files.size();
 
-	writer.EndArray();
+	if (options.offset >= files.size())
+		return std::vector<FileData*>();
 
-	return s.GetString();
+	auto first = files.cbegin() + options.offset;
+	auto last = (options.limit == 0 || options.limit >= (size_t)(files.cend() - first)) ? files.cend() : first + options.limit;
+
+	return std::vector<FileData*>(first, last);
+}
+
+std::string HttpApi::getSystemGamesETag(SystemData* system, const ListOptions& options)
+{
+	// Metadata lists don't know their system : any game change outdates the lists of all the systems
+	std::string state = system->getName() + "|" + std::to_string(FolderData::getTreeVersion()) + "|" + std::to_string(MetaDataList::getChangeCount()) + "|" +
+		std::to_string(options.offset) + "|" + std::to_string(options.limit) + "|" + (options.localpaths ? "1" : "0");
+
+	for (auto& field : options.fields)
+		state += "|" + field;
+
+	return formatETag(state);
+}
+
+// The filters of the systems belong to the UI : queries use their own indexes, made on the first query of each system and made again when games of the system are added or removed.
+// Requests are served by a thread pool : the indexes are used by one query at a time.
+struct QueryIndex
+{
+	unsigned int gamesVersion;
+	std::unique_ptr<FileFilterIndex> index;
+};
+
+static std::mutex sQueryLock;
+static std::map<SystemData*, QueryIndex> sQueryIndexes;
+
+struct MetaDataPredicate
+{
+	std::string key;
+	std::string op;
+	std::string value; // upper-cased when compared as text
+	bool numeric;
+};
+
+static bool parsePredicate(const std::string& text, MetaDataPredicate& predicate)
+{
+	size_t pos = text.find_first_of("=!<>~");
+	if (pos == std::string::npos || pos == 0)
+		return false;
+
+	predicate.key = Utils::String::trim(text.substr(0, pos));
+	predicate.op = text.substr(pos, 1);
+
+	if (text[pos] != '=' && text[pos] != '~' && pos + 1 < text.size() && text[pos + 1] == '=')
+		predicate.op += '=';
+	else if (text[pos] == '!')
+		return false;
+
+	predicate.value = text.substr(pos + predicate.op.size());
+
+	for (auto& mdd : MetaDataList::getMDD())
+	{
+		if (mdd.key != predicate.key)
+			continue;
+
+		predicate.numeric = (mdd.type == MD_INT || mdd.type == MD_FLOAT || mdd.type == MD_RATING);
+		if (!predicate.numeric)
+			predicate.value = Utils::String::toUpper(predicate.value);
+
+		return true;
+	}
+
+	return false;
+}
+
+static bool matchesPredicate(FileData* game, const MetaDataPredicate& predicate)
+{
+	std::string value = game->getMetadata().get(predicate.key);
+
+	if (predicate.op == "~")
+		return Utils::String::containsIgnoreCase(value, predicate.value);
+
+	int cmp;
+	if (predicate.numeric)
+	{
+		float a = Utils::String::toFloat(value);
+		float b = Utils::String::toFloat(predicate.value);
+		cmp = a < b ? -1 : (a > b ? 1 : 0);
+	}
+	else
+		cmp = Utils::String::toUpper(value).compare(predicate.value);
+
+	if (predicate.op == "=")
+		return cmp == 0;
+	if (predicate.op == "!=")
+		return cmp != 0;
+	if (predicate.op == "<")
+		return cmp < 0;
+	if (predicate.op == "<=")
+		return cmp <= 0;
+	if (predicate.op == ">")
+		return cmp > 0;
+
+	return cmp >= 0;
+}
+
+static FileFilterIndex* getQueryIndex(SystemData* system)
+{
+	// Games may have been deleted : indexes can't be updated, they're made again
+	unsigned int gamesVersion = system->getGamesVersion();
+
+	auto it = sQueryIndexes.find(system);
+	if (it != sQueryIndexes.cend() && it->second.gamesVersion == gamesVersion)
+		return it->second.index.get();
+
+	TRACE_SCOPE_ARG("HttpApi::getQueryIndex", system->getName());
+
+	FileFilterIndex* index = new FileFilterIndex();
+	for (auto game : HttpApi::getSystemGames(system, HttpApi::ListOptions()))
+		index->addToIndex(game);
+
+	auto& queryIndex = sQueryIndexes[system];
+	queryIndex.gamesVersion = gamesVersion;
+	queryIndex.index.reset(index);
+	return index;
+}
+
+bool HttpApi::queryGames(const GameQuery& query, const ListOptions& options, std::vector<FileData*>& games, size_t& total, std::string& error)
+{
+	TRACE_SCOPE("HttpApi::queryGames");
+
+	std::vector<MetaDataPredicate> predicates;
+	for (auto& text : query.predicates)
+	{
+		MetaDataPredicate predicate;
+		if (!parsePredicate(text, predicate))
+		{
+			error = "Invalid metadata condition : " + text;
+			return false;
+		}
+
+		predicates.push_back(predicate);
+	}
+
+	for (auto& name : query.systems)
+	{
+		if (SystemData::getSystem(name) == nullptr)
+		{
+			error = "Unknown system : " + name;
+			return false;
+		}
+	}
+
+	// A copy : the sorts are made again when the UI reloads
+	FileSorts::SortType sort = FileSorts::getSortType(query.sortId);
+	if (query.sortId >= 0 && sort.id != query.sortId)
+	{
+		error = "Unknown sort : " + std::to_string(query.sortId);
+		return false;
+	}
+
+	// Collections & groups only hold games of other systems
+	std::vector<SystemData*> systems;
+	for (auto sys : SystemData::sSystemVector)
+		if (sys->isGameSystem() && !sys->isCollection() && !sys->isGroupSystem() && (query.systems.empty() || query.systems.find(sys->getName()) != query.systems.cend()))
+			systems.push_back(sys);
+
+	std::vector<FileData*> found;
+
+	{
+		std::unique_lock<std::mutex> lock(sQueryLock);
+
+		// Indexes of the systems removed by a reload
+		for (auto it = sQueryIndexes.begin(); it != sQueryIndexes.end(); )
+		{
+			if (std::find(SystemData::sSystemVector.cbegin(), SystemData::sSystemVector.cend(), it->first) == SystemData::sSystemVector.cend())
+				it = sQueryIndexes.erase(it);
+			else
+				++it;
+		}
+
+		// Only used for its filter declarations
+		static FileFilterIndex filterNames;
+
+		std::map<FilterIndexType, std::vector<std::string>> filters;
+		for (auto& filter : query.filters)
+		{
+			FilterIndexType type = filterNames.getFilterType(filter.first);
+			if (type == NONE)
+			{
+				error = "Unknown filter : " + filter.first;
+				return false;
+			}
+
+			// Indexed values are upper-cased, the values of the media filters are metadata names
+			auto& values = filters[type];
+			for (auto& value : filter.second)
+				values.push_back(type == HASMEDIA_FILTER || type == MISSING_MEDIA_FILTER ? value : Utils::String::toUpper(value));
+		}
+
+		for (auto sys : systems)
+			getQueryIndex(sys)->findGames(filters, query.texts, found);
+	}
+
+	// Conditions that can't be indexed are only tested on the games found with the indexes
+	if (predicates.size())
+	{
+		found.erase(std::remove_if(found.begin(), found.end(), [&predicates](FileData* game)
+		{
+			for (auto& predicate : predicates)
+				if (!matchesPredicate(game, predicate))
+					return true;
+
+			return false;
+		}), found.end());
+	}
+
+	if (query.sortId >= 0)
+		FileSorts::sortFiles(found, sort, false, query.favoritesFirst);
+	else if (query.favoritesFirst)
+		std::stable_partition(found.begin(), found.end(), [](FileData* game) { return game->getFavorite(); });
+
+	total = found.size();
+
+	games.clear();
+	if (options.offset >= found.size())
+		return true;
+
+	auto first = found.cbegin() + options.offset;
+	auto last = (options.limit == 0 || options.limit >= (size_t)(found.cend() - first)) ? found.cend() : first + options.limit;
+
+	games.assign(first, last);
+	return true;
+}
+
+std::string HttpApi::getQueryETag(const GameQuery& query, const ListOptions& options)
+{
+	std::string state = "query|" + std::to_string(FolderData::getTreeVersion()) + "|" + std::to_string(MetaDataList::getChangeCount()) + "|" +
+		std::to_string(options.offset) + "|" + std::to_string(options.limit) + "|" + (options.localpaths ? "1" : "0") + "|" +
+		std::to_string(query.sortId) + "|" + (query.favoritesFirst ? "1" : "0");
+
+	for (auto& field : options.fields)
+		state += "|f:" + field;
+
+	for (auto& filter : query.filters)
+	{
+		state += "|" + filter.first + "=";
+		for (auto& value : filter.second)
+			state += value + ",";
+	}
+
+	for (auto& text : query.texts)
+		state += "|t:" + text;
+
+	for (auto& predicate : query.predicates)
+		state += "|m:" + predicate;
+
+	for (auto& system : query.systems)
+		state += "|s:" + system;
+
+	return formatETag(state);
+}
+
+// The tree version is taken with the list : each part is only written if no game was removed since
+HttpApi::GamesJsonStream::GamesJsonStream(const std::vector<FileData*>& games, const ListOptions& options)
+	: mGames(games), mOptions(options), mPosition(0), mStarted(false), mDone(false)
+{
+	mTreeVersion = FolderData::getTreeVersion();
+}
+
+bool HttpApi::GamesJsonStream::isOutdated()
+{
+	return !mDone && mTreeVersion != FolderData::getTreeVersion();
+}
+
+std::string HttpApi::GamesJsonStream::next(size_t maxGames)
+{
+	if (mDone)
+		return "";
+
+	rapidjson::StringBuffer s;
+
+	if (!mStarted)
+	{
+		s.Put('[');
+		mStarted = true;
+	}
+
+	// Each game is a complete document : the writer is reset for each of them, and the array is written around
+	rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+
+	size_t end = std::min(mGames.size(), mPosition + maxGames);
+	for (; mPosition < end; mPosition++)
+	{
+		if (mPosition > 0)
+			s.Put(',');
+
+		writer.Reset(s);
+		getFileDataJson(writer, mGames[mPosition], mOptions.localpaths, &mOptions.fields);
+	}
+
+	if (mPosition >= mGames.size())
+	{
+		s.Put(']');
+		mDone = true;
+	}
+
+	return std::string(s.GetString(), s.GetSize());
 }
 
 std::string HttpApi::getRunnningGameInfo()
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 #include <rapidjson/rapidjson.h>
 #include <rapidjson/pointer.h>
 #include <rapidjson/prettywriter.h>
@@ -12,9 +15,62 @@ class FileData;
 class HttpApi
 {
 public:
+	// Paging & field selection of game lists
+	struct ListOptions
+	{
+		ListOptions() : offset(0), limit(0), localpaths(false) { }
+
+		size_t offset;
+		size_t limit; // 0 : no limit
+		std::set<std::string> fields; // Empty : all fields
+		bool localpaths;
+	};
+
+	// Writes a games array by parts, for chunked responses
+	class GamesJsonStream
+	{
+	public:
+		GamesJsonStream(const std::vector<FileData*>& games, const ListOptions& options);
+
+		// Next part of the array, empty once it's complete
+		std::string next(size_t maxGames);
+
+		// Games were added or removed since the list was made : the ones not written yet may have been deleted
+		bool isOutdated();
+
+	private:
+		std::vector<FileData*> mGames;
+		ListOptions mOptions;
+		unsigned int mTreeVersion;
+		size_t mPosition;
+		bool mStarted;
+		bool mDone;
+	};
+
 	static std::string getCaps();
 	static std::string getSystemList();
-	static std::string getSystemGames(SystemData* system);
+	static std::string getSystemListETag();
+
+	static std::vector<FileData*> getSystemGames(SystemData* system, const ListOptions& options, size_t* total = nullptr);
+	// Changes when the games of the system, or the options, change
+	static std::string getSystemGamesETag(SystemData* system, const ListOptions& options);
+
+	// Games of all the systems, found with filter indexes
+	struct GameQuery
+	{
+		GameQuery() : sortId(-1), favoritesFirst(false) { }
+
+		std::map<std::string, std::vector<std::string>> filters; // by filter name (genre, players, favorite...) : games having one of the values
+		std::vector<std::string> texts; // games which name contains one of them
+		std::vector<std::string> predicates; // metadata conditions, as name<op>value with op one of = != < <= > >= ~ (contains)
+		std::set<std::string> systems; // Empty : all the systems
+		int sortId; // FileSorts::SortId, -1 : gamelist order, system by system
+		bool favoritesFirst;
+	};
+
+	// Returns false, with a message, if the query is not valid
+	static bool queryGames(const GameQuery& query, const ListOptions& options, std::vector<FileData*>& games, size_t& total, std::string& error);
+	static std::string getQueryETag(const GameQuery& query, const ListOptions& options);
 
 	static std::string getRunnningGameInfo();
 
@@ -30,6 +86,8 @@ public:
 
 private:
 	static std::string getFileDataId(FileData* game);
-	static void getFileDataJson(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, FileData* game, bool localpaths = false);
-	static void getSystemDataJson(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, SystemData* sys, bool localpaths = false);
+	template<typename JsonWriter>
+	static void getFileDataJson(JsonWriter& writer, FileData* game, bool localpaths = false, const std::set<std::string>* fields = nullptr);
+	template<typename JsonWriter>
+	static void getSystemDataJson(JsonWriter& writer, SystemData* sys, bool localpaths = false);
 };
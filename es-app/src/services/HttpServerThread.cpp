@@ -16,6 +16,7 @@
 #include "guis/GuiMenu.h"
 #include "guis/GuiMsgBox.h"
 #include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
 #include "HttpApi.h"
 #include "Settings.h"
 #include "ApiSystem.h"
@@ -24,6 +25,10 @@
 #include "scrapers/ThreadedScraper.h"
 #include "guis/GuiUpdate.h"
 #include "ContentInstaller.h"
+#include <algorithm>
+
+// Games written in each chunk of the game lists
+#define HTTP_STREAM_GAMES	256
 
 /* 
 
@@ -42,13 +47,18 @@ GET  /isIdle
 
 System/Games APIS
 -----------------
-GET  /systems
+GET  /systems													-> supports If-None-Match
 GET  /systems/{systemName}
 GET  /systems/{systemName}/logo
+GET  /systems/{systemName}/games								-> chunked. Parameters : offset, limit, fields (comma separated), localpaths. Supports If-None-Match
 GET  /systems/{systemName}/games/{gameId}		
 POST /systems/{systemName}/games/{gameId}						-> body must contain the game metadatas to save as application/json
 GET  /systems/{systemName}/games/{gameId}/media/{mediaType}
 POST /systems/{systemName}/games/{gameId}/media/{mediaType}		-> body must contain the file bytes to save. Content-type must be valid.
+GET  /games													-> chunked, games of all the systems. Parameters : offset, limit, fields, localpaths, and
+																   {filterName}=values (comma separated : favorite, genre (ids), players, developer, rating, year, lang, region, kidgame, played, ...),
+																   text=names (comma separated), meta={metadataName}{= != < <= > >= ~}{value} (repeatable), systems (comma separated),
+																   sort={FileSorts::SortId}, favoritesFirst. Supports If-None-Match
 
 Store APIs
 ----------
@@ -136,6 +146,105 @@ static bool isAllowed(const httplib::Request& req, httplib::Response& res)
 	return true;
 }
 
+// Sets the ETag of the response, returns true when the client already has this version (304 Not Modified)
+static bool checkETag(const httplib::Request& req, httplib::Response& res, const std::string& etag)
+{
+	res.set_header("ETag", etag);
+	res.set_header("Cache-Control", "no-cache");
+
+	for (auto value : Utils::String::split(req.get_header_value("If-None-Match"), ','))
+	{
+		value = Utils::String::trim(value);
+		if (value == etag || value == "W/" + etag || value == "*")
+		{
+			res.status = 304;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static HttpApi::ListOptions getListOptions(const httplib::Request& req)
+{
+	HttpApi::ListOptions options;
+	options.localpaths = req.has_param("localpaths") && req.get_param_value("localpaths") == "true";
+
+	if (req.has_param("offset"))
+		options.offset = std::max(0, Utils::String::toInteger(req.get_param_value("offset")));
+
+	if (req.has_param("limit"))
+		options.limit = std::max(0, Utils::String::toInteger(req.get_param_value("limit")));
+
+	if (req.has_param("fields"))
+		for (auto field : Utils::String::split(req.get_param_value("fields"), ',', true))
+			options.fields.insert(Utils::String::trim(field));
+
+	return options;
+}
+
+static bool getGameQuery(const httplib::Request& req, HttpApi::GameQuery& query, std::string& error)
+{
+	static const std::set<std::string> listParams = { "offset", "limit", "fields", "localpaths" };
+
+	for (auto& param : req.params)
+	{
+		if (listParams.find(param.first) != listParams.cend())
+			continue;
+
+		if (param.first == "meta")
+			query.predicates.push_back(param.second);
+		else if (param.first == "sort")
+			query.sortId = Utils::String::toInteger(param.second);
+		else if (param.first == "favoritesFirst")
+			query.favoritesFirst = (param.second == "true");
+		else
+		{
+			for (auto value : Utils::String::split(param.second, ',', true))
+			{
+				value = Utils::String::trim(value);
+
+				if (param.first == "text")
+					query.texts.push_back(value);
+				else if (param.first == "systems")
+					query.systems.insert(value);
+				else
+					query.filters[param.first].push_back(value);
+			}
+		}
+	}
+
+	if (req.has_param("sort") && (req.get_param_value("sort").empty() || query.sortId < 0))
+	{
+		error = "Invalid sort : " + req.get_param_value("sort");
+		return false;
+	}
+
+	return true;
+}
+
+static void sendGames(httplib::Response& res, const std::vector<FileData*>& games, size_t total, const HttpApi::ListOptions& options)
+{
+	auto stream = std::make_shared<HttpApi::GamesJsonStream>(games, options);
+
+	res.set_header("X-Total-Count", std::to_string(total));
+	res.set_header("Content-Type", "application/json");
+	res.set_chunked_content_provider([stream](size_t offset, httplib::DataSink& sink)
+	{
+		// Written by parts from the server thread : stop if the games were changed meanwhile
+		if (stream->isOutdated())
+			return false;
+
+		std::string data = stream->next(HTTP_STREAM_GAMES);
+		if (data.empty())
+			sink.done();
+		else
+			sink.write(data.c_str(), data.size());
+
+		return true;
+	});
+}
+
 void HttpServerThread::run()
 {
 	mHttpServer = new httplib::Server();
@@ -264,9 +373,40 @@ void HttpServerThread::run()
 		if (!isAllowed(req, res))
 			return;
 
+		if (checkETag(req, res, HttpApi::getSystemListETag()))
+			return;
+
 		res.set_content(HttpApi::getSystemList(), "application/json");
 	});
 
+	mHttpServer->Get("/games", [](const httplib::Request& req, httplib::Response& res)
+	{
+		if (!isAllowed(req, res))
+			return;
+
+		HttpApi::GameQuery query;
+		HttpApi::ListOptions options = getListOptions(req);
+
+		std::vector<FileData*> games;
+		size_t total = 0;
+		std::string error;
+
+		if (getGameQuery(req, query, error))
+		{
+			if (checkETag(req, res, HttpApi::getQueryETag(query, options)))
+				return;
+
+			if (HttpApi::queryGames(query, options, games, total, error))
+			{
+				sendGames(res, games, total, options);
+				return;
+			}
+		}
+
+		res.set_content("400 " + error, "text/html");
+		res.status = 400;
+	});
+
 	mHttpServer->Get("/runningGame", [](const httplib::Request& req, httplib::Response& res)
 	{
 		if (!isAllowed(req, res))
@@ -345,7 +485,13 @@ void HttpServerThread::run()
 		SystemData* system = SystemData::getSystem(systemName);
 		if (system != nullptr)
 		{
-			res.set_content(HttpApi::getSystemGames(system), "application/json");
+			HttpApi::ListOptions options = getListOptions(req);
+			if (checkETag(req, res, HttpApi::getSystemGamesETag(system, options)))
+				return;
+
+			size_t total = 0;
+			auto games = HttpApi::getSystemGames(system, options, &total);
+			sendGames(res, games, total, options);
 			return;
 		}
 		
@@ -13,6 +13,7 @@
 #include "views/SystemView.h"
 #include "views/UIModeController.h"
 #include "FileFilterIndex.h"
+#include "GamelistJournal.h"
 #include "Log.h"
 #include "Scripting.h"
 #include "Settings.h"
@@ -26,7 +27,7 @@
 #include "guis/GuiImageViewer.h"
 #include "ApiSystem.h"
 #include "guis/GuiMsgBox.h"
-#include "utils/ThreadPool.h"
+#include "utils/TaskScheduler.h"
 #include <SDL_timer.h>
 #include "TextToSpeech.h"
 #include "VolumeControl.h"
@@ -426,6 +427,10 @@ void ViewController::onFileChanged(FileData* file, FileChangeType change)
 	std::string key = file->getFullPath();
 	auto sourceSystem = file->getSourceFileData()->getSystem();
 
+	// Update the cached lists of displayed games before the views repopulate
+	if (change == FILE_METADATA_CHANGED && file->getParent() != nullptr)
+		file->getParent()->refreshDisplayedChild(file);
+
 	auto it = mGameListViews.find(sourceSystem);
 	if (it != mGameListViews.cend())
 		it->second->onFileChanged(file, change);
@@ -442,19 +447,27 @@ void ViewController::onFileChanged(FileData* file, FileChangeType change)
 		}
 	}
 
-	for (auto collection : CollectionSystemManager::get()->getAutoCollectionSystems())
-	{		
-		auto cit = mGameListViews.find(collection.second.system);
-		if (cit != mGameListViews.cend() && collection.second.system->getRootFolder()->FindByPath(key))
-			cit->second->onFileChanged(file, change);
-	}
+	for (auto& collection : CollectionSystemManager::get()->getAutoCollectionSystems())
+		onCollectionFileChanged(collection.second.system, file, key, change);
 
-	for (auto collection : CollectionSystemManager::get()->getCustomCollectionSystems())
-	{
-		auto cit = mGameListViews.find(collection.second.system);
-		if (cit != mGameListViews.cend() && collection.second.system->getRootFolder()->FindByPath(key))
-			cit->second->onFileChanged(file, change);
-	}
+	for (auto& collection : CollectionSystemManager::get()->getCustomCollectionSystems())
+		onCollectionFileChanged(collection.second.system, file, key, change);
+}
+
+void ViewController::onCollectionFileChanged(SystemData* collection, FileData* file, const std::string& key, FileChangeType change)
+{
+	auto cit = mGameListViews.find(collection);
+	if (cit == mGameListViews.cend())
+		return;
+
+	FileData* entry = collection->getRootFolder()->FindByPath(key);
+	if (entry == nullptr)
+		return;
+
+	if (change == FILE_METADATA_CHANGED && entry != file && entry->getParent() != nullptr)
+		entry->getParent()->refreshDisplayedChild(entry);
+
+	cit->second->onFileChanged(file, change);
 }
 
 bool ViewController::doLaunchGame(FileData* game, LaunchGameOptions options)
@@ -1150,16 +1163,16 @@ void ViewController::reloadAll(Window* window, bool reloadTheme)
 	
 	if (reloadTheme && cursorMap.size() > 0)
 	{
-		int processedSystem = 0;
+		std::atomic<int> processedSystem(0);
 		int systemCount = cursorMap.size();
 
-		Utils::ThreadPool pool;
+		Utils::TaskGroup pool;
 
 		for (auto it = cursorMap.cbegin(); it != cursorMap.cend(); it++)
 		{
 			SystemData* pooledSystem = it->first;
 
-			pool.queueWorkItem([pooledSystem, &processedSystem]
+			pool.run([pooledSystem, &processedSystem]
 			{ 
 				pooledSystem->loadTheme();
 				pooledSystem->resetFilters();
@@ -1297,6 +1310,10 @@ void ViewController::onScreenSaverActivate()
 
 	if (mCurrentView)
 		mCurrentView->onScreenSaverActivate();
+
+	// Nobody is waiting for the UI : merge the saved changes into the gamelists
+	if (!Settings::IgnoreGamelist())
+		GamelistJournal::compactAllInBackground();
 }
 
 void ViewController::onScreenSaverDeactivate()
@@ -121,6 +121,7 @@ private:
 
 	void playViewTransition(bool forceImmediate);
 	bool doLaunchGame(FileData* game, LaunchGameOptions options);
+	void onCollectionFileChanged(SystemData* collection, FileData* file, const std::string& key, FileChangeType change);
 	bool checkLaunchOptions(FileData* game, LaunchGameOptions options, Vector3f center);
 	int getSystemId(SystemData* system);
 	void changeVolume(int increment);
@@ -3,7 +3,10 @@
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
 #include "Log.h"
+#include "Tracer.h"
+#include <algorithm>
 #include <assert.h>
+#include <condition_variable>
 #include <thread>
 
 #include <SDL.h>
@@ -15,7 +18,23 @@
 #endif
 
 #include <mutex>
-static std::mutex mMutex;
+
+#define HTTP_MAX_HOST_CONNECTIONS	6
+#define HTTP_MAX_TOTAL_CONNECTIONS	32
+
+// curl_multi_poll & curl_multi_wakeup appeared in curl 7.68.0
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define HTTP_HAS_MULTI_POLL
+#endif
+
+// s_multi_handle is only used by the network thread : other threads post the requests to add or remove under sLock.
+// Never destroyed : the network thread still waits on them while the static objects are destroyed at exit.
+static std::mutex& sLock = *new std::mutex();
+static std::condition_variable& sWork = *new std::condition_variable();
+static std::condition_variable& sCompleted = *new std::condition_variable();
+static std::thread* sNetworkThread = nullptr;
+static std::vector<HttpReq*> sPendingRequests;
+static std::vector<CURL*> sPendingRemovals;
 
 CURLM* HttpReq::s_multi_handle = curl_multi_init();
 
@@ -93,7 +112,7 @@ static std::string _regGetString(HKEY hKey, const std::string &strPath, const st
 #endif
 
 HttpReq::HttpReq(const std::string& url, const std::string& outputFilename) 
-	: mStatus(REQ_IN_PROGRESS), mHandle(NULL), mFile(NULL)
+	: mHandle(NULL), mStatus(REQ_IN_PROGRESS), mStreamError(false), mCompleting(false), mFile(NULL)
 {
 	HttpReqOptions options;
 	options.outputFilename = outputFilename;	
@@ -101,7 +120,7 @@ HttpReq::HttpReq(const std::string& url, const std::string& outputFilename)
 }
 
 HttpReq::HttpReq(const std::string& url, HttpReqOptions* options)
-	: mStatus(REQ_IN_PROGRESS), mHandle(NULL), mFile(NULL)
+	: mHandle(NULL), mStatus(REQ_IN_PROGRESS), mStreamError(false), mCompleting(false), mFile(NULL)
 {
 	performRequest(url, options);
 }
@@ -259,8 +278,6 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 	}
 #endif
 	
-	std::unique_lock<std::mutex> lock(mMutex);
-
 	if (!mFilePath.empty())
 	{
 		mTempStreamPath = outputFilename + ".tmp";
@@ -284,18 +301,13 @@ void HttpReq::performRequest(const std::string& url, HttpReqOptions* options)
 		Utils::FileSystem::removeFile(outputFilename);
 	}
 
-	//add the handle to our multi
-	CURLMcode merr = curl_multi_add_handle(s_multi_handle, mHandle);
-	if(merr != CURLM_OK)
-	{
-		closeStream();
-
-		mStatus = REQ_IO_ERROR;
-		onError(curl_multi_strerror(merr));
-		return;
-	}
+	std::unique_lock<std::mutex> lock(sLock);
 
 	s_requests[mHandle] = this;
+	sPendingRequests.push_back(this);
+
+	startNetworkThread();
+	wakeNetworkThread();
 }
 
 void HttpReq::closeStream()
@@ -310,160 +322,290 @@ void HttpReq::closeStream()
 
 HttpReq::~HttpReq()
 {
-	std::unique_lock<std::mutex> lock(mMutex);
+	if (mHandle)
+	{
+		std::unique_lock<std::mutex> lock(sLock);
+
+		// The network thread may still be writing the results
+		sCompleted.wait(lock, [this] { return !mCompleting; });
+
+		auto pending = std::find(sPendingRequests.begin(), sPendingRequests.end(), this);
+		if (pending != sPendingRequests.end())
+		{
+			sPendingRequests.erase(pending);
+			s_requests.erase(mHandle);
+			curl_easy_cleanup(mHandle);
+		}
+		else if (s_requests.erase(mHandle) > 0)
+		{
+			// Still transferring, maybe right now : wait until the network thread removed the handle, then no callback can reach this instance anymore
+			CURL* handle = mHandle;
+			sPendingRemovals.push_back(handle);
+			wakeNetworkThread();
+
+			sCompleted.wait(lock, [handle] { return std::find(sPendingRemovals.cbegin(), sPendingRemovals.cend(), handle) == sPendingRemovals.cend(); });
+		}
+		else
+			curl_easy_cleanup(mHandle);
+	}
 
 	closeStream();
 	
 	if (!mTempStreamPath.empty())
 		Utils::FileSystem::removeFile(mTempStreamPath);
+}
+
+HttpReq::Status HttpReq::status()
+{
+	return mStatus;
+}
+
+// Called by the network thread, without sLock. Returns the status, which the network thread publishes under sLock : other threads read the results once it's known.
+HttpReq::Status HttpReq::onDone(CURLcode result)
+{
+	closeStream();
 
-	if(mHandle)
+	Status status = REQ_SUCCESS;
+	std::string err;
+
+	if (mStreamError)
+	{
+		status = REQ_FILESTREAM_ERROR;
+		err = "File stream error (disk full ?)";
+	}
+	else if (result == CURLE_OK)
 	{
-		s_requests.erase(mHandle);
+		long http_status_code;
+		curl_easy_getinfo(mHandle, CURLINFO_RESPONSE_CODE, &http_status_code);
 
-		CURLMcode merr = curl_multi_remove_handle(s_multi_handle, mHandle);
+		if (http_status_code < 200 || http_status_code > 299)
+		{
+			if (http_status_code >= 400 && http_status_code <= 503)
+			{
+				if (mFilePath.empty())
+				{
+					auto content = getContent();
+					if (!content.empty() && content.find("<body") != std::string::npos)
+					{
+						// Parse response HTML & extract body
+						auto body = Utils::String::extractString(content, "<body", "</body>", true);
+						body = Utils::String::replace(body, "\r", "");
+						body = Utils::String::replace(body, "\n", "");
+						body = Utils::String::replace(body, "</p>", "\r\n");
+						body = Utils::String::replace(body, "<br>", "\r\n");
+						body = Utils::String::replace(body, "<hr>", "\r\n");
+						body = Utils::String::removeHtmlTags(body);
+
+						if (!body.empty())
+							err = "HTTP status " + std::to_string(http_status_code) + "\r\n" + body;
+					}
+					else
+						err = content;
+				}
 
-		if(merr != CURLM_OK)
-			LOG(LogError) << "Error removing curl_easy handle from curl_multi: " << curl_multi_strerror(merr);
+				if (http_status_code > 500)
+					status = REQ_IO_ERROR;
+				else
+					status = (Status)http_status_code;
+			}
+			else
+				status = REQ_IO_ERROR;
+
+			if (err.empty())
+				err = "HTTP status " + std::to_string(http_status_code);
+		}
+		else if (!mFilePath.empty())
+		{
+			bool renamed = Utils::FileSystem::renameFile(mTempStreamPath.c_str(), mFilePath.c_str());
+#if WIN32
+			if (renamed)
+			{
+				auto wfn = Utils::String::convertToWideString(mFilePath);
+				HANDLE hFile = CreateFileW(wfn.c_str(), GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+				if (hFile != INVALID_HANDLE_VALUE)
+				{
+					SYSTEMTIME st;
+					GetSystemTime(&st);              // Gets the current system time
+					FILETIME ft;
+					SystemTimeToFileTime(&st, &ft);  // Converts the current system time to file time format
 
-		curl_easy_cleanup(mHandle);
+					SetFileTime(hFile, &ft, &ft, &ft);
+					CloseHandle(hFile);
+				}
+			}
+#endif
+			if (!renamed)
+			{
+				// Strange behaviour on Windows : sometimes std::rename fails if it's done too early after closing stream
+				// Copy file instead & try to delete it
+				if (Utils::FileSystem::copyFile(mTempStreamPath, mFilePath))
+					renamed = true;
+			}
+
+			if (!renamed)
+			{
+				status = REQ_IO_ERROR;
+				err = "file rename failed";
+			}
+		}
 	}
+	else
+	{
+		status = REQ_IO_ERROR;
+		err = curl_easy_strerror(result);
+	}
+
+	if (!err.empty())
+	{
+		mErrorMsg = err;
+		LOG(LogError) << "HttpReq::onError (" + std::to_string(status) << ") : " + mErrorMsg;
+	}
+
+	return status;
 }
 
-HttpReq::Status HttpReq::status()
+// Called under sLock
+void HttpReq::startNetworkThread()
+{
+	if (sNetworkThread != nullptr)
+		return;
+
+	// Connections are kept alive and reused by the multi handle. Few connections per host, scraping sites throttle the others.
+	curl_multi_setopt(s_multi_handle, CURLMOPT_MAX_HOST_CONNECTIONS, (long)HTTP_MAX_HOST_CONNECTIONS);
+	curl_multi_setopt(s_multi_handle, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)HTTP_MAX_TOTAL_CONNECTIONS);
+	curl_multi_setopt(s_multi_handle, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+
+	// Lives until the process exits
+	sNetworkThread = new std::thread(&HttpReq::networkThread);
+	sNetworkThread->detach();
+}
+
+// Called under sLock
+void HttpReq::wakeNetworkThread()
 {
-	if (mStatus == REQ_IN_PROGRESS)
+	sWork.notify_one();
+
+#ifdef HTTP_HAS_MULTI_POLL
+	curl_multi_wakeup(s_multi_handle);
+#endif
+}
+
+void HttpReq::networkThread()
+{
+	Tracer::setThreadName("Network");
+
+	std::unique_lock<std::mutex> lock(sLock);
+
+	std::vector<std::pair<CURL*, CURLcode>> done;
+	std::vector<std::pair<HttpReq*, CURLcode>> completed;
+	std::vector<Status> statuses;
+
+	while (true)
 	{
-		std::unique_lock<std::mutex> lock(mMutex);
+		// Removals first : the deleted requests must not receive any more data
+		for (auto handle : sPendingRemovals)
+		{
+			curl_multi_remove_handle(s_multi_handle, handle);
+			curl_easy_cleanup(handle);
+		}
+
+		sPendingRemovals.clear();
+
+		for (auto req : sPendingRequests)
+		{
+			CURLMcode merr = curl_multi_add_handle(s_multi_handle, req->mHandle);
+			if (merr != CURLM_OK)
+			{
+				s_requests.erase(req->mHandle);
+				req->closeStream();
+				req->mErrorMsg = curl_multi_strerror(merr);
+				req->mStatus = REQ_IO_ERROR;
+				LOG(LogError) << "HttpReq::onError (" << REQ_IO_ERROR << ") : " << req->mErrorMsg;
+			}
+		}
+
+		sPendingRequests.clear();
+		sCompleted.notify_all();
+
+		if (s_requests.empty())
+		{
+			sWork.wait(lock);
+			continue;
+		}
+
+		// Transfers run unlocked : the write callbacks can't reach a deleted request, its destructor waits until its handle is removed
+		lock.unlock();
 
 		int handle_count;
 		CURLMcode merr = curl_multi_perform(s_multi_handle, &handle_count);
 		if (merr != CURLM_OK && merr != CURLM_CALL_MULTI_PERFORM)
 		{
-			closeStream();
-
-			mStatus = REQ_IO_ERROR;
-			onError(curl_multi_strerror(merr));
-			return mStatus;
+			LOG(LogError) << "HttpReq : curl_multi_perform failed : " << curl_multi_strerror(merr);
 		}
 
 		int msgs_left;
 		CURLMsg* msg;
 		while ((msg = curl_multi_info_read(s_multi_handle, &msgs_left)) != nullptr)
 		{
-			if (msg->msg == CURLMSG_DONE)
-			{
-				HttpReq* req = s_requests[msg->easy_handle];
-				if (req == NULL)
-				{
-					LOG(LogError) << "Cannot find easy handle!";
-					continue;
-				}
+			if (msg->msg != CURLMSG_DONE)
+				continue;
 
-				req->closeStream();
+			CURL* handle = msg->easy_handle;
+			CURLcode result = msg->data.result;
 
-				if (req->mStatus == REQ_FILESTREAM_ERROR)
-				{
-					std::string err = "File stream error (disk full ?)";
-					req->onError(err.c_str());
-				}
-				else if (msg->data.result == CURLE_OK)
-				{
-					int http_status_code;
-					curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &http_status_code);					
+			// Frees the connection for the queued requests
+			curl_multi_remove_handle(s_multi_handle, handle);
+			done.push_back(std::make_pair(handle, result));
+		}
 
-					if (http_status_code < 200 || http_status_code > 299)
-					{
-						std::string err;
-
-						if (http_status_code >= 400 && http_status_code <= 503)
-						{
-							if (req->mFilePath.empty())
-							{
-								auto content = req->getContent();
-								if (!content.empty() && content.find("<body") != std::string::npos)
-								{
-									// Parse response HTML & extract body
-									auto body = Utils::String::extractString(content, "<body", "</body>", true);
-									body = Utils::String::replace(body, "\r", "");
-									body = Utils::String::replace(body, "\n", "");
-									body = Utils::String::replace(body, "</p>", "\r\n");
-									body = Utils::String::replace(body, "<br>", "\r\n");
-									body = Utils::String::replace(body, "<hr>", "\r\n");
-									body = Utils::String::removeHtmlTags(body);
-
-									if (!body.empty())
-										err = "HTTP status " + std::to_string(http_status_code) + "\r\n" + body;
-								}
-								else
-									err = content;
-							}
-
-							if (http_status_code > 500)
-								req->mStatus = REQ_IO_ERROR;
-							else
-								req->mStatus = (Status)http_status_code;
-						}						
-						else
-							req->mStatus = REQ_IO_ERROR;
-
-						if (err.empty())
-							err = "HTTP status " + std::to_string(http_status_code);
-
-						req->onError(err.c_str());
-					}
-					else
-					{
-						if (!req->mFilePath.empty())
-						{
-							bool renamed = Utils::FileSystem::renameFile(req->mTempStreamPath.c_str(), req->mFilePath.c_str());
-#if WIN32
-							if (renamed)
-							{
-								auto wfn = Utils::String::convertToWideString(req->mFilePath);
-								HANDLE hFile = CreateFileW(wfn.c_str(), GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
-								if (hFile != INVALID_HANDLE_VALUE)
-								{
-									SYSTEMTIME st;
-									GetSystemTime(&st);              // Gets the current system time
-									FILETIME ft;
-									SystemTimeToFileTime(&st, &ft);  // Converts the current system time to file time format
-
-									SetFileTime(hFile, &ft, &ft, &ft);
-									CloseHandle(hFile);
-								}
-							}
-#endif
-							if (!renamed)
-							{
-								// Strange behaviour on Windows : sometimes std::rename fails if it's done too early after closing stream
-								// Copy file instead & try to delete it
-								if (Utils::FileSystem::copyFile(req->mTempStreamPath, req->mFilePath))
-									renamed = true;
-							}
-
-							if (renamed)
-								req->mStatus = REQ_SUCCESS;
-							else
-							{
-								req->mStatus = REQ_IO_ERROR;
-								req->onError("file rename failed");
-							}
-						}
-						else
-							req->mStatus = REQ_SUCCESS;
-					}
-				}
-				else
-				{
-					req->mStatus = REQ_IO_ERROR;
-					req->onError(curl_easy_strerror(msg->data.result));
-				}
+		lock.lock();
+
+		for (auto& item : done)
+		{
+			// Not found if the request was deleted meanwhile : its handle is in sPendingRemovals
+			auto it = s_requests.find(item.first);
+			if (it == s_requests.cend())
+				continue;
+
+			HttpReq* req = it->second;
+			s_requests.erase(it);
+
+			req->mCompleting = true;
+			completed.push_back(std::make_pair(req, item.second));
+		}
+
+		done.clear();
+
+		if (completed.size() > 0)
+		{
+			// Moving the files & reading the errors is done unlocked. The requests can't be deleted meanwhile.
+			lock.unlock();
+
+			for (auto& item : completed)
+				statuses.push_back(item.first->onDone(item.second));
+
+			lock.lock();
+
+			for (size_t i = 0; i < completed.size(); i++)
+			{
+				completed[i].first->mStatus = statuses[i];
+				completed[i].first->mCompleting = false;
 			}
+
+			completed.clear();
+			statuses.clear();
+			sCompleted.notify_all();
+			continue;
 		}
-	}
 
-	return mStatus;
+		lock.unlock();
+#ifdef HTTP_HAS_MULTI_POLL
+		curl_multi_poll(s_multi_handle, nullptr, 0, 1000, nullptr);
+#else
+		curl_multi_wait(s_multi_handle, nullptr, 0, 20, nullptr);
+#endif
+		lock.lock();
+	}
 }
 
 std::string HttpReq::getContent() 
@@ -555,8 +697,7 @@ size_t HttpReq::write_content(void* buff, size_t size, size_t nmemb, void* req_p
 	if (ferror(file))
 	{
 		request->closeStream();			
-		request->mStatus = REQ_FILESTREAM_ERROR;
-		request->mErrorMsg = "IO ERROR (DISK FULL?)";		
+		request->mStreamError = true;
 
 		return 0;
 	}
@@ -577,8 +718,8 @@ size_t HttpReq::write_content(void* buff, size_t size, size_t nmemb, void* req_p
 
 bool HttpReq::wait()
 {
-	while (status() == HttpReq::REQ_IN_PROGRESS)
-		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	std::unique_lock<std::mutex> lock(sLock);
+	sCompleted.wait(lock, [this] { return mStatus != HttpReq::REQ_IN_PROGRESS; });
 
-	return status() == HttpReq::REQ_SUCCESS;
+	return mStatus == HttpReq::REQ_SUCCESS;
 }
@@ -3,6 +3,7 @@
 #define ES_CORE_HTTP_REQ_H
 
 #include <curl/curl.h>
+#include <atomic>
 #include <map>
 #include <sstream>
 #include <fstream>
@@ -12,8 +13,10 @@
 
 /* Usage:
  * HttpReq myRequest("www.google.com", "/index.html");
- * //for blocking behavior: while(myRequest.status() == HttpReq::REQ_IN_PROGRESS);
+ * //for blocking behavior: myRequest.wait();
  * //for non-blocking behavior: check if(myRequest.status() != HttpReq::REQ_IN_PROGRESS) in some sort of update method
+ *
+ * //requests are processed by a network thread : status() only reads the state, polling doesn't drive the transfers
  * 
  * //once one of those completes, the request is ready
  * if(myRequest.status() != REQ_SUCCESS)
@@ -94,6 +97,11 @@ public:
 private:
 	void performRequest(const std::string& url, HttpReqOptions* options);
 	void closeStream();
+	Status onDone(CURLcode result);
+
+	static void startNetworkThread();
+	static void wakeNetworkThread();
+	static void networkThread();
 
 	static size_t write_content(void* buff, size_t size, size_t nmemb, void* req_ptr);
 	static size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata);
@@ -110,7 +118,9 @@ private:
 
 	CURL* mHandle;
 
-	Status mStatus;
+	std::atomic<Status> mStatus;
+	bool mStreamError;
+	bool mCompleting; // The network thread is writing the results, without sLock
 
 	// string steam mode
 	std::stringstream mContent;
@@ -123,8 +133,8 @@ private:
 	std::string mErrorMsg;
 	std::string mUrl;
 
-	int mPercent;
-	int64_t mPosition;
+	std::atomic<int> mPercent;
+	std::atomic<int64_t> mPosition;
 
 	std::map<std::string, std::string> mResponseHeaders;	
 };
@@ -10,7 +10,11 @@
 #include <map>
 #include <unordered_map>
 #include <mutex>
+#include <unordered_set>
+#include <algorithm>
+#include <stdio.h>
 #include "renderers/Renderer.h"
+#include "utils/MappedFile.h"
 #include "Paths.h"
 #include "math/Vector4f.h"
 
@@ -296,31 +300,209 @@ struct CachedFileInfo
 	int y;	
 };
 
+// Sizes of pictures are kept in <user>/imagecache.bin, which is memory-mapped and queried in place :
+// a header, records sorted by path hash for binary search, then records appended by the following sessions.
+// Appended records override the sorted ones (a negative size removes an entry), and are merged into the sorted part once there are too many.
+#define IMAGECACHE_MAGIC		0x43495345 // "ESIC"
+#define IMAGECACHE_VERSION		1
+#define IMAGECACHE_REMOVED		-2
+
+struct ImageCacheHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int sortedCount;
+	unsigned int reserved;
+};
+
+struct ImageCacheRecord
+{
+	unsigned long long hash;
+	int size;
+	int x;
+	int y;
+	int reserved;
+};
+
+// Pictures looked up or updated during this session, by full path
 static std::unordered_map<std::string, CachedFileInfo> sizeCache;
-static bool sizeCacheDirty = false;
+static std::mutex sizeCacheLock;
+
+// Paths of sizeCache entries to write to imagecache.bin (negative sizes are removals)
+static std::unordered_set<std::string> sizeCachePending;
+
+static Utils::MappedFile sIndexFile;
+static const ImageCacheRecord* sIndexRecords = nullptr;
+static size_t sIndexCount = 0;
+static std::unordered_map<unsigned long long, CachedFileInfo> sIndexLog;
+static size_t sIndexLogCount = 0;
 
 std::string getImageCacheFilename()
+{
+	return Paths::getUserEmulationStationPath() + "/imagecache.bin";
+}
+
+static std::string getLegacyImageCacheFilename()
 {
 	return Paths::getUserEmulationStationPath() + "/imagecache.db";
 }
 
+// Entries are keyed by their path relative to the root path, like the former text file, so they survive a move of the root folder
+static unsigned long long getImageCacheHash(const std::string& path)
+{
+	std::string relative = Utils::FileSystem::createRelativePath(path, Paths::getRootPath(), true);
+
+	unsigned long long hash = 14695981039346656037ULL;
+	for (auto c : relative)
+	{
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+// sizeCacheLock must be held
+static bool findInIndex(unsigned long long hash, CachedFileInfo& info)
+{
+	auto it = sIndexLog.find(hash);
+	if (it != sIndexLog.cend())
+	{
+		if (it->second.size == IMAGECACHE_REMOVED)
+			return false;
+
+		info = it->second;
+		return true;
+	}
+
+	auto end = sIndexRecords + sIndexCount;
+	auto record = std::lower_bound(sIndexRecords, end, hash, [](const ImageCacheRecord& r, unsigned long long h) { return r.hash < h; });
+	if (record == end || record->hash != hash)
+		return false;
+
+	info = CachedFileInfo(record->size, record->x, record->y);
+	return true;
+}
+
+static void closeIndex()
+{
+	sIndexFile.close();
+	sIndexRecords = nullptr;
+	sIndexCount = 0;
+	sIndexLog.clear();
+	sIndexLogCount = 0;
+}
+
+static bool openIndex()
+{
+	closeIndex();
+
+	if (!sIndexFile.open(getImageCacheFilename()))
+		return false;
+
+	const ImageCacheHeader* header = (const ImageCacheHeader*)sIndexFile.data();
+
+	size_t recordCount = sIndexFile.size() < sizeof(ImageCacheHeader) ? 0 : (sIndexFile.size() - sizeof(ImageCacheHeader)) / sizeof(ImageCacheRecord);
+	if (sIndexFile.size() < sizeof(ImageCacheHeader) || header->magic != IMAGECACHE_MAGIC || header->version != IMAGECACHE_VERSION || header->sortedCount > recordCount)
+	{
+		LOG(LogWarning) << "ImageIO : invalid image cache, ignoring it";
+		closeIndex();
+		return false;
+	}
+
+	sIndexRecords = (const ImageCacheRecord*)(sIndexFile.data() + sizeof(ImageCacheHeader));
+	sIndexCount = header->sortedCount;
+
+	// Appended records are few, index them in memory
+	for (size_t i = sIndexCount; i < recordCount; i++)
+		sIndexLog[sIndexRecords[i].hash] = CachedFileInfo(sIndexRecords[i].size, sIndexRecords[i].x, sIndexRecords[i].y);
+
+	sIndexLogCount = recordCount - sIndexCount;
+	return true;
+}
+
+static FILE* openImageCacheFile(const std::string& path, bool append)
+{
+#if WIN32
+	return _wfopen(Utils::String::convertToWideString(path).c_str(), append ? L"ab" : L"wb");
+#else
+	return fopen(path.c_str(), append ? "ab" : "wb");
+#endif
+}
+
+// Writes a new file with every record sorted, dropping removed entries
+static bool rewriteIndex(const std::vector<ImageCacheRecord>& newRecords)
+{
+	std::unordered_map<unsigned long long, ImageCacheRecord> merged;
+	merged.reserve(sIndexCount + sIndexLog.size() + newRecords.size());
+
+	for (size_t i = 0; i < sIndexCount; i++)
+		merged[sIndexRecords[i].hash] = sIndexRecords[i];
+
+	for (auto& item : sIndexLog)
+	{
+		ImageCacheRecord record = { item.first, item.second.size, item.second.x, item.second.y, 0 };
+		merged[item.first] = record;
+	}
+
+	for (auto& record : newRecords)
+		merged[record.hash] = record;
+
+	std::vector<ImageCacheRecord> records;
+	records.reserve(merged.size());
+
+	for (auto& item : merged)
+		if (item.second.size != IMAGECACHE_REMOVED)
+			records.push_back(item.second);
+
+	std::sort(records.begin(), records.end(), [](const ImageCacheRecord& a, const ImageCacheRecord& b) { return a.hash < b.hash; });
+
+	ImageCacheHeader header = { IMAGECACHE_MAGIC, IMAGECACHE_VERSION, (unsigned int)records.size(), 0 };
+
+	// The mapping must be released before replacing the file
+	closeIndex();
+
+	std::string path = getImageCacheFilename();
+	std::string tmpPath = path + ".tmp";
+
+	FILE* fp = openImageCacheFile(tmpPath, false);
+	if (fp == nullptr)
+		return false;
+
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 && (records.size() == 0 || fwrite(records.data(), sizeof(ImageCacheRecord), records.size(), fp) == records.size());
+	ok = (fclose(fp) == 0) && ok;
+
+	if (!ok || !Utils::FileSystem::renameFile(tmpPath, path))
+	{
+		Utils::FileSystem::removeFile(tmpPath);
+		return false;
+	}
+
+	return openIndex();
+}
+
 void ImageIO::clearImageCache()
 {
-	std::string fname = getImageCacheFilename();
-	Utils::FileSystem::removeFile(fname);
+	std::unique_lock<std::mutex> lock(sizeCacheLock);
+
+	closeIndex();
+
+	Utils::FileSystem::removeFile(getImageCacheFilename());
+	Utils::FileSystem::removeFile(getLegacyImageCacheFilename());
+
 	sizeCache.clear();
+	sizeCachePending.clear();
 }
 
-void ImageIO::loadImageCache()
+// Imports the text file of the previous versions, it's written as imagecache.bin by the next saveImageCache
+static void loadLegacyImageCache()
 {
-	std::string fname = getImageCacheFilename();
+	std::string fname = getLegacyImageCacheFilename();
 
 	std::ifstream f(fname.c_str());
 	if (f.fail())
 		return;
 
-	sizeCache.clear();
-
 	std::string relativeTo = Paths::getRootPath();
 
 	std::vector<std::string> splits;
@@ -353,12 +535,24 @@ void ImageIO::loadImageCache()
 			fi.y = Utils::String::toInteger(splits[3]);
 
 			sizeCache[file] = fi;
+			sizeCachePending.insert(file);
 		}
 	}
 
 	f.close();
 }
 
+void ImageIO::loadImageCache()
+{
+	std::unique_lock<std::mutex> lock(sizeCacheLock);
+
+	sizeCache.clear();
+	sizeCachePending.clear();
+
+	if (!openIndex())
+		loadLegacyImageCache();
+}
+
 static bool _isCachablePath(const std::string& path)
 {
 	return 
@@ -371,40 +565,68 @@ static bool _isCachablePath(const std::string& path)
 
 void ImageIO::saveImageCache()
 {
-	if (!sizeCacheDirty)
-		return;
+	std::unique_lock<std::mutex> lock(sizeCacheLock);
 
-	std::string fname = getImageCacheFilename();
-	std::ofstream f(fname.c_str(), std::ios::binary);
-	if (f.fail())
+	if (sizeCachePending.size() == 0)
 		return;
 
-	std::string relativeTo = Paths::getRootPath();
+	std::vector<ImageCacheRecord> records;
+	records.reserve(sizeCachePending.size());
 
-	for (auto it : sizeCache)
+	for (auto& path : sizeCachePending)
 	{
-		if (it.second.size < 0)
-			continue;
+		ImageCacheRecord record = { getImageCacheHash(path), IMAGECACHE_REMOVED, 0, 0, 0 };
 
-		if (!_isCachablePath(it.first))
-			continue;
+		auto it = sizeCache.find(path);
+		if (it != sizeCache.cend())
+		{
+			if (!_isCachablePath(path))
+				continue;
+
+			// An image that can't be read anymore is written as removed, so its old size isn't found again
+			if (it->second.size > 0 && it->second.x > 0)
+			{
+				record.size = it->second.size;
+				record.x = it->second.x;
+				record.y = it->second.y;
+			}
+		}
 
-		std::string path = Utils::FileSystem::createRelativePath(it.first, relativeTo, true); 
+		records.push_back(record);
+	}
 
-		f << path;
-		f << "|";
-		f << std::to_string(it.second.size);
-		f << "|";
-		f << std::to_string(it.second.x);
-		f << "|";
-		f << std::to_string(it.second.y);
-		f << "\n";
+	bool saved = false;
+
+	// Append while the unsorted records stay a small part of the file
+	if (sIndexFile.isOpen() && sIndexLogCount + records.size() < std::max<size_t>(1024, sIndexCount / 4))
+	{
+		FILE* fp = openImageCacheFile(getImageCacheFilename(), true);
+		if (fp != nullptr)
+		{
+			saved = records.size() == 0 || fwrite(records.data(), sizeof(ImageCacheRecord), records.size(), fp) == records.size();
+			saved = (fclose(fp) == 0) && saved;
+		}
+
+		if (saved)
+		{
+			for (auto& record : records)
+				sIndexLog[record.hash] = CachedFileInfo(record.size, record.x, record.y);
+
+			sIndexLogCount += records.size();
+		}
 	}
+	else
+		saved = rewriteIndex(records);
 
-	f.close();
-}
+	if (!saved)
+	{
+		LOG(LogError) << "ImageIO : Unable to save " << getImageCacheFilename();
+		return;
+	}
 
-static std::mutex sizeCacheLock;
+	sizeCachePending.clear();
+	Utils::FileSystem::removeFile(getLegacyImageCacheFilename());
+}
 
 void ImageIO::removeImageCache(const std::string& fn)
 {
@@ -413,6 +635,12 @@ void ImageIO::removeImageCache(const std::string& fn)
 	auto it = sizeCache.find(fn);
 	if (it != sizeCache.cend())
 		sizeCache.erase(fn);
+
+	CachedFileInfo info;
+	if (findInIndex(getImageCacheHash(fn), info))
+		sizeCachePending.insert(fn);
+	else
+		sizeCachePending.erase(fn);
 }
 
 void ImageIO::updateImageCache(const std::string& fn, int sz, int x, int y)
@@ -422,25 +650,35 @@ void ImageIO::updateImageCache(const std::string& fn, int sz, int x, int y)
 	auto it = sizeCache.find(fn);
 	if (it != sizeCache.cend())
 	{
-		if (x != it->second.x || y != it->second.y || sz != it->second.size)
-		{
-			auto& item = it->second;
+		if (x == it->second.x && y == it->second.y && sz == it->second.size)
+			return;
 
-			item.x = x;
-			item.y = y;
-			item.size = sz;
+		auto& item = it->second;
 
-			if (sz > 0 && x > 0 && _isCachablePath(fn))
-				sizeCacheDirty = true;
-		}
+		item.x = x;
+		item.y = y;
+		item.size = sz;
 	}
 	else
-	{
 		sizeCache[fn] = CachedFileInfo(sz, x, y);
 
-		if (sz > 0 && x > 0 && _isCachablePath(fn))
-			sizeCacheDirty = true;
+	if (!_isCachablePath(fn))
+		return;
+
+	CachedFileInfo info;
+	bool indexed = findInIndex(getImageCacheHash(fn), info);
+
+	if (sz > 0 && x > 0)
+	{
+		if (!indexed || info.size != sz || info.x != x || info.y != y)
+			sizeCachePending.insert(fn);
+		else
+			sizeCachePending.erase(fn);
 	}
+	else if (indexed)
+		sizeCachePending.insert(fn); // Invalid now : saved as removed
+	else
+		sizeCachePending.erase(fn);
 }
 
 static bool extractSvgSize(const std::string& svgFilePath, float& width, float& height)
@@ -540,6 +778,14 @@ bool ImageIO::loadImageSize(const std::string& fn, unsigned int *x, unsigned int
 			*y = it->second.y;
 			return true;
 		}
+
+		CachedFileInfo info;
+		if (sIndexRecords != nullptr && findInIndex(getImageCacheHash(fn), info))
+		{
+			*x = info.x;
+			*y = info.y;
+			return true;
+		}
 	}
 
 	LOG(LogDebug) << "ImageIO::loadImageSize " << fn;
@@ -2,29 +2,266 @@
 
 #include "utils/FileSystemUtil.h"
 #include "utils/Platform.h"
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
 #include <mutex>
+#include <thread>
 #include "Settings.h"
-#include <iomanip> 
 #include <SDL_timer.h>
+#include <stdint.h>
+#include <time.h>
 #include "Paths.h"
+#include "Tracer.h"
 
 #if WIN32
 #include <Windows.h>
 #endif
 
+// Records are written by a background thread : LOG() only formats the line and pushes it into a bounded ring buffer.
+// The buffer is a multi-producer / single-consumer queue, where each slot has a sequence number telling if it is free or published.
+#define LOG_QUEUE_SIZE	8192 // power of 2
+
+struct LogSlot
+{
+	std::atomic<size_t> sequence;
+	LogLevel level;
+	std::string text;
+};
+
+static LogSlot sSlots[LOG_QUEUE_SIZE];
+static std::atomic<size_t> sEnqueuePos(0);
+static size_t sDequeuePos = 0; // Only used by the writer thread, or after it was stopped
+
+static std::atomic<unsigned int> sDropped(0);
+static unsigned int sDroppedReported = 0;
+
+// Serializes init & close
 static std::mutex mLogLock;
 
-LogLevel Log::mReportingLevel = (LogLevel) -1;
-bool     Log::mDirty          = false;
-FILE*    Log::mFile           = NULL;
+// Held by the writer thread while it writes, and by init while it changes the file
+static std::mutex sFileLock;
 
-void Log::init()
-{		
-	mReportingLevel = (LogLevel)-1;
+// The file records are written to. Log::mFile tells producers whether to queue their records : close clears it first, so nothing is queued after the final drain
+static FILE* sOutput = NULL;
+
+// Threads queuing a record, waited for by close before the final drain
+static std::atomic<int> sProducers(0);
+
+// Set while this thread holds mLogLock in init : exit handlers run by a crash there must not wait for it
+static thread_local bool tInLogInit = false;
+
+// The queue is initialized once : producers may be holding a slot when the log is reopened
+static bool sSlotsInitialized = false;
+
+static std::thread* sWriterThread = nullptr;
+static std::atomic<bool> sWriterExit(false);
+static std::atomic<bool> sWriterSleeping(false);
+static std::mutex sWakeLock;
+static std::condition_variable sWakeCondition;
+
+// Flush requests wait for the writer thread to reach a queue position
+static std::mutex sFlushLock;
+static std::condition_variable sFlushCondition;
+static size_t sFlushedPos = 0;
+
+std::atomic<LogLevel> Log::mReportingLevel((LogLevel) -1);
+std::atomic<FILE*>    Log::mFile(NULL);
+
+static void initSlots()
+{
+	for (size_t i = 0; i < LOG_QUEUE_SIZE; i++)
+		sSlots[i].sequence.store(i, std::memory_order_relaxed);
+
+	sEnqueuePos = 0;
+	sDequeuePos = 0;
+	sFlushedPos = 0;
+	sDropped = 0;
+	sDroppedReported = 0;
+}
+
+// Date and time are formatted again only when the second changes
+static const char* getTimestamp()
+{
+	static thread_local time_t tLastTime = 0;
+	static thread_local char tTimestamp[32] = { 0 };
+
+	time_t t = time(nullptr);
+	if (t != tLastTime)
+	{
+		struct tm tm;
+#if WIN32
+		localtime_s(&tm, &t);
+#else
+		localtime_r(&t, &tm);
+#endif
+		strftime(tTimestamp, sizeof(tTimestamp), "%F %T\t", &tm);
+		tLastTime = t;
+	}
 
-	close();
+	return tTimestamp;
+}
 
+static bool pushRecord(LogLevel level, std::string& text)
+{
+	size_t pos = sEnqueuePos.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		LogSlot& slot = sSlots[pos & (LOG_QUEUE_SIZE - 1)];
+		intptr_t diff = (intptr_t)slot.sequence.load(std::memory_order_acquire) - (intptr_t)pos;
+
+		if (diff == 0)
+		{
+			if (sEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				slot.level = level;
+				slot.text.swap(text);
+				slot.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0)
+			return false; // Full
+		else
+			pos = sEnqueuePos.load(std::memory_order_relaxed);
+	}
+}
+
+static void writeConsole(LogLevel level, const std::string& text)
+{
+	// If it's an error, also print to console
+	// print all messages if using --debug
+	if (level == LogError || Log::getReportingLevel() >= LogDebug)
+	{
+#if WIN32
+		OutputDebugStringA(text.c_str());
+#else
+		fwrite(text.c_str(), 1, text.size(), stderr);
+#endif
+	}
+}
+
+static void writeRecord(LogLevel level, const std::string& text)
+{
+	if (sOutput != NULL)
+		fwrite(text.c_str(), 1, text.size(), sOutput);
+
+	writeConsole(level, text);
+}
+
+// Writes the published records, returns false if there were none
+static bool drainRecords()
+{
+	bool any = false;
+
+	while (true)
+	{
+		LogSlot& slot = sSlots[sDequeuePos & (LOG_QUEUE_SIZE - 1)];
+		if (slot.sequence.load(std::memory_order_acquire) != sDequeuePos + 1)
+			break;
+
+		writeRecord(slot.level, slot.text);
+		slot.text.clear();
+		slot.sequence.store(sDequeuePos + LOG_QUEUE_SIZE, std::memory_order_release);
+
+		sDequeuePos++;
+		any = true;
+	}
+
+	unsigned int dropped = sDropped.load();
+	if (dropped != sDroppedReported)
+	{
+		writeRecord(LogWarning, std::string(getTimestamp()) + "WARNING\tLog : " + std::to_string(dropped - sDroppedReported) + " messages dropped, the log queue was full\n");
+		sDroppedReported = dropped;
+		any = true;
+	}
+
+	return any;
+}
+
+static void notifyFlushed()
+{
+	if (sOutput != NULL)
+		fflush(sOutput);
+
+	std::unique_lock<std::mutex> lock(sFlushLock);
+	sFlushedPos = sDequeuePos;
+	sFlushCondition.notify_all();
+}
+
+static void writerThread()
+{
+	while (true)
+	{
+		bool any;
+
+		{
+			std::unique_lock<std::mutex> fileLock(sFileLock);
+			any = drainRecords();
+
+			// Make what was written visible, and release the flush() waiting for it
+			notifyFlushed();
+		}
+
+		if (any)
+			continue;
+
+		if (sWriterExit)
+			break;
+
+		std::unique_lock<std::mutex> lock(sWakeLock);
+		sWriterSleeping = true;
+
+		if (sSlots[sDequeuePos & (LOG_QUEUE_SIZE - 1)].sequence.load(std::memory_order_acquire) != sDequeuePos + 1 && !sWriterExit)
+			sWakeCondition.wait_for(lock, std::chrono::milliseconds(100));
+
+		sWriterSleeping = false;
+	}
+}
+
+static void wakeWriter()
+{
+	if (sWriterSleeping.load(std::memory_order_acquire))
+	{
+		std::unique_lock<std::mutex> lock(sWakeLock);
+		sWakeCondition.notify_one();
+	}
+}
+
+static void stopWriter()
+{
+	if (sWriterThread == nullptr)
+		return;
+
+	if (sWriterThread->get_id() == std::this_thread::get_id())
+	{
+		// Crashed while writing : finish from here
+		sWriterThread->detach();
+	}
+	else
+	{
+		sWriterExit = true;
+
+		{
+			std::unique_lock<std::mutex> lock(sWakeLock);
+			sWakeCondition.notify_one();
+		}
+
+		sWriterThread->join();
+	}
+
+	delete sWriterThread;
+	sWriterThread = nullptr;
+
+	// Records pushed while the thread was stopping
+	drainRecords();
+	notifyFlushed();
+}
+
+// Also called when the log level is changed : the queue and the writer thread are kept, only the file is opened again
+void Log::init()
+{
 	LogLevel lvl = LogInfo;
 
 	if (Settings::getInstance()->getBool("Debug"))
@@ -47,29 +284,57 @@ void Log::init()
 	auto logPath = Paths::getUserEmulationStationPath() + "/es_log.txt";
 	auto bakPath = logPath + ".bak";
 
-	if ((int)lvl < 0) 
-	{		
-		Utils::FileSystem::removeFile(logPath);
-		return;
+	std::unique_lock<std::mutex> lock(mLogLock);
+	tInLogInit = true;
+
+	if (!sSlotsInitialized)
+	{
+		initSlots();
+		sSlotsInitialized = true;
 	}
-	
-	Utils::FileSystem::removeFile(bakPath);
-	Utils::FileSystem::renameFile(logPath, bakPath);
 
-	bool locked = mLogLock.try_lock();
+	// Records queued until now belong to the previous file
+	flush();
+
+	{
+		std::unique_lock<std::mutex> fileLock(sFileLock);
+
+		mFile = NULL;
+
+		if (sOutput != NULL)
+		{
+			fclose(sOutput);
+			sOutput = NULL;
+		}
+
+		mReportingLevel = lvl;
+
+		if ((int)lvl < 0)
+		{
+			Utils::FileSystem::removeFile(logPath);
+			tInLogInit = false;
+			return;
+		}
+
+		Utils::FileSystem::removeFile(bakPath);
+		Utils::FileSystem::renameFile(logPath, bakPath);
 
-	mFile = fopen(logPath.c_str(), "w");
-	mDirty = false;
-	mReportingLevel = lvl;
+		sOutput = fopen(logPath.c_str(), "w");
+		mFile = sOutput;
+	}
+
+	if (mFile != NULL && sWriterThread == nullptr)
+	{
+		sWriterExit = false;
+		sWriterThread = new std::thread(writerThread);
+	}
 
-	if (locked)
-		mLogLock.unlock();
+	tInLogInit = false;
 }
 
 std::ostringstream& Log::get(LogLevel level)
 {
-	time_t t = time(nullptr);
-	mStream << std::put_time(localtime(&t), "%F %T\t");
+	mStream << getTimestamp();
 
 	switch (level)
 	{
@@ -94,71 +359,109 @@ std::ostringstream& Log::get(LogLevel level)
 
 void Log::flush()
 {
-	if (!mDirty)
+	if (sWriterThread == nullptr || sWriterThread->get_id() == std::this_thread::get_id())
 		return;
 
-	if (mLogLock.try_lock())
-	{
-		if (mFile != nullptr)
-			fflush(mFile);
+	size_t target = sEnqueuePos.load();
 
-		mDirty = false;
-		mLogLock.unlock();
+	std::unique_lock<std::mutex> lock(sFlushLock);
+	if (sFlushedPos >= target)
+		return;
+
+	{
+		std::unique_lock<std::mutex> wakeLock(sWakeLock);
+		sWakeCondition.notify_one();
 	}
+
+	// Bounded : a record may be reserved by a thread that never publishes it
+	sFlushCondition.wait_for(lock, std::chrono::seconds(1), [target] { return sFlushedPos >= target; });
 }
 
 void Log::close()
 {
-	bool locked = mLogLock.try_lock();
+	// Crashed in init, and called by the exit handlers : mLogLock is already held by this thread
+	if (tInLogInit)
+		return;
+
+	std::unique_lock<std::mutex> lock(mLogLock);
+
+	// Records logged from now on only reach the console, the ones being queued are written by the final drain
+	mFile = NULL;
+
+	// Bounded : a producer may have crashed while queuing
+	for (int i = 0; i < 1000 && sProducers > 0; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
 
-	if (mFile != NULL)
+	stopWriter();
+
+	if (sOutput != NULL)
 	{
-		fflush(mFile);
-		fclose(mFile);
-		mFile = NULL;
+		fflush(sOutput);
+		fclose(sOutput);
+		sOutput = NULL;
 	}
-
-	mDirty = false;
-	
-	if (locked)
-		mLogLock.unlock();
 }
 
-Log::~Log()
+static void queueRecord(LogLevel level, std::string& text)
 {
-	bool locked = mLogLock.try_lock();
+	if (pushRecord(level, text))
+	{
+		if (level == LogError)
+			wakeWriter();
 
-	if (mFile != NULL)
+		return;
+	}
+
+	if (level != LogError)
 	{
-		mStream << std::endl;
-		fprintf(mFile, "%s", mStream.str().c_str());
-		mDirty = true;
+		sDropped++;
+		wakeWriter();
+		return;
 	}
-	
-	// If it's an error, also print to console
-	// print all messages if using --debug
-	if (mMessageLevel == LogError || mReportingLevel >= LogDebug)
+
+	// Errors are never dropped : wait for some room
+	for (int i = 0; i < 1000 && sWriterThread != nullptr; i++)
 	{
-#if WIN32
-		OutputDebugStringA(mStream.str().c_str());
-#else
-		fprintf(stderr, "%s", mStream.str().c_str());
-#endif
+		wakeWriter();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		if (pushRecord(level, text))
+			return;
 	}
 
-	if (locked)
-		mLogLock.unlock();
+	sDropped++;
+}
+
+Log::~Log()
+{
+	mStream << std::endl;
+
+	std::string text = mStream.str();
+
+	sProducers++;
+
+	// No log file (it couldn't be created, or it was closed) : errors still reach the console
+	if (mFile == NULL)
+		writeConsole(mMessageLevel, text);
+	else
+		queueRecord(mMessageLevel, text);
+
+	sProducers--;
 }
 
 StopWatch::StopWatch(const std::string& elapsedMillisecondsMessage, LogLevel level)
-{ 
-	mMessage = elapsedMillisecondsMessage; 
+{
+	mMessage = elapsedMillisecondsMessage;
 	mLevel = level;
 	mStartTicks = SDL_GetTicks();
+	mTraceStart = Tracer::enabled() ? Tracer::now() : 0;
 }
 
 StopWatch::~StopWatch()
 {
 	int elapsed = SDL_GetTicks() - mStartTicks;
 	LOG(mLevel) << mMessage << " " << elapsed << "ms";
+
+	if (mTraceStart != 0)
+		Tracer::span("StopWatch", mMessage, mTraceStart, Tracer::now());
 }
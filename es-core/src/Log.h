@@ -2,8 +2,10 @@
 #ifndef ES_CORE_LOG_H
 #define ES_CORE_LOG_H
 
+#include <atomic>
 #include <sstream>
 #include <exception>
+#include <stdio.h>
 	
 #define LOG(level) if(!Log::enabled() || level > Log::getReportingLevel()) ; else Log().get(level)
 
@@ -13,23 +15,29 @@ catch (...) { LOG(LogError) << m << " Unknown Exception occured"; Log::flush();
 
 enum LogLevel { LogError, LogWarning, LogInfo, LogDebug };
 
+// Lines are formatted by the calling thread, then queued and written by a background thread, so logging doesn't block on file I/O.
+// When the queue is full, messages are dropped (except errors) and the number of dropped messages is logged.
 class Log
 {
 public:
 	~Log();
 	std::ostringstream& get(LogLevel level = LogInfo);
 
-	static inline LogLevel& getReportingLevel() { return mReportingLevel; }
-	static inline bool enabled() { return mFile != NULL; }
+	// Read by every LOG() while init may change them
+	static inline LogLevel getReportingLevel() { return mReportingLevel.load(std::memory_order_relaxed); }
+	static inline bool enabled() { return mFile.load(std::memory_order_relaxed) != NULL; }
+	static inline FILE* getFile() { return mFile.load(std::memory_order_relaxed); }
 
 	static void init();
+
+	// Waits until the queued messages are written to the file
 	static void flush();
+	// Writes the queued messages and closes the file
 	static void close();
 	
 private:
-	static LogLevel     mReportingLevel;
-	static bool         mDirty;
-	static FILE*        mFile;
+	static std::atomic<LogLevel>	mReportingLevel;
+	static std::atomic<FILE*>		mFile;
 
 protected:
 	std::ostringstream  mStream;
@@ -46,6 +54,7 @@ private:
 	std::string mMessage;
 	LogLevel    mLevel;
 	int         mStartTicks;
+	long long   mTraceStart;
 };
 
 #endif // ES_CORE_LOG_H
@@ -40,6 +40,8 @@ IMPLEMENT_STATIC_BOOL_SETTING(ShowNetworkIndicator, true)
 
 void Settings::updateCachedSetting(const std::string& name)
 {
+	SettingsRegistry::invalidate(name);
+
 	UPDATE_STATIC_BOOL_SETTING_EX("audio.bgmusic", BackgroundMusic)
 	UPDATE_STATIC_BOOL_SETTING(DebugText)
 	UPDATE_STATIC_BOOL_SETTING(DebugImage)
@@ -303,6 +305,11 @@ void Settings::setDefaults()
 	mStringMap["DefaultGridSize"] = "";
 
 	mBoolMap["ThreadedLoading"] = true;
+	mBoolMap["GamelistSnapshots"] = true;
+	mBoolMap["PersistentDirectoryIndex"] = true;
+	mBoolMap["ParallelGamelistParsing"] = true;
+	mBoolMap["GamelistJournal"] = true;
+	mBoolMap["ThumbnailCache"] = true;
 	mBoolMap["AsyncImages"] = true;
 	mBoolMap["PreloadUI"] = false;
 	mBoolMap["PreloadMedias"] = Settings::_PreloadMedias;
@@ -6,12 +6,13 @@
 #include <string>
 #include <vector>
 #include "utils/Delegate.h"
+#include "SettingsRegistry.h"
 
-// Non-cached settings macros
-#define DEFINE_BOOL_SETTING(XX) static bool XX() { return Settings::getInstance()->getBool(#XX); }; static bool set##XX(bool val) { return Settings::getInstance()->setBool(#XX, val); };
-#define DEFINE_INT_SETTING(XX) static int XX() { return Settings::getInstance()->getInt(#XX); }; static bool set##XX(int val) { return Settings::getInstance()->setInt(#XX, val); };
-#define DEFINE_FLOAT_SETTING(XX) static float XX() { return Settings::getInstance()->getFloat(#XX); }; static bool set##XX(float val) { return Settings::getInstance()->setFloat(#XX, val); };
-#define DEFINE_STRING_SETTING(XX) static std::string XX() { return Settings::getInstance()->getString(#XX); }; static bool set##XX(const std::string& val) { return Settings::getInstance()->setString(#XX, val); };
+// Settings read through a SettingsRegistry handle, resolved at the first call
+#define DEFINE_BOOL_SETTING(XX) static bool XX() { static BoolSetting* handle = SettingsRegistry::getBool(#XX); return handle->get(); }; static bool set##XX(bool val) { return Settings::getInstance()->setBool(#XX, val); };
+#define DEFINE_INT_SETTING(XX) static int XX() { static IntSetting* handle = SettingsRegistry::getInt(#XX); return handle->get(); }; static bool set##XX(int val) { return Settings::getInstance()->setInt(#XX, val); };
+#define DEFINE_FLOAT_SETTING(XX) static float XX() { static FloatSetting* handle = SettingsRegistry::getFloat(#XX); return handle->get(); }; static bool set##XX(float val) { return Settings::getInstance()->setFloat(#XX, val); };
+#define DEFINE_STRING_SETTING(XX) static std::string XX() { static StringSetting* handle = SettingsRegistry::getString(#XX); return *handle->get(); }; static bool set##XX(const std::string& val) { return Settings::getInstance()->setString(#XX, val); };
 
 // Cached static settings macros
 #define DECLARE_STATIC_BOOL_SETTING(XX) \
@@ -93,10 +94,16 @@ public:
 	DEFINE_BOOL_SETTING(RemoveMultiDiskContent)	
 	DEFINE_BOOL_SETTING(ParseGamelistOnly)
 	DEFINE_BOOL_SETTING(ThreadedLoading)
+	DEFINE_BOOL_SETTING(GamelistSnapshots)
+	DEFINE_BOOL_SETTING(PersistentDirectoryIndex)
+	DEFINE_BOOL_SETTING(ParallelGamelistParsing)
+	DEFINE_BOOL_SETTING(GamelistJournal)
+	DEFINE_BOOL_SETTING(ThumbnailCache)
 	DEFINE_BOOL_SETTING(CheevosCheckIndexesAtStart)
 	DEFINE_BOOL_SETTING(NetPlayCheckIndexesAtStart)
 	DEFINE_BOOL_SETTING(NetPlayShowMissingGames)			
 	DEFINE_BOOL_SETTING(LoadEmptySystems)		
+	DEFINE_BOOL_SETTING(ForceDisableFilters)
 	DEFINE_STRING_SETTING(HiddenSystems)
 	DEFINE_STRING_SETTING(TransitionStyle)
 	DEFINE_STRING_SETTING(GameTransitionStyle)		
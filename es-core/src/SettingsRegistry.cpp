@@ -0,0 +1,155 @@
+#include "SettingsRegistry.h"
+
+#include "utils/StringUtil.h"
+#include "Settings.h"
+#include "SystemConf.h"
+#include <functional>
+#include <unordered_map>
+
+static std::mutex sLock;
+static std::unordered_map<std::string, std::vector<SettingHandle*>> sHandles;
+
+SettingHandle::SettingHandle(const std::string& name, SettingSource source) : mName(name), mSource(source), mOutdated(true), mVersion(0)
+{
+
+}
+
+void SettingHandle::invalidate()
+{
+	mOutdated.store(true, std::memory_order_release);
+	mVersion++;
+}
+
+void SettingHandle::refresh()
+{
+	std::unique_lock<std::mutex> lock(mUpdateLock);
+
+	// Cleared before reading : a change made while parsing outdates the value again
+	if (mOutdated.exchange(false, std::memory_order_acq_rel))
+		update();
+}
+
+std::string SettingHandle::readString()
+{
+	if (mSource == SettingSource::SystemConf)
+		return SystemConf::getInstance()->get(mName);
+
+	return Settings::getInstance()->getString(mName);
+}
+
+bool SettingHandle::readBool()
+{
+	if (mSource == SettingSource::SystemConf)
+		return SystemConf::getInstance()->getBool(mName);
+
+	return Settings::getInstance()->getBool(mName);
+}
+
+int SettingHandle::readInt()
+{
+	if (mSource == SettingSource::SystemConf)
+		return Utils::String::toInteger(SystemConf::getInstance()->get(mName));
+
+	return Settings::getInstance()->getInt(mName);
+}
+
+float SettingHandle::readFloat()
+{
+	if (mSource == SettingSource::SystemConf)
+		return Utils::String::toFloat(SystemConf::getInstance()->get(mName));
+
+	return Settings::getInstance()->getFloat(mName);
+}
+
+void BoolSetting::update()
+{
+	if (mSource == SettingSource::SystemConf)
+		mValue = SystemConf::getInstance()->getBool(mName, mDefaultValue);
+	else
+		mValue = readBool();
+}
+
+void ListSetting::update()
+{
+	std::string value = readString();
+	if (mLowerCase)
+		value = Utils::String::toLower(value);
+
+	publish(std::make_shared<std::vector<std::string>>(Utils::String::split(value, mSeparator)));
+}
+
+template<typename T, typename Predicate>
+static T* findOrCreate(const std::string& name, SettingSource source, Predicate isSame, const std::function<T*()>& create)
+{
+	std::unique_lock<std::mutex> lock(sLock);
+
+	auto& handles = sHandles[name];
+	for (auto handle : handles)
+	{
+		T* typed = dynamic_cast<T*>(handle);
+		if (typed != nullptr && typed->getSource() == source && isSame(typed))
+			return typed;
+	}
+
+	T* handle = create();
+	handles.push_back(handle);
+	return handle;
+}
+
+BoolSetting* SettingsRegistry::getBool(const std::string& name, SettingSource source, bool defaultValue)
+{
+	return findOrCreate<BoolSetting>(name, source, [](BoolSetting*) { return true; }, [&]() { return new BoolSetting(name, source, defaultValue); });
+}
+
+IntSetting* SettingsRegistry::getInt(const std::string& name, SettingSource source)
+{
+	return findOrCreate<IntSetting>(name, source, [](IntSetting*) { return true; }, [&]() { return new IntSetting(name, source); });
+}
+
+FloatSetting* SettingsRegistry::getFloat(const std::string& name, SettingSource source)
+{
+	return findOrCreate<FloatSetting>(name, source, [](FloatSetting*) { return true; }, [&]() { return new FloatSetting(name, source); });
+}
+
+StringSetting* SettingsRegistry::getString(const std::string& name, SettingSource source)
+{
+	return findOrCreate<StringSetting>(name, source, [](StringSetting*) { return true; }, [&]() { return new StringSetting(name, source); });
+}
+
+ListSetting* SettingsRegistry::getList(const std::string& name, char separator, bool lowerCase, SettingSource source)
+{
+	return findOrCreate<ListSetting>(name, source,
+		[separator, lowerCase](ListSetting* handle) { return handle->getSeparator() == separator && handle->isLowerCase() == lowerCase; },
+		[&]() { return new ListSetting(name, source, separator, lowerCase); });
+}
+
+void SettingsRegistry::invalidate(const std::string& name)
+{
+	std::vector<SettingHandle*> handles;
+
+	{
+		std::unique_lock<std::mutex> lock(sLock);
+
+		auto it = sHandles.find(name);
+		if (it == sHandles.cend())
+			return;
+
+		handles = it->second;
+	}
+
+	// Listeners are called unlocked : they may resolve other settings
+	for (auto handle : handles)
+	{
+		handle->invalidate();
+		handle->changed.invoke([name](ISettingsChangedEvent* c) { c->onSettingChanged(name); });
+	}
+}
+
+void SettingsRegistry::invalidateAll()
+{
+	std::unique_lock<std::mutex> lock(sLock);
+
+	for (auto& item : sHandles)
+		for (auto handle : item.second)
+			handle->invalidate();
+}
@@ -0,0 +1,167 @@
+#pragma once
+#ifndef ES_CORE_SETTINGS_REGISTRY_H
+#define ES_CORE_SETTINGS_REGISTRY_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "utils/Delegate.h"
+
+class ISettingsChangedEvent;
+
+enum class SettingSource
+{
+	Settings,	// es_settings.cfg
+	SystemConf	// batocera.conf
+};
+
+// A setting resolved once by name. The value is parsed on the first read after a change, then read without any lookup.
+class SettingHandle
+{
+public:
+	SettingHandle(const std::string& name, SettingSource source);
+	virtual ~SettingHandle() { }
+
+	const std::string& getName() const { return mName; }
+	SettingSource getSource() const { return mSource; }
+
+	// Incremented each time the value is changed
+	unsigned int getVersion() const { return mVersion.load(std::memory_order_acquire); }
+
+	// Invoked on the thread changing the value, with the name of the setting
+	Delegate<ISettingsChangedEvent> changed;
+
+	void invalidate();
+
+protected:
+	inline void check()
+	{
+		if (mOutdated.load(std::memory_order_acquire))
+			refresh();
+	}
+
+	virtual void update() = 0;
+
+	std::string readString();
+	bool readBool();
+	int readInt();
+	float readFloat();
+
+	std::string mName;
+	SettingSource mSource;
+
+private:
+	void refresh();
+
+	std::atomic<bool> mOutdated;
+	std::atomic<unsigned int> mVersion;
+	std::mutex mUpdateLock;
+};
+
+template<typename T>
+class ScalarSetting : public SettingHandle
+{
+public:
+	ScalarSetting(const std::string& name, SettingSource source) : SettingHandle(name, source), mValue(T()) { }
+
+	T get() { check(); return mValue.load(std::memory_order_relaxed); }
+
+protected:
+	std::atomic<T> mValue;
+};
+
+class BoolSetting : public ScalarSetting<bool>
+{
+public:
+	BoolSetting(const std::string& name, SettingSource source, bool defaultValue) : ScalarSetting<bool>(name, source), mDefaultValue(defaultValue) { }
+
+protected:
+	void update() override;
+
+private:
+	bool mDefaultValue;
+};
+
+class IntSetting : public ScalarSetting<int>
+{
+public:
+	IntSetting(const std::string& name, SettingSource source) : ScalarSetting<int>(name, source) { }
+
+protected:
+	void update() override { mValue = readInt(); }
+};
+
+class FloatSetting : public ScalarSetting<float>
+{
+public:
+	FloatSetting(const std::string& name, SettingSource source) : ScalarSetting<float>(name, source) { }
+
+protected:
+	void update() override { mValue = readFloat(); }
+};
+
+// Values that can't be read atomically are published as immutable snapshots : a reader keeps the one it got, even if the setting changes meanwhile
+template<typename T>
+class SnapshotSetting : public SettingHandle
+{
+public:
+	SnapshotSetting(const std::string& name, SettingSource source) : SettingHandle(name, source), mValue(std::make_shared<T>()) { }
+
+	std::shared_ptr<const T> get() { check(); return std::atomic_load(&mValue); }
+
+protected:
+	void publish(const std::shared_ptr<const T>& value) { std::atomic_store(&mValue, value); }
+
+private:
+	std::shared_ptr<const T> mValue;
+};
+
+class StringSetting : public SnapshotSetting<std::string>
+{
+public:
+	StringSetting(const std::string& name, SettingSource source) : SnapshotSetting<std::string>(name, source) { }
+
+	// Per-system overrides : "1" and "0" force the value, anything else keeps the global one
+	int getOverride() { auto value = get(); return *value == "1" ? 1 : *value == "0" ? 0 : -1; }
+
+protected:
+	void update() override { publish(std::make_shared<std::string>(readString())); }
+};
+
+// Separated values, split once
+class ListSetting : public SnapshotSetting<std::vector<std::string>>
+{
+public:
+	ListSetting(const std::string& name, SettingSource source, char separator, bool lowerCase) : SnapshotSetting<std::vector<std::string>>(name, source), mSeparator(separator), mLowerCase(lowerCase) { }
+
+	char getSeparator() const { return mSeparator; }
+	bool isLowerCase() const { return mLowerCase; }
+
+protected:
+	void update() override;
+
+private:
+	char mSeparator;
+	bool mLowerCase;
+};
+
+// Creates the setting handles, and tells them when their value changes.
+// Handles are never deleted : resolve them once, and keep the pointer.
+class SettingsRegistry
+{
+public:
+	static BoolSetting* getBool(const std::string& name, SettingSource source = SettingSource::Settings, bool defaultValue = false);
+	static IntSetting* getInt(const std::string& name, SettingSource source = SettingSource::Settings);
+	static FloatSetting* getFloat(const std::string& name, SettingSource source = SettingSource::Settings);
+	static StringSetting* getString(const std::string& name, SettingSource source = SettingSource::Settings);
+	static ListSetting* getList(const std::string& name, char separator = ';', bool lowerCase = false, SettingSource source = SettingSource::Settings);
+
+	// Called by Settings & SystemConf when a value is changed
+	static void invalidate(const std::string& name);
+	// Called when a whole file is loaded
+	static void invalidateAll();
+};
+
+#endif // ES_CORE_SETTINGS_REGISTRY_H
@@ -5,6 +5,7 @@
 #include "utils/StringUtil.h"
 #include "utils/FileSystemUtil.h"
 #include "Settings.h"
+#include "SettingsRegistry.h"
 #include "Paths.h"
 
 #include <set>
@@ -96,6 +97,7 @@ bool SystemConf::loadSystemConf()
 		return false;
 	}
 
+	SettingsRegistry::invalidateAll();
 	return true;
 }
 
@@ -227,12 +229,22 @@ std::string SystemConf::get(const std::string &name)
 bool SystemConf::set(const std::string &name, const std::string &value) 
 {
 	if (mSystemConfFile.empty())
-		return Settings::getInstance()->setString(mapSettingsName(name), value == "auto" ? "" : value);
+	{
+		if (!Settings::getInstance()->setString(mapSettingsName(name), value == "auto" ? "" : value))
+			return false;
+
+		// Settings already notified the mapped name
+		if (mapSettingsName(name) != name)
+			SettingsRegistry::invalidate(name);
+
+		return true;
+	}
 
 	if (confMap.count(name) == 0 || confMap[name] != value)
 	{
 		confMap[name] = value;
 		mWasChanged = true;
+		SettingsRegistry::invalidate(name);
 		return true;
 	}
 
@@ -253,7 +265,16 @@ bool SystemConf::getBool(const std::string &name, bool defaultValue)
 bool SystemConf::setBool(const std::string &name, bool value)
 {
 	if (mSystemConfFile.empty())
-		return Settings::getInstance()->setBool(mapSettingsName(name), value);
+	{
+		if (!Settings::getInstance()->setBool(mapSettingsName(name), value))
+			return false;
+
+		// Settings already notified the mapped name
+		if (mapSettingsName(name) != name)
+			SettingsRegistry::invalidate(name);
+
+		return true;
+	}
 
 	return set(name, value  ? "1" : "0");
 }
@@ -0,0 +1,214 @@
+#include "Tracer.h"
+
+#include "utils/StringUtil.h"
+#include "Log.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+
+// Bounds the memory used by a long trace, per thread
+#define TRACE_MAX_EVENTS	(1 << 20)
+
+struct TraceEvent
+{
+	const char* name;
+	std::string arg;
+	char phase; // 'X' span, 'C' counter, 'i' instant
+	long long timestamp;
+	long long duration;
+	double value;
+};
+
+struct TraceBuffer
+{
+	std::mutex lock; // Only contended while the trace is written
+	int threadId;
+	std::string threadName;
+	std::vector<TraceEvent> events;
+	int dropped;
+};
+
+std::atomic<bool> Tracer::sEnabled(false);
+
+static std::mutex sBuffersLock;
+static std::vector<std::shared_ptr<TraceBuffer>> sBuffers; // Kept when their thread exits, so its events are still written
+static int sNextThreadId = 1;
+
+static std::string sOutputPath;
+static long long sStartTime = 0;
+
+static thread_local std::shared_ptr<TraceBuffer> tBuffer;
+
+static TraceBuffer* getBuffer()
+{
+	if (tBuffer == nullptr)
+	{
+		tBuffer = std::make_shared<TraceBuffer>();
+		tBuffer->dropped = 0;
+
+		std::unique_lock<std::mutex> lock(sBuffersLock);
+		tBuffer->threadId = sNextThreadId++;
+		sBuffers.push_back(tBuffer);
+	}
+
+	return tBuffer.get();
+}
+
+static void addEvent(const char* name, const std::string& arg, char phase, long long timestamp, long long duration, double value)
+{
+	TraceBuffer* buffer = getBuffer();
+
+	std::unique_lock<std::mutex> lock(buffer->lock);
+	if (buffer->events.size() >= TRACE_MAX_EVENTS)
+	{
+		buffer->dropped++;
+		return;
+	}
+
+	buffer->events.push_back({ name, arg, phase, timestamp, duration, value });
+}
+
+static std::string escapeJson(const std::string& text)
+{
+	std::string ret;
+	ret.reserve(text.size());
+
+	for (auto c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			ret += '\\';
+			ret += c;
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char hex[8];
+			snprintf(hex, sizeof(hex), "\\u%04x", (unsigned char)c);
+			ret += hex;
+		}
+		else
+			ret += c;
+	}
+
+	return ret;
+}
+
+long long Tracer::now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::start(const std::string& outputPath)
+{
+	{
+		std::unique_lock<std::mutex> lock(sBuffersLock);
+		for (auto& buffer : sBuffers)
+		{
+			std::unique_lock<std::mutex> bufferLock(buffer->lock);
+			buffer->events.clear();
+			buffer->dropped = 0;
+		}
+	}
+
+	sOutputPath = outputPath;
+	sStartTime = now();
+	sEnabled = true;
+
+	LOG(LogInfo) << "Tracer : recording to " << outputPath;
+}
+
+void Tracer::stop()
+{
+	if (!sEnabled)
+		return;
+
+	sEnabled = false;
+
+#if WIN32
+	FILE* file = _wfopen(Utils::String::convertToWideString(sOutputPath).c_str(), L"wb");
+#else
+	FILE* file = fopen(sOutputPath.c_str(), "wb");
+#endif
+	if (file == nullptr)
+	{
+		LOG(LogError) << "Tracer : Unable to write " << sOutputPath;
+		return;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	bool first = true;
+	int count = 0;
+	int dropped = 0;
+
+	std::unique_lock<std::mutex> lock(sBuffersLock);
+
+	for (auto& buffer : sBuffers)
+	{
+		std::unique_lock<std::mutex> bufferLock(buffer->lock);
+
+		std::string threadName = buffer->threadName.empty() ? "Thread " + std::to_string(buffer->threadId) : buffer->threadName;
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buffer->threadId, escapeJson(threadName).c_str());
+		first = false;
+
+		for (auto& evt : buffer->events)
+		{
+			long long ts = evt.timestamp - sStartTime;
+
+			if (evt.phase == 'X')
+			{
+				fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld", evt.name, buffer->threadId, ts, evt.duration);
+				if (!evt.arg.empty())
+					fprintf(file, ",\"args\":{\"detail\":\"%s\"}", escapeJson(evt.arg).c_str());
+				fprintf(file, "}");
+			}
+			else if (evt.phase == 'C')
+				fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"args\":{\"value\":%g}}", evt.name, buffer->threadId, ts, evt.value);
+			else
+				fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%d,\"ts\":%lld}", evt.name, buffer->threadId, ts);
+
+			count++;
+		}
+
+		dropped += buffer->dropped;
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	LOG(LogInfo) << "Tracer : " << count << " events written to " << sOutputPath << (dropped > 0 ? " (" + std::to_string(dropped) + " dropped)" : "");
+}
+
+void Tracer::counter(const char* name, double value)
+{
+	addEvent(name, std::string(), 'C', now(), 0, value);
+}
+
+void Tracer::frame()
+{
+	addEvent("Frame", std::string(), 'i', now(), 0, 0);
+}
+
+void Tracer::setThreadName(const std::string& name)
+{
+	if (!enabled())
+		return;
+
+	TraceBuffer* buffer = getBuffer();
+
+	std::unique_lock<std::mutex> lock(buffer->lock);
+	buffer->threadName = name;
+}
+
+void Tracer::span(const char* name, const std::string& arg, long long start, long long end)
+{
+	if (enabled())
+		addEvent(name, arg, 'X', start, end - start, 0);
+}
+
+void Tracer::complete(const char* name, const std::string& arg, long long start)
+{
+	addEvent(name, arg, 'X', start, now() - start, 0);
+}
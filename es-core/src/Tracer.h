@@ -0,0 +1,58 @@
+#pragma once
+#ifndef ES_CORE_TRACER_H
+#define ES_CORE_TRACER_H
+
+#include <atomic>
+#include <string>
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Records a span from here to the end of the enclosing scope. name must be a string literal.
+#define TRACE_SCOPE(name) Tracer::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+// Same, with a runtime detail shown in the arguments of the span (a system name, a file...)
+#define TRACE_SCOPE_ARG(name, arg) Tracer::Scope TRACE_CONCAT(traceScope, __LINE__)(name, Tracer::enabled() ? std::string(arg) : std::string())
+
+#define TRACE_COUNTER(name, value) if (!Tracer::enabled()) ; else Tracer::counter(name, (double)(value))
+#define TRACE_FRAME() if (!Tracer::enabled()) ; else Tracer::frame()
+
+// Scoped-span tracing, exported as Chrome trace JSON (chrome://tracing, https://ui.perfetto.dev).
+// Events are stored in per-thread buffers, and written when tracing stops. When tracing is off, a span costs a relaxed atomic load.
+class Tracer
+{
+public:
+	static inline bool enabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+	static void start(const std::string& outputPath);
+	// Writes the trace file
+	static void stop();
+
+	static void counter(const char* name, double value);
+	static void frame();
+
+	// Shown instead of the thread id in the viewers
+	static void setThreadName(const std::string& name);
+
+	class Scope
+	{
+	public:
+		Scope(const char* name) : mName(enabled() ? name : nullptr) { if (mName != nullptr) mStart = now(); }
+		Scope(const char* name, const std::string& arg) : mName(enabled() ? name : nullptr), mArg(arg) { if (mName != nullptr) mStart = now(); }
+		~Scope() { if (mName != nullptr) complete(mName, mArg, mStart); }
+
+	private:
+		const char* mName;
+		std::string mArg;
+		long long mStart;
+	};
+
+	static void span(const char* name, const std::string& arg, long long start, long long end);
+	static long long now(); // microseconds
+
+private:
+	static void complete(const char* name, const std::string& arg, long long start);
+
+	static std::atomic<bool> sEnabled;
+};
+
+#endif // ES_CORE_TRACER_H
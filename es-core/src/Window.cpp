@@ -7,6 +7,7 @@
 #include "resources/TextureResource.h"
 #include "InputManager.h"
 #include "Log.h"
+#include "Tracer.h"
 #include "Scripting.h"
 #include <algorithm>
 #include <iomanip>
@@ -196,6 +197,8 @@ void Window::deinit(bool deinitRenderer)
 		InputManager::getInstance()->deinit();
 
 	TextureResource::clearQueue();
+	// sTextureDataManager is static : its destructor runs after the log is closed
+	TextureResource::logStatistics();
 	ResourceManager::getInstance()->unloadAll();
 
 	if (deinitRenderer)
@@ -428,6 +431,8 @@ void Window::processSongTitleNotifications()
 
 void Window::update(int deltaTime)
 {
+	TRACE_SCOPE("Window::update");
+
 	if (mLastShowCursor >= 0)
 	{
 		mLastShowCursor += deltaTime;
@@ -649,6 +654,9 @@ void Window::resetMenuBackgroundShader()
 
 void Window::render()
 {
+	TRACE_SCOPE("Window::render");
+	TRACE_COUNTER("Texture memory (MB)", TextureResource::getTotalMemUsage() / (1024.0 * 1024.0));
+
 	Transform4x4f transform = Transform4x4f::Identity();
 
 	mRenderedHelpPrompts = false;
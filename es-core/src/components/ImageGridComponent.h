@@ -395,6 +395,31 @@ void ImageGridComponent<T>::ensureVisibleTileExist()
 				entry.data.tile->onHide();
 		}
 	}
+
+	// A hidden grid has just cancelled the textures of its tiles
+	if (!mShowing)
+		return;
+
+	// Tiles of the extra rows are not rendered on screen yet : load them after the visible ones
+	int onScreenStart = range.x() + EXTRAITEMS * dimOpposite;
+	int onScreenEnd = range.y() - EXTRAITEMS * dimOpposite;
+
+	for (int i = startIndex; i <= endIndex; i++)
+	{
+		if (i >= onScreenStart && i < onScreenEnd)
+			continue;
+
+		auto tile = mEntries[i].data.tile;
+		if (tile == nullptr || !tile->isVisible())
+			continue;
+
+		for (auto marquee : { false, true })
+		{
+			auto texture = tile->getTexture(marquee);
+			if (texture != nullptr && !texture->isLoaded())
+				texture->prefetch();
+		}
+	}
 }
 
 template<typename T>
@@ -3,6 +3,7 @@
 #include "math/Misc.h"
 #include "renderers/Renderer.h"
 #include "resources/ResourceManager.h"
+#include "resources/ThumbnailCache.h"
 #include "ImageIO.h"
 #include "Log.h"
 #include <nanosvg/nanosvg.h>
@@ -157,16 +158,23 @@ bool TextureData::initSVGFromMemory(const unsigned char* fileData, size_t length
 	return true;
 }
 
-bool TextureData::initImageFromMemory(const unsigned char* fileData, size_t length, int subImageIndex)
+MaxSizeInfo TextureData::getTargetMaxSize()
 {
-	// If already initialised then don't read again
-	if (isLoaded())
-		return true;
-
 	// Don't load images greater than screen resolution
 	MaxSizeInfo maxSize(Renderer::getScreenWidth(), Renderer::getScreenHeight(), false);
 	if (!mMaxSize.empty() && mMaxSize.x() < maxSize.x() && mMaxSize.y() < maxSize.y())
 		maxSize = mMaxSize;
+
+	return maxSize;
+}
+
+bool TextureData::initImageFromMemory(const unsigned char* fileData, size_t length, int subImageIndex, const std::string& thumbnailSourcePath)
+{
+	// If already initialised then don't read again
+	if (isLoaded())
+		return true;
+
+	MaxSizeInfo maxSize = getTargetMaxSize();
 		
 	size_t width, height;
 	Vector2i physicalSize;
@@ -184,6 +192,27 @@ bool TextureData::initImageFromMemory(const unsigned char* fileData, size_t leng
 
 	mScalable = false;
 
+	// Only downscaled pictures are worth caching
+	if (!thumbnailSourcePath.empty() && (width != (size_t)physicalSize.x() || height != (size_t)physicalSize.y()))
+		ThumbnailCache::save(thumbnailSourcePath, mPath, maxSize, imageRGBA, width, height, physicalSize);
+
+	return initFromRGBA(imageRGBA, width, height, false);
+}
+
+bool TextureData::loadFromThumbnailCache(const std::string& sourcePath)
+{
+	if (isLoaded())
+		return true;
+
+	size_t width, height;
+	Vector2i physicalSize;
+	unsigned char* imageRGBA = ThumbnailCache::load(sourcePath, mPath, getTargetMaxSize(), width, height, physicalSize);
+	if (imageRGBA == nullptr)
+		return false;
+
+	mPhysicalSize = Vector2f(physicalSize.x(), physicalSize.y());
+	mScalable = false;
+
 	return initFromRGBA(imageRGBA, width, height, false);
 }
 
@@ -457,6 +486,16 @@ bool TextureData::load(bool updateCache)
 		path = mPath.substr(0, idx);
 	}
 
+	// Downscaled pictures are read from the thumbnail cache, without reading and decoding the source file
+	bool useThumbnailCache = Settings::ThumbnailCache() && ext != ".svg" && !path.empty() && path[0] != ':';
+	if (useThumbnailCache && loadFromThumbnailCache(path))
+	{
+		if (updateCache)
+			ImageIO::updateImageCache(mPath, Utils::FileSystem::getFileSize(path), Math::round((int)mPhysicalSize.x()), Math::round((int)mPhysicalSize.y()));
+
+		return true;
+	}
+
 	const ResourceData& data = ResourceManager::getInstance()->getFileData(path);
 
 	// is it an SVG?
@@ -466,7 +505,7 @@ bool TextureData::load(bool updateCache)
 		return initSVGFromMemory((const unsigned char*)data.ptr.get(), data.length);
 	}
 
-	bool retval = initImageFromMemory((const unsigned char*)data.ptr.get(), data.length, subImageIndex);
+	bool retval = initImageFromMemory((const unsigned char*)data.ptr.get(), data.length, subImageIndex, useThumbnailCache ? path : "");
 
 	if (updateCache && retval)
 		ImageIO::updateImageCache(mPath, data.length, Math::round((int)mPhysicalSize.x()), Math::round((int)mPhysicalSize.y()));
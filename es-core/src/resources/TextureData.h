@@ -29,7 +29,8 @@ public:
 	//!!!! Needs to be canonical path. Caller should check for duplicates before calling this
 	void initFromPath(const std::string& path);
 	bool initSVGFromMemory(const unsigned char* fileData, size_t length);
-	bool initImageFromMemory(const unsigned char* fileData, size_t length, int subImageIndex = -1);
+	// A non-empty thumbnailSourcePath stores the downscaled picture in the ThumbnailCache
+	bool initImageFromMemory(const unsigned char* fileData, size_t length, int subImageIndex = -1, const std::string& thumbnailSourcePath = "");
 	bool initFromRGBA(unsigned char* dataRGBA, size_t width, size_t height, bool copyData = true);
 
 	// Read the data into memory if necessary
@@ -93,6 +94,9 @@ public:
 	void setScalable(bool value) { mScalable = value; };
 
 private:
+	MaxSizeInfo getTargetMaxSize();
+	bool loadFromThumbnailCache(const std::string& sourcePath);
+
 	bool			mRequired;
 
 	std::mutex		mMutex;
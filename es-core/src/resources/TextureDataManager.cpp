@@ -88,10 +88,10 @@ std::shared_ptr<TextureData> TextureDataManager::get(const TextureResource* key,
 		}
 
 		// Make sure it's loaded or queued for loading
-		if (enableLoading == TextureLoadMode::ENABLED && !tex->isLoaded())
+		if ((enableLoading == TextureLoadMode::ENABLED || enableLoading == TextureLoadMode::PREFETCH) && !tex->isLoaded())
 		{
 			lock.unlock();
-			load(tex);
+			load(tex, false, enableLoading == TextureLoadMode::PREFETCH ? TextureLoader::PRIORITY_NEXT_PAGE : TextureLoader::PRIORITY_VISIBLE);
 		}
 	}
 
@@ -217,7 +217,7 @@ void TextureDataManager::cleanupVRAM(std::shared_ptr<TextureData> exclude)
 }
 
 
-void TextureDataManager::load(std::shared_ptr<TextureData> tex, bool block)
+void TextureDataManager::load(std::shared_ptr<TextureData> tex, bool block, TextureLoader::Priority priority)
 {
 	// See if it's already loaded
 	if (tex->isLoaded())
@@ -231,17 +231,21 @@ void TextureDataManager::load(std::shared_ptr<TextureData> tex, bool block)
 		block = true; // Reload instantly or other instances will fade again
 	}
 
-	mLoader->remove(tex);
+	if (block)
+		mLoader->remove(tex);
 
 	cleanupVRAM(tex);
 
 	if (!block)
-		mLoader->load(tex);
+		mLoader->load(tex, priority);
 	else
 		tex->load();
 }
 
-TextureLoader::TextureLoader(TextureDataManager* mgr) : mManager(mgr), mExit(false)
+// A queued request that was not renewed for this long is no longer rendered (scrolled off, hidden...)
+#define STALE_REQUEST_DELAY	250
+
+TextureLoader::TextureLoader(TextureDataManager* mgr) : mManager(mgr), mExit(false), mSequence(0)
 {
 	int num_threads = std::thread::hardware_concurrency() / 2;
 	if (num_threads == 0)
@@ -264,6 +268,26 @@ TextureLoader::~TextureLoader()
 		t.join();
 }
 
+void TextureLoader::enqueue(std::shared_ptr<TextureData> textureData, int priority, int queuedTime, int lastRequest)
+{
+	QueueKey key;
+	key.priority = priority;
+	key.sequence = mSequence++;
+
+	QueueEntry entry;
+	entry.position = mTextureDataQ.insert(std::make_pair(key, textureData)).first;
+	entry.queuedTime = queuedTime;
+	entry.lastRequest = lastRequest;
+
+	mTextureDataLookup[textureData.get()] = entry;
+}
+
+void TextureLoader::dequeue(std::unordered_map<TextureData*, QueueEntry>::iterator entry)
+{
+	mTextureDataQ.erase(entry->second.position);
+	mTextureDataLookup.erase(entry);
+}
+
 void TextureLoader::threadProc()
 {
 	while (true)
@@ -277,14 +301,31 @@ void TextureLoader::threadProc()
 
 		if (!mTextureDataQ.empty())
 		{
-			std::shared_ptr<TextureData> textureData = mTextureDataQ.front();
+			auto first = mTextureDataQ.begin();
+			int priority = first->first.priority;
+
+			std::shared_ptr<TextureData> textureData = first->second;
 
-			mTextureDataQ.pop_front();
-			mTextureDataQSet.erase(textureData);
+			auto entry = mTextureDataLookup.find(textureData.get());
+			int queuedTime = entry->second.queuedTime;
+			int lastRequest = entry->second.lastRequest;
+			dequeue(entry);
+
+			// Requests that are no longer renewed are demoted instead of being loaded before the ones on screen
+			int now = SDL_GetTicks();
+			if (priority < PRIORITY_PREFETCH && now - lastRequest > STALE_REQUEST_DELAY)
+			{
+				mStats[priority].demoted++;
+				enqueue(textureData, PRIORITY_PREFETCH, queuedTime, lastRequest);
+				continue;
+			}
 
 			if (textureData && !textureData->isLoaded())
 			{
 				mProcessingTextureDataQ.insert(textureData);
+
+				mStats[priority].loaded++;
+				mStats[priority].waitTime += now - queuedTime;
 				
 				lock.unlock();
 				std::this_thread::yield();
@@ -305,7 +346,7 @@ void TextureLoader::threadProc()
 
 bool TextureLoader::paused = false;
 
-void TextureLoader::load(std::shared_ptr<TextureData> textureData)
+void TextureLoader::load(std::shared_ptr<TextureData> textureData, Priority priority)
 {
 //	if (paused)
 	//	return;
@@ -320,17 +361,27 @@ void TextureLoader::load(std::shared_ptr<TextureData> textureData)
 	if (mProcessingTextureDataQ.find(textureData) != mProcessingTextureDataQ.cend())
 		return;
 
-	// Remove it from the queue if it is already there
-	if (mTextureDataQSet.erase(textureData) > 0)
+	int now = SDL_GetTicks();
+
+	auto entry = mTextureDataLookup.find(textureData.get());
+	if (entry != mTextureDataLookup.cend())
 	{
-		auto tx = std::find(mTextureDataQ.cbegin(), mTextureDataQ.cend(), textureData);
-		if (tx != mTextureDataQ.cend())
-			mTextureDataQ.erase(tx);
-	}
+		// Already queued : renew the request, and move it up if it's now more urgent
+		entry->second.lastRequest = now;
 
-	// Put it on the start of the queue as we want the newly requested textures to load first
-	mTextureDataQ.push_front(textureData);
-	mTextureDataQSet.insert(textureData);
+		if (entry->second.position->first.priority <= priority)
+			return;
+
+		int queuedTime = entry->second.queuedTime;
+		dequeue(entry);
+		enqueue(textureData, priority, queuedTime, now);
+	}
+	else
+	{
+		// Newly requested textures load first among their priority
+		enqueue(textureData, priority, now, now);
+		mStats[priority].queued++;
+	}
 
 	mEvent.notify_one();
 }
@@ -340,12 +391,11 @@ bool TextureLoader::remove(std::shared_ptr<TextureData> textureData)
 	// Just remove it from the queue so we don't attempt to load it
 	std::unique_lock<std::mutex> lock(mLoaderLock);
 
-	if (mTextureDataQSet.erase(textureData) > 0)
+	auto entry = mTextureDataLookup.find(textureData.get());
+	if (entry != mTextureDataLookup.cend())
 	{
-		auto tx = std::find(mTextureDataQ.cbegin(), mTextureDataQ.cend(), textureData);
-		if (tx != mTextureDataQ.cend())
-			mTextureDataQ.erase(tx);
-
+		mStats[entry->second.position->first.priority].cancelled++;
+		dequeue(entry);
 		return true;
 	}
 
@@ -360,8 +410,8 @@ size_t TextureLoader::getQueueSize()
 	// the queue are loaded
 	size_t mem = 0;
 
-	for (auto tex : mTextureDataQ)
-		mem += tex->getEstimatedVRAMUsage();
+	for (auto& item : mTextureDataQ)
+		mem += item.second->getEstimatedVRAMUsage();
 
 	for (auto tex : mProcessingTextureDataQ)
 		mem += tex->getEstimatedVRAMUsage();
@@ -373,11 +423,31 @@ void TextureLoader::clearQueue()
 {
 	std::unique_lock<std::mutex> lock(mLoaderLock);
 
+	for (auto& item : mTextureDataQ)
+		mStats[item.first.priority].cancelled++;
+
 	// Just abort any waiting texture
-	mTextureDataQSet.clear();
+	mTextureDataLookup.clear();
 	mTextureDataQ.clear();	
 }
 
+void TextureLoader::logStatistics()
+{
+	static const char* names[] = { "visible", "next page", "prefetch" };
+
+	std::unique_lock<std::mutex> lock(mLoaderLock);
+
+	for (int i = 0; i < PRIORITY_COUNT; i++)
+	{
+		PriorityStats& stats = mStats[i];
+		if (stats.queued == 0 && stats.demoted == 0 && stats.loaded == 0)
+			continue;
+
+		LOG(LogInfo) << "TextureLoader " << names[i] << " : " << stats.queued << " queued, " << stats.loaded << " loaded (avg wait " << (stats.loaded ? stats.waitTime / stats.loaded : 0) << "ms), " << stats.demoted << " demoted, " << stats.cancelled << " cancelled";
+		stats = PriorityStats();
+	}
+}
+
 void TextureDataManager::clearQueue()
 {
 	mBlank = nullptr;
@@ -386,6 +456,12 @@ void TextureDataManager::clearQueue()
 		mLoader->clearQueue();
 }
 
+void TextureDataManager::logStatistics()
+{
+	if (mLoader != nullptr)
+		mLoader->logStatistics();
+}
+
 std::shared_ptr<TextureData> TextureDataManager::getBlankTexture()
 {
 	if (mBlank == nullptr)
@@ -19,23 +19,73 @@ class TextureResource;
 class TextureLoader
 {
 public:
+	// Lower values are loaded first
+	enum Priority : int
+	{
+		PRIORITY_VISIBLE = 0,	// Rendered on screen
+		PRIORITY_NEXT_PAGE = 1,	// About to be scrolled in
+		PRIORITY_PREFETCH = 2,	// Stale requests : no longer rendered, loaded when nothing else is waiting
+
+		PRIORITY_COUNT = 3
+	};
+
 	TextureLoader(TextureDataManager* mgr);
 	~TextureLoader();
 
-	void load(std::shared_ptr<TextureData> textureData);
+	// Queues textureData, or raises the priority of a queued request. O(log n)
+	void load(std::shared_ptr<TextureData> textureData, Priority priority = PRIORITY_VISIBLE);
 	bool remove(std::shared_ptr<TextureData> textureData);
 	void clearQueue();
 
 	size_t getQueueSize();
 
+	// Logs the counters of each priority, then resets them
+	void logStatistics();
+
 	static bool paused;
 
 private:	
 	void threadProc();
 
+	// Ordered by priority, then newest request first
+	struct QueueKey
+	{
+		int				priority;
+		unsigned int	sequence;
+
+		bool operator<(const QueueKey& other) const { return priority != other.priority ? priority < other.priority : sequence > other.sequence; }
+	};
+
+	typedef std::map<QueueKey, std::shared_ptr<TextureData>> Queue;
+
+	struct QueueEntry
+	{
+		Queue::iterator	position;
+		int				lastRequest;	// SDL ticks of the last load() call
+		int				queuedTime;
+	};
+
+	struct PriorityStats
+	{
+		PriorityStats() : queued(0), loaded(0), demoted(0), cancelled(0), waitTime(0) { }
+
+		unsigned int		queued;
+		unsigned int		loaded;
+		unsigned int		demoted;
+		unsigned int		cancelled;
+		unsigned long long	waitTime;	// ms between queuing and loading, for loaded textures
+	};
+
+	// mLoaderLock must be held
+	void enqueue(std::shared_ptr<TextureData> textureData, int priority, int queuedTime, int lastRequest);
+	void dequeue(std::unordered_map<TextureData*, QueueEntry>::iterator entry);
+
 	std::set<std::shared_ptr<TextureData>> 											mProcessingTextureDataQ;
-	std::list<std::shared_ptr<TextureData>> 										mTextureDataQ;
-	std::set<std::shared_ptr<TextureData>> 											mTextureDataQSet;
+	Queue																			mTextureDataQ;
+	std::unordered_map<TextureData*, QueueEntry>									mTextureDataLookup;
+	unsigned int																	mSequence;
+
+	PriorityStats				mStats[PRIORITY_COUNT];
 
 	std::vector<std::thread>	mThreads;
 	std::mutex					mLoaderLock;
@@ -70,7 +120,8 @@ public:
 	{
 		ENABLED = 0,
 		DISABLED = 1,
-		MOVETOTOPONLY = 2
+		MOVETOTOPONLY = 2,
+		PREFETCH = 3 // Queued behind the textures rendered on screen
 	};
 
 	std::shared_ptr<TextureData> add(const TextureResource* key, bool tiled, bool linear);
@@ -92,9 +143,10 @@ public:
 	// be committed to VRAM as the queue is processed
 	size_t  getQueueSize();
 	// Load a texture, freeing resources as necessary to make space
-	void load(std::shared_ptr<TextureData> tex, bool block = false);
+	void load(std::shared_ptr<TextureData> tex, bool block = false, TextureLoader::Priority priority = TextureLoader::PRIORITY_VISIBLE);
 
 	void clearQueue();
+	void logStatistics();
 	
 	void cleanupVRAM(std::shared_ptr<TextureData> exclude = nullptr);
 
@@ -251,6 +251,12 @@ void TextureResource::prioritize() const
 		sTextureDataManager.get(this, TextureDataManager::TextureLoadMode::MOVETOTOPONLY);
 }
 
+void TextureResource::prefetch() const
+{
+	if (mTextureData == nullptr)
+		sTextureDataManager.get(this, TextureDataManager::TextureLoadMode::PREFETCH);
+}
+
 void TextureResource::setRequired(bool value) const
 {
 	if (mTextureData != nullptr)
@@ -369,6 +375,11 @@ void TextureResource::clearQueue()
 	sTextureDataManager.clearQueue();
 }
 
+void TextureResource::logStatistics()
+{
+	sTextureDataManager.logStatistics();
+}
+
 const Vector2i TextureResource::getSize() const
 { 	
 	return mSize; 
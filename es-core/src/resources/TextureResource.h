@@ -37,6 +37,7 @@ public:
 	bool isLoaded() const;
 	bool isTiled() const;
 	void prioritize() const;
+	void prefetch() const; // Queues the texture behind the ones rendered on screen
 	void setRequired(bool value) const;
 	bool isScalable() const;
 
@@ -49,6 +50,7 @@ public:
 	virtual void reload();
 
 	static void clearQueue();
+	static void logStatistics();
 
 private:
 	// mTextureData is used for textures that are not loaded from a file - these ones
@@ -0,0 +1,235 @@
+#include "resources/ThumbnailCache.h"
+
+#include "utils/BinaryStream.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "ImageIO.h"
+#include "Log.h"
+#include "Paths.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#if WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#define THUMBNAIL_MAGIC		0x48545345 // "ESTH"
+#define THUMBNAIL_VERSION	1
+
+// Least recently used entries are removed when the cache grows over this size
+#define THUMBNAIL_CACHE_MAX_SIZE	(256LL * 1024 * 1024)
+// The modification time of an entry is its last use, updated at most once per period to spare the writes
+#define THUMBNAIL_TOUCH_PERIOD		(60 * 60)
+
+static std::mutex sCacheSizeLock;
+static long long sCacheSize = -1;
+
+static std::string getCacheFolder()
+{
+	return Paths::getUserEmulationStationPath() + "/cache/thumbnails";
+}
+
+static FILE* openFile(const std::string& path, bool write)
+{
+#if WIN32
+	return _wfopen(Utils::String::convertToWideString(path).c_str(), write ? L"wb" : L"rb");
+#else
+	return fopen(path.c_str(), write ? "wb" : "rb");
+#endif
+}
+
+static void touchFile(const std::string& path)
+{
+	if (time(NULL) - Utils::FileSystem::getFileModificationDate(path).getTime() < THUMBNAIL_TOUCH_PERIOD)
+		return;
+
+#if WIN32
+	_wutime(Utils::String::convertToWideString(path).c_str(), NULL);
+#else
+	utime(path.c_str(), NULL);
+#endif
+}
+
+static uint64_t hashKey(const std::string& key)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (auto c : key)
+	{
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+std::string ThumbnailCache::getEntryPath(const std::string& texturePath, const MaxSizeInfo& maxSize, std::string& key)
+{
+	key = texturePath + "|" + std::to_string((int)maxSize.x()) + "x" + std::to_string((int)maxSize.y()) + (maxSize.externalZoom() ? "|z" : "");
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.rgba", (unsigned long long)hashKey(key));
+
+	return getCacheFolder() + "/" + name;
+}
+
+unsigned char* ThumbnailCache::load(const std::string& sourcePath, const std::string& texturePath, const MaxSizeInfo& maxSize, size_t& width, size_t& height, Vector2i& physicalSize)
+{
+	std::string key;
+	std::string path = getEntryPath(texturePath, maxSize, key);
+
+	FILE* fp = openFile(path, false);
+	if (fp == nullptr)
+		return nullptr;
+
+	unsigned char* ret = nullptr;
+
+	unsigned int headerSize = 0;
+	if (fread(&headerSize, sizeof(headerSize), 1, fp) == 1 && headerSize < 8192)
+	{
+		std::vector<unsigned char> header(headerSize);
+		if (fread(header.data(), 1, headerSize, fp) == headerSize)
+		{
+			Utils::BinaryReader reader(header.data(), header.size());
+
+			bool valid = reader.readInt() == THUMBNAIL_MAGIC && reader.readInt() == THUMBNAIL_VERSION && reader.readString() == key &&
+				reader.readLong() == (long long)Utils::FileSystem::getFileSize(sourcePath) &&
+				reader.readLong() == (long long)Utils::FileSystem::getFileModificationDate(sourcePath).getTime();
+
+			int physicalWidth = (int)reader.readInt();
+			int physicalHeight = (int)reader.readInt();
+			size_t w = reader.readInt();
+			size_t h = reader.readInt();
+
+			if (valid && !reader.failed() && w > 0 && h > 0 && w <= 8192 && h <= 8192)
+			{
+				ret = new unsigned char[w * h * 4];
+				if (fread(ret, 1, w * h * 4, fp) == w * h * 4)
+				{
+					width = w;
+					height = h;
+					physicalSize = Vector2i(physicalWidth, physicalHeight);
+				}
+				else
+				{
+					delete[] ret;
+					ret = nullptr;
+				}
+			}
+		}
+	}
+
+	fclose(fp);
+
+	if (ret == nullptr)
+	{
+		// Outdated or truncated
+		Utils::FileSystem::removeFile(path);
+	}
+	else
+		touchFile(path);
+
+	return ret;
+}
+
+void ThumbnailCache::save(const std::string& sourcePath, const std::string& texturePath, const MaxSizeInfo& maxSize, const unsigned char* rgba, size_t width, size_t height, const Vector2i& physicalSize)
+{
+	if (rgba == nullptr || width == 0 || height == 0)
+		return;
+
+	std::string key;
+	std::string path = getEntryPath(texturePath, maxSize, key);
+
+	Utils::BinaryWriter writer;
+	writer.writeInt(THUMBNAIL_MAGIC);
+	writer.writeInt(THUMBNAIL_VERSION);
+	writer.writeString(key);
+	writer.writeLong((long long)Utils::FileSystem::getFileSize(sourcePath));
+	writer.writeLong((long long)Utils::FileSystem::getFileModificationDate(sourcePath).getTime());
+	writer.writeInt((unsigned int)physicalSize.x());
+	writer.writeInt((unsigned int)physicalSize.y());
+	writer.writeInt((unsigned int)width);
+	writer.writeInt((unsigned int)height);
+
+	const std::string& header = writer.getBuffer();
+	unsigned int headerSize = (unsigned int)header.size();
+	size_t pixelsSize = width * height * 4;
+
+	reserve(sizeof(headerSize) + header.size() + pixelsSize);
+
+	// Several loader threads may decode the same picture
+	std::string tmpPath = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+	FILE* fp = openFile(tmpPath, true);
+	if (fp == nullptr)
+	{
+		Utils::FileSystem::createDirectory(getCacheFolder());
+
+		fp = openFile(tmpPath, true);
+		if (fp == nullptr)
+			return;
+	}
+
+	bool ok = fwrite(&headerSize, sizeof(headerSize), 1, fp) == 1 && fwrite(header.c_str(), 1, header.size(), fp) == header.size() && fwrite(rgba, 1, pixelsSize, fp) == pixelsSize;
+	ok = (fclose(fp) == 0) && ok;
+
+	if (!ok || !Utils::FileSystem::renameFile(tmpPath, path))
+	{
+		LOG(LogWarning) << "ThumbnailCache : Unable to write " << path;
+		Utils::FileSystem::removeFile(tmpPath);
+	}
+}
+
+void ThumbnailCache::reserve(long long size)
+{
+	std::unique_lock<std::mutex> lock(sCacheSizeLock);
+
+	std::string folder = getCacheFolder();
+
+	if (sCacheSize < 0)
+	{
+		sCacheSize = 0;
+		for (auto file : Utils::FileSystem::getDirContent(folder))
+			sCacheSize += (long long)Utils::FileSystem::getFileSize(file);
+	}
+
+	sCacheSize += size;
+	if (sCacheSize < THUMBNAIL_CACHE_MAX_SIZE)
+		return;
+
+	// Remove the least recently used entries, down to 3/4 of the maximum size
+	std::vector<std::pair<time_t, std::string>> files;
+	for (auto file : Utils::FileSystem::getDirContent(folder))
+		files.push_back(std::pair<time_t, std::string>(Utils::FileSystem::getFileModificationDate(file).getTime(), file));
+
+	std::sort(files.begin(), files.end());
+
+	int removed = 0;
+
+	for (auto& file : files)
+	{
+		if (sCacheSize < THUMBNAIL_CACHE_MAX_SIZE * 3 / 4)
+			break;
+
+		sCacheSize -= (long long)Utils::FileSystem::getFileSize(file.second);
+		Utils::FileSystem::removeFile(file.second);
+		removed++;
+	}
+
+	LOG(LogInfo) << "ThumbnailCache : " << removed << " entries removed";
+}
+
+void ThumbnailCache::clear()
+{
+	std::unique_lock<std::mutex> lock(sCacheSizeLock);
+
+	Utils::FileSystem::deleteDirectoryFiles(getCacheFolder());
+	sCacheSize = 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#ifndef ES_CORE_RESOURCES_THUMBNAIL_CACHE_H
+#define ES_CORE_RESOURCES_THUMBNAIL_CACHE_H
+
+#include "math/Vector2i.h"
+#include <string>
+
+class MaxSizeInfo;
+
+// On-disk cache of downscaled RGBA pictures, stored in <user>/cache/thumbnails.
+// An entry is keyed by the texture path and its target size, and is valid while the size and modification time of the source file are unchanged.
+// Reading one is a plain file read : grids fill in without decoding and rescaling the full size scraped pictures again.
+class ThumbnailCache
+{
+public:
+	// Returns a new[] RGBA buffer of width * height pixels, or nullptr. physicalSize receives the size of the source picture
+	static unsigned char* load(const std::string& sourcePath, const std::string& texturePath, const MaxSizeInfo& maxSize, size_t& width, size_t& height, Vector2i& physicalSize);
+	static void save(const std::string& sourcePath, const std::string& texturePath, const MaxSizeInfo& maxSize, const unsigned char* rgba, size_t width, size_t height, const Vector2i& physicalSize);
+
+	static void clear();
+
+private:
+	static std::string getEntryPath(const std::string& texturePath, const MaxSizeInfo& maxSize, std::string& key);
+	static void reserve(long long size);
+};
+
+#endif // ES_CORE_RESOURCES_THUMBNAIL_CACHE_H
@@ -0,0 +1,78 @@
+#pragma once
+#ifndef ES_CORE_UTILS_BINARY_STREAM_H
+#define ES_CORE_UTILS_BINARY_STREAM_H
+
+#include <string>
+#include <string.h>
+#include <stddef.h>
+
+namespace Utils
+{
+	// Serializes values in host byte order, for caches that are only read back by the same machine.
+	class BinaryWriter
+	{
+	public:
+		void writeByte(unsigned char value) { mBuffer.push_back((char)value); }
+		void writeInt(unsigned int value) { mBuffer.append((const char*)&value, sizeof(value)); }
+		void writeLong(long long value) { mBuffer.append((const char*)&value, sizeof(value)); }
+
+		void writeString(const std::string& value)
+		{
+			writeInt((unsigned int)value.size());
+			mBuffer.append(value);
+		}
+
+		const std::string& getBuffer() { return mBuffer; }
+
+	private:
+		std::string mBuffer;
+	};
+
+	// Reads values straight from memory (usually a MappedFile). Any out of bounds read marks the reader as failed, and the data is then considered corrupted.
+	class BinaryReader
+	{
+	public:
+		BinaryReader(const unsigned char* data, size_t size) : mPtr(data), mEnd(data + size), mFailed(false) { }
+
+		unsigned char readByte() { return readValue<unsigned char>(); }
+		unsigned int readInt() { return readValue<unsigned int>(); }
+		long long readLong() { return readValue<long long>(); }
+
+		std::string readString()
+		{
+			unsigned int size = readInt();
+			if (mFailed || (size_t)(mEnd - mPtr) < size)
+			{
+				mFailed = true;
+				return "";
+			}
+
+			std::string ret((const char*)mPtr, size);
+			mPtr += size;
+			return ret;
+		}
+
+		bool failed() { return mFailed; }
+
+	private:
+		template<typename T> T readValue()
+		{
+			if (mFailed || (size_t)(mEnd - mPtr) < sizeof(T))
+			{
+				mFailed = true;
+				return T();
+			}
+
+			T value;
+			memcpy(&value, mPtr, sizeof(T));
+			mPtr += sizeof(T);
+			return value;
+		}
+
+		const unsigned char* mPtr;
+		const unsigned char* mEnd;
+		bool mFailed;
+	};
+}
+
+#endif // ES_CORE_UTILS_BINARY_STREAM_H
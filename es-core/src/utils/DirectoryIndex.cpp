@@ -0,0 +1,391 @@
+#define _FILE_OFFSET_BITS 64
+
+#include "utils/DirectoryIndex.h"
+#include "utils/BinaryStream.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/MappedFile.h"
+#include "Log.h"
+#include "Paths.h"
+#include "Settings.h"
+
+#include <sys/stat.h>
+#include <time.h>
+#include <thread>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#define INDEX_MAGIC			0x58445345 // "ESDX"
+#define INDEX_VERSION		1
+
+// Folders modified less than this before being enumerated are not stored : some filesystems (FAT) have a 2 seconds mtime resolution,
+// so a file added right after the enumeration could leave the folder mtime unchanged
+#define MTIME_RESOLUTION	2000000000LL
+
+#define MAX_WATCHES			8192
+
+namespace Utils
+{
+	namespace FileSystem
+	{
+		std::unordered_map<std::string, DirectoryIndex::Listing> DirectoryIndex::mListings;
+		std::mutex DirectoryIndex::mLock;
+		int DirectoryIndex::mActivations = 0;
+		bool DirectoryIndex::mEnabled = false;
+		bool DirectoryIndex::mLoaded = false;
+		bool DirectoryIndex::mDirty = false;
+
+		// Modification time of the folder, in nanoseconds. -1 if path is not a folder
+		static long long getDirectoryTime(const std::string& path)
+		{
+#if WIN32
+			return -1;
+#else
+			struct stat64 info;
+			if (stat64(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+				return -1;
+
+			return (long long)info.st_mtim.tv_sec * 1000000000LL + (long long)info.st_mtim.tv_nsec;
+#endif
+		}
+
+		static long long getCurrentTime()
+		{
+#if WIN32
+			return (long long)time(nullptr) * 1000000000LL;
+#else
+			struct timespec now;
+			clock_gettime(CLOCK_REALTIME, &now);
+			return (long long)now.tv_sec * 1000000000LL + (long long)now.tv_nsec;
+#endif
+		}
+
+#ifdef __linux__
+		static int sInotifyFd = -1;
+		static std::unordered_map<int, std::string> sWatchedPaths;
+		static std::unordered_set<std::string> sWatches;
+
+		static bool isNetworkFileSystem(const std::string& path)
+		{
+			struct statfs info;
+			if (statfs(path.c_str(), &info) != 0)
+				return true;
+
+			switch ((unsigned int)info.f_type)
+			{
+			case 0x6969:		// NFS
+			case 0x517B:		// SMB
+			case 0xFF534D42:	// CIFS
+			case 0xFE534D42:	// SMB2
+			case 0x65735546:	// FUSE (sshfs, ntfs-3g...)
+				return true;
+			}
+
+			// Changes made by other hosts are not reported by inotify
+			return false;
+		}
+
+		static void watcherLoop()
+		{
+			alignas(struct inotify_event) char buffer[16384];
+
+			while (true)
+			{
+				ssize_t len = read(sInotifyFd, buffer, sizeof(buffer));
+				if (len <= 0)
+				{
+					if (len < 0 && errno == EINTR)
+						continue;
+
+					break;
+				}
+
+				for (char* ptr = buffer; ptr < buffer + len; )
+				{
+					struct inotify_event* evt = (struct inotify_event*)ptr;
+					ptr += sizeof(struct inotify_event) + evt->len;
+
+					if (evt->mask & IN_Q_OVERFLOW)
+					{
+						LOG(LogDebug) << "DirectoryIndex : inotify queue overflow";
+						DirectoryIndex::invalidate("");
+						continue;
+					}
+
+					std::string path = DirectoryIndex::getWatchedPath(evt->wd, (evt->mask & IN_IGNORED) != 0);
+					if (!path.empty())
+						DirectoryIndex::invalidate(path);
+				}
+			}
+		}
+#endif
+
+		std::string DirectoryIndex::getWatchedPath(int wd, bool removed)
+		{
+#ifdef __linux__
+			std::unique_lock<std::mutex> lock(mLock);
+
+			auto it = sWatchedPaths.find(wd);
+			if (it == sWatchedPaths.cend())
+				return "";
+
+			std::string path = it->second;
+
+			if (removed)
+			{
+				sWatches.erase(path);
+				sWatchedPaths.erase(it);
+			}
+
+			return path;
+#else
+			return "";
+#endif
+		}
+
+		bool DirectoryIndex::watch(const std::string& path)
+		{
+#ifdef __linux__
+			if (sWatches.find(path) != sWatches.cend())
+				return true;
+
+			if (sWatches.size() >= MAX_WATCHES || isNetworkFileSystem(path))
+				return false;
+
+			if (sInotifyFd < 0)
+			{
+				sInotifyFd = inotify_init1(IN_CLOEXEC);
+				if (sInotifyFd < 0)
+					return false;
+
+				// Blocks on read, it lives as long as the process
+				std::thread(watcherLoop).detach();
+			}
+
+			int wd = inotify_add_watch(sInotifyFd, path.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+			if (wd < 0)
+				return false;
+
+			sWatches.insert(path);
+			sWatchedPaths[wd] = path;
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		std::string DirectoryIndex::getIndexPath()
+		{
+			return Paths::getUserEmulationStationPath() + "/cache/dirindex.cache";
+		}
+
+		void DirectoryIndex::activate()
+		{
+			std::unique_lock<std::mutex> lock(mLock);
+
+			if (mActivations++ > 0)
+				return;
+
+#if WIN32
+			mEnabled = false;
+#else
+			mEnabled = Settings::PersistentDirectoryIndex();
+#endif
+			if (mEnabled && !mLoaded)
+			{
+				mLoaded = true;
+				load();
+			}
+		}
+
+		void DirectoryIndex::release()
+		{
+			std::unique_lock<std::mutex> lock(mLock);
+
+			if (--mActivations > 0)
+				return;
+
+			mActivations = 0;
+
+			if (mEnabled && mDirty)
+				save();
+
+			mEnabled = false;
+		}
+
+		bool DirectoryIndex::lookup(const std::string& path, std::vector<Entry>& entries, long long& mtime)
+		{
+			mtime = -1;
+
+			{
+				std::unique_lock<std::mutex> lock(mLock);
+				if (!mEnabled)
+					return false;
+
+				auto it = mListings.find(path);
+				if (it != mListings.cend() && it->second.trusted)
+				{
+					entries = it->second.entries;
+					return true;
+				}
+			}
+
+			mtime = getDirectoryTime(path);
+			if (mtime < 0)
+				return false;
+
+			bool watched = false;
+
+			{
+				std::unique_lock<std::mutex> lock(mLock);
+
+				auto it = mListings.find(path);
+				if (it == mListings.cend() || it->second.mtime != mtime)
+					return false;
+
+				watched = watch(path);
+				entries = it->second.entries;
+			}
+
+			if (!watched)
+				return true;
+
+			// A change made before the watch was added isn't reported by inotify : check the date again before trusting the listing.
+			// Any later change is reported by inotify, which removes the listing.
+			long long watchedTime = getDirectoryTime(path);
+			if (watchedTime != mtime)
+			{
+				mtime = watchedTime;
+				entries.clear();
+				return false;
+			}
+
+			std::unique_lock<std::mutex> lock(mLock);
+
+			auto it = mListings.find(path);
+			if (it != mListings.cend() && it->second.mtime == mtime)
+				it->second.trusted = true;
+
+			return true;
+		}
+
+		void DirectoryIndex::update(const std::string& path, long long mtime, const std::vector<Entry>& entries)
+		{
+			if (mtime < 0 || getCurrentTime() - mtime < MTIME_RESOLUTION)
+				return;
+
+			std::unique_lock<std::mutex> lock(mLock);
+			if (!mEnabled)
+				return;
+
+			// Not trusted yet : a change made during the enumeration could have been missed. The next lookup validates it.
+			Listing& listing = mListings[path];
+			listing.mtime = mtime;
+			listing.trusted = false;
+			listing.entries = entries;
+
+			watch(path);
+			mDirty = true;
+		}
+
+		void DirectoryIndex::invalidate(const std::string& path)
+		{
+			std::unique_lock<std::mutex> lock(mLock);
+
+			if (path.empty())
+			{
+				for (auto& listing : mListings)
+					listing.second.trusted = false;
+
+				return;
+			}
+
+			if (mListings.erase(path) > 0)
+				mDirty = true;
+		}
+
+		bool DirectoryIndex::load()
+		{
+			Utils::MappedFile file;
+			if (!file.open(getIndexPath()))
+				return false;
+
+			Utils::BinaryReader reader(file.data(), file.size());
+			if (reader.readInt() != INDEX_MAGIC || reader.readInt() != INDEX_VERSION)
+				return false;
+
+			unsigned int count = reader.readInt();
+			for (unsigned int i = 0; i < count && !reader.failed(); i++)
+			{
+				std::string path = reader.readString();
+
+				Listing& listing = mListings[path];
+				listing.mtime = reader.readLong();
+				listing.trusted = false;
+
+				unsigned int entryCount = reader.readInt();
+				listing.entries.reserve(entryCount < 65536 ? entryCount : 65536);
+
+				for (unsigned int e = 0; e < entryCount && !reader.failed(); e++)
+				{
+					Entry entry;
+					entry.flags = reader.readByte();
+					entry.name = reader.readString();
+					listing.entries.push_back(entry);
+				}
+			}
+
+			if (reader.failed())
+			{
+				LOG(LogWarning) << "DirectoryIndex : " << getIndexPath() << " is corrupted";
+				mListings.clear();
+				return false;
+			}
+
+			LOG(LogInfo) << "DirectoryIndex : " << mListings.size() << " folder listings loaded";
+			return true;
+		}
+
+		bool DirectoryIndex::save()
+		{
+			Utils::BinaryWriter writer;
+			writer.writeInt(INDEX_MAGIC);
+			writer.writeInt(INDEX_VERSION);
+			writer.writeInt((unsigned int)mListings.size());
+
+			for (auto& listing : mListings)
+			{
+				writer.writeString(listing.first);
+				writer.writeLong(listing.second.mtime);
+				writer.writeInt((unsigned int)listing.second.entries.size());
+
+				for (auto& entry : listing.second.entries)
+				{
+					writer.writeByte(entry.flags);
+					writer.writeString(entry.name);
+				}
+			}
+
+			std::string path = getIndexPath();
+			std::string tmpPath = path + ".tmp";
+
+			Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(path));
+			Utils::FileSystem::writeAllText(tmpPath, writer.getBuffer());
+
+			if (Utils::FileSystem::getFileSize(tmpPath) != writer.getBuffer().size() || !Utils::FileSystem::renameFile(tmpPath, path))
+			{
+				LOG(LogError) << "DirectoryIndex : Unable to write " << path;
+				Utils::FileSystem::removeFile(tmpPath);
+				return false;
+			}
+
+			mDirty = false;
+			return true;
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef ES_CORE_UTILS_DIRECTORY_INDEX_H
+#define ES_CORE_UTILS_DIRECTORY_INDEX_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
+namespace Utils
+{
+	namespace FileSystem
+	{
+		// Persistent index of directory listings, kept in <user>/cache/dirindex.cache across sessions.
+		// A listing is valid as long as the modification time of its directory is unchanged, so unchanged folders are never enumerated again.
+		// On Linux, local folders are also watched with inotify : while ES is running, a watched listing is trusted without even stat'ing the folder.
+		class DirectoryIndex
+		{
+		public:
+			enum EntryFlags : unsigned char
+			{
+				ENTRY_DIRECTORY = 1,
+				ENTRY_HIDDEN = 2,
+				ENTRY_SYMLINK = 4
+			};
+
+			struct Entry
+			{
+				std::string name;
+				unsigned char flags;
+			};
+
+			// Enabled while a FileSystemCacheActivator is alive, the index is loaded on first activation and saved when the last activator is released
+			static void activate();
+			static void release();
+
+			// Returns true and fills entries when the index holds an up to date listing of path.
+			// Otherwise, mtime receives the current modification time of the folder (-1 if it's not a folder) to be passed to update once the folder is enumerated.
+			static bool lookup(const std::string& path, std::vector<Entry>& entries, long long& mtime);
+			static void update(const std::string& path, long long mtime, const std::vector<Entry>& entries);
+
+			// Drops the listing of path. An empty path only revokes the trust of every listing (inotify events were lost)
+			static void invalidate(const std::string& path);
+
+			// Folder watched with the inotify watch descriptor wd. removed is set when the watch no longer exists
+			static std::string getWatchedPath(int wd, bool removed);
+
+		private:
+			struct Listing
+			{
+				long long mtime;
+				bool trusted;
+				std::vector<Entry> entries;
+			};
+
+			static bool load();
+			static bool save();
+			static std::string getIndexPath();
+
+			// mLock must be held. Returns true if changes to path are reported by inotify
+			static bool watch(const std::string& path);
+
+			static std::unordered_map<std::string, Listing> mListings;
+			static std::mutex mLock;
+			static int mActivations;
+			static bool mEnabled;
+			static bool mLoaded;
+			static bool mDirty;
+		};
+	}
+}
+
+#endif // ES_CORE_UTILS_DIRECTORY_INDEX_H
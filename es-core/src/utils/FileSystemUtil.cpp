@@ -1,11 +1,13 @@
 #define _FILE_OFFSET_BITS 64
 
 #include "utils/FileSystemUtil.h"
+#include "utils/DirectoryIndex.h"
 #include "utils/StringUtil.h"
 #include "utils/ZipFile.h"
 #include "utils/md5.h"
 
 #include "Settings.h"
+#include "Log.h"
 #include <sys/stat.h>
 #include <string.h>
 #include <algorithm>
@@ -26,6 +28,7 @@
 #define S_ISDIR(x) (((x) & S_IFMT) == S_IFDIR)
 #else // _WIN32
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <mutex>
 #endif // _WIN32
@@ -33,9 +36,15 @@
 #include <fstream>
 #include <sstream>
 #include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdint.h>
 
 #include "Paths.h"
 
+#define FILECACHE_SHARDS	64 // getFileCacheShard uses the 6 upper bits of the hash
+
 namespace Utils
 {
 	namespace FileSystem
@@ -71,23 +80,12 @@ namespace Utils
 				}
 			}
 #else
-			FileCache(const std::string& name, dirent* entry, bool _hidden)
+			FileCache(const DirectoryIndex::Entry& entry)
 			{
 				exists = true;
-				hidden = _hidden;
-
-				if (entry->d_type == 10)
-				{
-					struct stat64 info;
-					if (stat64(resolveSymlink(name).c_str(), &info) == 0)
-						directory = S_ISDIR(info.st_mode);
-					else 
-						directory = false;
-				}
-				else
-					directory = (entry->d_type == 4);
-
-				isSymLink = (entry->d_type == 10); // DT_LNK;
+				directory = (entry.flags & DirectoryIndex::ENTRY_DIRECTORY) != 0;
+				hidden = (entry.flags & DirectoryIndex::ENTRY_HIDDEN) != 0;
+				isSymLink = (entry.flags & DirectoryIndex::ENTRY_SYMLINK) != 0;
 			}
 #endif
 
@@ -104,8 +102,6 @@ namespace Utils
 				int ret = stat64(key.c_str(), info);
 #endif
 
-				mFileCacheMutex.lock();
-
 				FileCache cache(ret == 0, false);
 				if (cache.exists)
 				{
@@ -121,67 +117,188 @@ namespace Utils
 #endif
 				}
 
-				mFileCache[key] = cache;
-
-				mFileCacheMutex.unlock();
+				add(key, cache);
 
 				return ret;
 			}
 
-			static void add(const std::string& key, const FileCache& cache)
-			{
-				if (!mEnabled)
-					return;
+			static void add(const std::string& key, const FileCache& cache);
 
-				mFileCacheMutex.lock();
-				mFileCache[key] = cache;
-				mFileCacheMutex.unlock();
-			}
+			// Tells the cache that the folder was enumerated : any path of this folder that is not in the cache does not exist
+			static void addFolder(const std::string& path);
 
-			static FileCache* get(const std::string& key)
-			{
-				if (!mEnabled)
-					return nullptr;
+			static bool get(const std::string& key, FileCache& cache);
+			static void resetCache();
+			static void logStatistics();
 
-				std::unique_lock<std::mutex> lock(mFileCacheMutex);
+			static inline void setEnabled(bool value) { mEnabled = value; }
+			static inline bool isEnabled() { return mEnabled; }
 
-				if (mFileCache.size())
+		private:
+			// Locks a shard, accounting the time spent waiting when another thread holds it
+			class ShardLock
+			{
+			public:
+				ShardLock(std::mutex& mutex) : mLock(mutex, std::try_to_lock)
 				{
-					auto it = mFileCache.find(key);
-					if (it != mFileCache.cend())
-						return &it->second;
+					if (mLock.owns_lock())
+						return;
 
-					it = mFileCache.find(Utils::FileSystem::getParent(key) + "/*");
-					if (it != mFileCache.cend())
-					{
-						mFileCache[key] = FileCache(false, false);
-						return &mFileCache[key];
-					}
+					auto start = std::chrono::steady_clock::now();
+					mLock.lock();
+
+					mContentions++;
+					mContentionTime += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
 				}
 
-				return nullptr;
-			}
+			private:
+				std::unique_lock<std::mutex> mLock;
+			};
 
-			static void resetCache()
+			// FNV-1a
+			static inline uint64_t hashPath(const char* path, size_t length)
 			{
-				mFileCacheMutex.lock();
-				mFileCache.clear();
-				mFileCacheMutex.unlock();
+				uint64_t hash = 14695981039346656037ULL;
+				for (size_t i = 0; i < length; i++)
+				{
+					hash ^= (unsigned char)path[i];
+					hash *= 1099511628211ULL;
+				}
+
+				return hash;
 			}
 
-			static inline void setEnabled(bool value) { mEnabled = value; }
-			static inline bool isEnabled() { return mEnabled; }
+			static bool isFolderEnumerated(const std::string& key, size_t parentLength);
 
-		private:
-			static std::unordered_map<std::string, FileCache> mFileCache;
-			static std::mutex mFileCacheMutex;
 			static bool mEnabled;
+
+			static std::atomic<uint64_t> mHits;
+			static std::atomic<uint64_t> mMisses;
+			static std::atomic<uint64_t> mContentions;
+			static std::atomic<uint64_t> mContentionTime;
+		};
+
+		// Entries are keyed by the 64 bits hash of their path, which also selects the shard. The path is kept to rule out collisions.
+		struct FileCacheShard
+		{
+			struct Node
+			{
+				std::string path;
+				FileCache cache;
+			};
+
+			std::mutex lock;
+			std::unordered_map<uint64_t, Node> files;
+			std::unordered_map<uint64_t, std::string> folders;
 		};
 
-		std::unordered_map<std::string, FileCache> FileCache::mFileCache;
-		std::mutex FileCache::mFileCacheMutex;
+		static FileCacheShard sFileCacheShards[FILECACHE_SHARDS];
+
+		static inline FileCacheShard& getFileCacheShard(uint64_t hash) { return sFileCacheShards[hash >> 58]; }
+
 		bool FileCache::mEnabled = false;
 
+		std::atomic<uint64_t> FileCache::mHits(0);
+		std::atomic<uint64_t> FileCache::mMisses(0);
+		std::atomic<uint64_t> FileCache::mContentions(0);
+		std::atomic<uint64_t> FileCache::mContentionTime(0);
+
+		void FileCache::add(const std::string& key, const FileCache& cache)
+		{
+			if (!mEnabled)
+				return;
+
+			uint64_t hash = hashPath(key.c_str(), key.size());
+
+			FileCacheShard& shard = getFileCacheShard(hash);
+			ShardLock lock(shard.lock);
+
+			FileCacheShard::Node& node = shard.files[hash];
+			node.path = key;
+			node.cache = cache;
+		}
+
+		void FileCache::addFolder(const std::string& path)
+		{
+			if (!mEnabled)
+				return;
+
+			uint64_t hash = hashPath(path.c_str(), path.size());
+
+			FileCacheShard& shard = getFileCacheShard(hash);
+			ShardLock lock(shard.lock);
+
+			shard.folders[hash] = path;
+		}
+
+		bool FileCache::get(const std::string& key, FileCache& cache)
+		{
+			if (!mEnabled)
+				return false;
+
+			uint64_t hash = hashPath(key.c_str(), key.size());
+
+			{
+				FileCacheShard& shard = getFileCacheShard(hash);
+				ShardLock lock(shard.lock);
+
+				auto it = shard.files.find(hash);
+				if (it != shard.files.cend() && it->second.path == key)
+				{
+					cache = it->second.cache;
+					mHits++;
+					return true;
+				}
+			}
+
+			// The parent is hashed in place, no need to build its path
+			size_t parentLength = key.find_last_of('/');
+			if (parentLength != std::string::npos && isFolderEnumerated(key, parentLength))
+			{
+				cache = FileCache(false, false);
+				add(key, cache);
+				mHits++;
+				return true;
+			}
+
+			mMisses++;
+			return false;
+		}
+
+		bool FileCache::isFolderEnumerated(const std::string& key, size_t parentLength)
+		{
+			uint64_t hash = hashPath(key.c_str(), parentLength);
+
+			FileCacheShard& shard = getFileCacheShard(hash);
+			ShardLock lock(shard.lock);
+
+			auto it = shard.folders.find(hash);
+			return it != shard.folders.cend() && it->second.size() == parentLength && key.compare(0, parentLength, it->second) == 0;
+		}
+
+		void FileCache::resetCache()
+		{
+			for (int i = 0; i < FILECACHE_SHARDS; i++)
+			{
+				ShardLock lock(sFileCacheShards[i].lock);
+				sFileCacheShards[i].files.clear();
+				sFileCacheShards[i].folders.clear();
+			}
+		}
+
+		void FileCache::logStatistics()
+		{
+			uint64_t hits = mHits.exchange(0);
+			uint64_t misses = mMisses.exchange(0);
+			uint64_t contentions = mContentions.exchange(0);
+			uint64_t contentionTime = mContentionTime.exchange(0);
+
+			if (hits + misses > 0)
+			{
+				LOG(LogInfo) << "FileCache : " << hits << " hits, " << misses << " misses, " << contentions << " contended locks (" << (contentionTime / 1000) << "us waiting)";
+			}
+		}
+
 	// FileSystemCacheActivator
 
 		int FileSystemCacheActivator::mReferenceCount = 0;
@@ -195,6 +312,8 @@ namespace Utils
 			}
 
 			mReferenceCount++;
+
+			DirectoryIndex::activate();
 		}
 
 		FileSystemCacheActivator::~FileSystemCacheActivator()
@@ -204,9 +323,61 @@ namespace Utils
 			if (mReferenceCount <= 0)
 			{
 				FileCache::setEnabled(false);
+				FileCache::logStatistics();
 				FileCache::resetCache();
 			}
+
+			DirectoryIndex::release();
+		}
+
+#if !defined(_WIN32)
+		// Lists the folder from the DirectoryIndex when it's up to date, otherwise enumerates it and updates the index
+		static void readDirectoryEntries(const std::string& path, std::vector<DirectoryIndex::Entry>& entries)
+		{
+			long long mtime = -1;
+			if (DirectoryIndex::lookup(path, entries, mtime))
+				return;
+
+			DIR* dir = opendir(path.c_str());
+			if (dir == NULL)
+				return;
+
+			struct dirent* entry;
+
+			// loop over all files in the directory
+			while ((entry = readdir(dir)) != NULL)
+			{
+				std::string name(entry->d_name);
+
+				// ignore "." and ".."
+				if (name == "." || name == "..")
+					continue;
+
+				unsigned char flags = 0;
+
+				if (name[0] == '.')
+					flags |= DirectoryIndex::ENTRY_HIDDEN;
+
+				if (entry->d_type == 10) // DT_LNK
+				{
+					flags |= DirectoryIndex::ENTRY_SYMLINK;
+
+					struct stat64 info;
+					if (stat64(resolveSymlink(path + "/" + name).c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+						flags |= DirectoryIndex::ENTRY_DIRECTORY;
+				}
+				else if (entry->d_type == 4) // DT_DIR
+					flags |= DirectoryIndex::ENTRY_DIRECTORY;
+
+				entries.push_back({ name, flags });
+			}
+
+			closedir(dir);
+
+			if (mtime >= 0)
+				DirectoryIndex::update(path, mtime, entries);
 		}
+#endif
 
 	// Methods
 
@@ -219,7 +390,7 @@ namespace Utils
 			if(isDirectory(path))
 			{
 				// tell filecache we enumerated the folder
-				FileCache::add(path + "/*", FileCache(true, true));
+				FileCache::addFolder(path);
 
 #if defined(_WIN32)
 				WIN32_FIND_DATAW findData;
@@ -259,39 +430,26 @@ namespace Utils
 					FindClose(hFind);
 				}
 #else // _WIN32
-				DIR* dir = opendir(path.c_str());
+				std::vector<DirectoryIndex::Entry> entries;
+				readDirectoryEntries(path, entries);
 
-				if(dir != NULL)
+				for (auto& entry : entries)
 				{
-					struct dirent* entry;
-
-					// loop over all files in the directory
-					while((entry = readdir(dir)) != NULL)
-					{
-						std::string name(entry->d_name);
+					std::string fullName(getGenericPath(path + "/" + entry.name));
 
-						// ignore "." and ".."
-						if((name != ".") && (name != ".."))
-						{
-							std::string fullName(getGenericPath(path + "/" + name));
+					FileCache cache(entry);
+					FileCache::add(fullName, cache);
 
-							FileCache cache(fullName, entry, getFileName(fullName)[0] == '.');
-							FileCache::add(fullName, cache);
-
-							if (!includeHidden && cache.hidden)
-								continue;
+					if (!includeHidden && cache.hidden)
+						continue;
 
-							contentList.push_back(fullName);
+					contentList.push_back(fullName);
 
-							if (_recursive && cache.directory)
-							{
-								for (auto item : getDirContent(fullName, true, includeHidden))
-									contentList.push_back(item);
-							}
-						}
+					if (_recursive && cache.directory)
+					{
+						for (auto item : getDirContent(fullName, true, includeHidden))
+							contentList.push_back(item);
 					}
-
-					closedir(dir);
 				}
 #endif // _WIN32
 
@@ -322,7 +480,7 @@ namespace Utils
 			fileList  contentList;
 
 			// tell filecache we enumerated the folder
-			FileCache::add(path + "/*", FileCache(true, true));
+			FileCache::addFolder(path);
 
 			// only parse the directory, if it's a directory
 			// if (isDirectory(path))
@@ -389,45 +547,20 @@ namespace Utils
 					FindClose(hFind);
 				}
 #else // _WIN32
-				DIR* dir = opendir(path.c_str());
+				std::vector<DirectoryIndex::Entry> entries;
+				readDirectoryEntries(path, entries);
 
-				if (dir != NULL)
+				for (auto& entry : entries)
 				{
-					struct dirent* entry;
+					FileCache cache(entry);
 
-					// loop over all files in the directory
-					while ((entry = readdir(dir)) != NULL)
-					{
-						std::string name(entry->d_name);
-
-						// ignore "." and ".."
-						if ((name != ".") && (name != ".."))
-						{
-							std::string fullName(getGenericPath(path + "/" + name));
+					FileInfo fi;
+					fi.path = getGenericPath(path + "/" + entry.name);
+					fi.hidden = cache.hidden;
+					fi.directory = cache.directory;
 
-							FileInfo fi;
-							fi.path = fullName;
-							fi.hidden = Utils::FileSystem::isHidden(fullName);
-
-							if (entry->d_type == 10) // DT_LNK
-							{
-								struct stat64 si;
-								if (stat64(resolveSymlink(fullName).c_str(), &si) == 0)
-									fi.directory = S_ISDIR(si.st_mode);
-								else
-									fi.directory = false;
-							}
-							else
-								fi.directory = (entry->d_type == 4); // DT_DIR;
-
-							FileCache::add(fullName, FileCache(fullName, entry, fi.hidden));
-
-							//DT_LNK
-							contentList.push_back(fi);
-						}
-					}
-
-					closedir(dir);
+					FileCache::add(fi.path, cache);
+					contentList.push_back(fi);
 				}
 #endif // _WIN32
 
@@ -961,9 +1094,9 @@ namespace Utils
 			if (_path.empty())
 				return false;
 
-			auto it = FileCache::get(_path);
-			if (it != nullptr)
-				return it->exists;
+			FileCache cache;
+			if (FileCache::get(_path, cache))
+				return cache.exists;
 
 #ifdef WIN32			
 			if (!FileCache::isEnabled())
@@ -1000,9 +1133,9 @@ namespace Utils
 
 		bool isRegularFile(const std::string& _path)
 		{
-			auto it = FileCache::get(_path);
-			if (it != nullptr)
-				return it->exists && !it->directory && !it->isSymLink;
+			FileCache cache;
+			if (FileCache::get(_path, cache))
+				return cache.exists && !cache.directory && !cache.isSymLink;
 
 			std::string path = getGenericPath(_path);
 			struct stat64 info;
@@ -1018,9 +1151,9 @@ namespace Utils
 
 		bool isDirectory(const std::string& _path)
 		{
-			auto it = FileCache::get(_path);
-			if (it != nullptr)
-				return it->exists && it->directory;
+			FileCache cache;
+			if (FileCache::get(_path, cache))
+				return cache.exists && cache.directory;
 
 #ifdef WIN32
 			// check for symlink attribute
@@ -1049,9 +1182,9 @@ namespace Utils
 		bool isSymlink(const std::string& _path)
 		{
 		
-			auto it = FileCache::get(_path);
-			if (it != nullptr)
-				return it->exists && it->isSymLink;
+			FileCache cache;
+			if (FileCache::get(_path, cache))
+				return cache.exists && cache.isSymLink;
 				
 			std::string path = getGenericPath(_path);
 
@@ -1079,9 +1212,9 @@ namespace Utils
 
 		bool isHidden(const std::string& _path)
 		{
-			auto it = FileCache::get(_path);
-			if (it != nullptr)
-				return it->exists && it->hidden;
+			FileCache cache;
+			if (FileCache::get(_path, cache))
+				return cache.exists && cache.hidden;
 
 			std::string path = getGenericPath(_path);
 
@@ -1438,80 +1571,88 @@ namespace Utils
 			return pdfpath;
 		}
 		
-		std::string getFileCrc32(const std::string& filename)
+		bool getFileHashes(const std::string& filename, std::string* crc32, std::string* md5)
 		{
-			std::string hex;
+			if (crc32 == nullptr && md5 == nullptr)
+				return false;
 
 #if defined(_WIN32)
 			FILE* file = _wfopen(Utils::String::convertToWideString(filename).c_str(), L"rb");
 #else			
 			FILE* file = fopen(filename.c_str(), "rb");
 #endif
-			if (file)
-			{
-				// Retroarch CRC calculations are limited in size. See encoding_crc32.c
-				#define CRC32_BUFFER_SIZE 1048576
-				#define CRC32_MAX_MB 64
+			if (file == nullptr)
+				return false;
 
-				char* buffer = new char[CRC32_BUFFER_SIZE];
-				if (buffer)
-				{
-					size_t size;
-					unsigned int file_crc32 = 0;
+			// Retroarch CRC calculations are limited in size. See encoding_crc32.c
+			#define HASH_BUFFER_SIZE 1048576
+			#define CRC32_MAX_MB 64
 
-					for (int i = 0; i < CRC32_MAX_MB; i++)
-					{
-						size = fread(buffer, 1, CRC32_BUFFER_SIZE, file);
-						if (size == 0)
-							break;
+			// Reads go straight to our buffer, and the kernel can read ahead
+			setvbuf(file, nullptr, _IONBF, 0);
+#if !defined(_WIN32) && !defined(__APPLE__)
+			posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
 
-						file_crc32 = Utils::Zip::ZipFile::computeCRC(file_crc32, buffer, size);
-					}
+			std::unique_ptr<char[]> buffer(new char[HASH_BUFFER_SIZE]);
+
+			unsigned int file_crc32 = 0;
+			int crcBlocks = 0;
+
+			MD5 md5Hash;
 
-					hex = Utils::String::toHexString(file_crc32);
+			while (md5 != nullptr || (crc32 != nullptr && crcBlocks < CRC32_MAX_MB))
+			{
+				size_t size = fread(buffer.get(), 1, HASH_BUFFER_SIZE, file);
+				if (size == 0)
+					break;
 
-					delete buffer;
+				if (crc32 != nullptr && crcBlocks < CRC32_MAX_MB)
+				{
+					file_crc32 = Utils::Zip::ZipFile::computeCRC(file_crc32, buffer.get(), size);
+					crcBlocks++;
 				}
 
-				fclose(file);
+				if (md5 != nullptr)
+					md5Hash.update(buffer.get(), (MD5::size_type)size);
 			}
 
-			return hex;
-		}
+			bool ok = ferror(file) == 0;
 
-		std::string getFileMd5(const std::string& filename)
-		{
-			std::string hex;
-
-#if defined(_WIN32)
-			FILE* file = _wfopen(Utils::String::convertToWideString(filename).c_str(), L"rb");
-#else			
-			FILE* file = fopen(filename.c_str(), "rb");
+#if !defined(_WIN32) && !defined(__APPLE__)
+			// Hashing a whole library shouldn't evict everything else from the page cache
+			posix_fadvise(fileno(file), 0, 0, POSIX_FADV_DONTNEED);
 #endif
-			if (file)
-			{
-				#define CRCBUFFERSIZE 64 * 1024
-				char* buffer = new char[CRCBUFFERSIZE];
+			fclose(file);
 
-				if (buffer)
-				{
-					MD5 md5;
+			if (!ok)
+				return false;
 
-					size_t size;
-					while (size = fread(buffer, 1, CRCBUFFERSIZE, file))
-						md5.update(buffer, size);
+			if (crc32 != nullptr)
+				*crc32 = Utils::String::toHexString(file_crc32);
 
-					md5.finalize();
-					hex = md5.hexdigest();
+			if (md5 != nullptr)
+			{
+				md5Hash.finalize();
+				*md5 = md5Hash.hexdigest();
+			}
 
-					delete buffer;
-				}
+			return true;
+		}
 
-				fclose(file);
-			}
+		std::string getFileCrc32(const std::string& filename)
+		{
+			std::string hex;
+			getFileHashes(filename, &hex, nullptr);
+			return hex;
+		}
 
+		std::string getFileMd5(const std::string& filename)
+		{
+			std::string hex;
+			getFileHashes(filename, nullptr, &hex);
 			return hex;
-		}		
+		}
 
 		static std::set<std::string> _imageExtensions = { ".jpg", ".png", ".jpeg", ".gif" };
 		static std::set<std::string> _videoExtensions = { ".mp4", ".avi", ".mkv", ".webm" };
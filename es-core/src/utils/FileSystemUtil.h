@@ -85,6 +85,9 @@ namespace Utils
 		std::string getFileCrc32(const std::string& filename);
 		std::string getFileMd5(const std::string& filename);
 
+		// Computes the requested digests (nullptr to skip one) in a single read of the file
+		bool		getFileHashes(const std::string& filename, std::string* crc32, std::string* md5);
+
 		std::string changeExtension(const std::string& _path, const std::string& extension);
 
 		class FileSystemCacheActivator
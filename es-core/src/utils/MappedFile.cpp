@@ -0,0 +1,120 @@
+#define _FILE_OFFSET_BITS 64
+
+#include "utils/MappedFile.h"
+#include "utils/StringUtil.h"
+
+#if WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Utils
+{
+#if WIN32
+	MappedFile::MappedFile() : mData(nullptr), mSize(0), mFileHandle(INVALID_HANDLE_VALUE), mMappingHandle(nullptr) { }
+#else
+	MappedFile::MappedFile() : mData(nullptr), mSize(0), mFileDescriptor(-1) { }
+#endif
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+
+#if WIN32
+		HANDLE hFile = CreateFileW(Utils::String::convertToWideString(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(hFile);
+			return false;
+		}
+
+		HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (hMapping == nullptr)
+		{
+			CloseHandle(hFile);
+			return false;
+		}
+
+		void* view = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr)
+		{
+			CloseHandle(hMapping);
+			CloseHandle(hFile);
+			return false;
+		}
+
+		mFileHandle = hFile;
+		mMappingHandle = hMapping;
+		mData = (const unsigned char*)view;
+		mSize = (size_t)fileSize.QuadPart;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat64 info;
+		if (fstat64(fd, &info) != 0 || info.st_size <= 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view == MAP_FAILED)
+		{
+			::close(fd);
+			return false;
+		}
+
+		// The whole file is parsed sequentially right after mapping
+		madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+		mFileDescriptor = fd;
+		mData = (const unsigned char*)view;
+		mSize = (size_t)info.st_size;
+#endif
+
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+#if WIN32
+		if (mData != nullptr)
+			UnmapViewOfFile(mData);
+
+		if (mMappingHandle != nullptr)
+			CloseHandle(mMappingHandle);
+
+		if (mFileHandle != INVALID_HANDLE_VALUE)
+			CloseHandle(mFileHandle);
+
+		mMappingHandle = nullptr;
+		mFileHandle = INVALID_HANDLE_VALUE;
+#else
+		if (mData != nullptr)
+			munmap((void*)mData, mSize);
+
+		if (mFileDescriptor >= 0)
+			::close(mFileDescriptor);
+
+		mFileDescriptor = -1;
+#endif
+
+		mData = nullptr;
+		mSize = 0;
+	}
+}
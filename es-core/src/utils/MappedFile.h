@@ -0,0 +1,40 @@
+#pragma once
+#ifndef ES_CORE_UTILS_MAPPED_FILE_H
+#define ES_CORE_UTILS_MAPPED_FILE_H
+
+#include <string>
+#include <stddef.h>
+
+namespace Utils
+{
+	// Read-only view over a whole file. The file is memory-mapped when the platform allows it, so binary caches can be parsed in place without copying them first.
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool open(const std::string& path);
+		void close();
+
+		inline bool isOpen() const { return mData != nullptr; }
+		inline const unsigned char* data() const { return mData; }
+		inline size_t size() const { return mSize; }
+
+	private:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const unsigned char* mData;
+		size_t mSize;
+
+#if WIN32
+		void* mFileHandle;
+		void* mMappingHandle;
+#else
+		int mFileDescriptor;
+#endif
+	};
+}
+
+#endif // ES_CORE_UTILS_MAPPED_FILE_H
@@ -0,0 +1,248 @@
+#include "utils/TaskScheduler.h"
+
+#include "Tracer.h"
+
+namespace Utils
+{
+	// Index of the current thread in the scheduler running it, -1 for threads that are not workers
+	static thread_local TaskScheduler* tCurrentScheduler = nullptr;
+	static thread_local int tWorkerIndex = -1;
+
+	TaskScheduler* TaskScheduler::sInstance = nullptr;
+
+	TaskScheduler* TaskScheduler::getInstance()
+	{
+		static std::mutex instanceLock;
+		std::unique_lock<std::mutex> lock(instanceLock);
+
+		// Never deleted : workers are parked when idle, and tasks may still be running at exit
+		if (sInstance == nullptr)
+			sInstance = new TaskScheduler();
+
+		return sInstance;
+	}
+
+	TaskScheduler::TaskScheduler(int threadCount) : mQueuedTasks(0), mParkedThreads(0), mRunning(true)
+	{
+		if (threadCount <= 0)
+			threadCount = std::thread::hardware_concurrency() * 2;
+
+		if (threadCount < 2)
+			threadCount = 2;
+
+		for (int i = 0; i < threadCount; i++)
+			mQueues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+
+		mThreads.reserve(threadCount);
+
+		for (int i = 0; i < threadCount; i++)
+			mThreads.push_back(std::thread(&TaskScheduler::workerLoop, this, i));
+	}
+
+	TaskScheduler::~TaskScheduler()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mParkLock);
+			mRunning = false;
+		}
+
+		mParkCondition.notify_all();
+
+		for (std::thread& t : mThreads)
+			if (t.joinable())
+				t.join();
+	}
+
+	void TaskScheduler::submit(work_function work, const void* owner)
+	{
+		// Workers push on their own deque, other threads use the injection queue
+		TaskQueue* queue = (tCurrentScheduler == this && tWorkerIndex >= 0) ? mQueues[tWorkerIndex].get() : &mInjectionQueue;
+
+		{
+			std::unique_lock<std::mutex> lock(queue->lock);
+			queue->tasks.push_back({ work, owner });
+		}
+
+		mQueuedTasks++;
+
+		// A worker parks only after incrementing mParkedThreads and checking mQueuedTasks, so one of both sides sees the other
+		if (mParkedThreads > 0)
+		{
+			std::unique_lock<std::mutex> lock(mParkLock);
+			mParkCondition.notify_one();
+		}
+	}
+
+	bool TaskScheduler::popTask(int index, Task& task)
+	{
+		// Own deque first, newest task (still hot in cache)
+		{
+			TaskQueue* queue = mQueues[index].get();
+
+			std::unique_lock<std::mutex> lock(queue->lock);
+			if (!queue->tasks.empty())
+			{
+				task = std::move(queue->tasks.back());
+				queue->tasks.pop_back();
+				return true;
+			}
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(mInjectionQueue.lock);
+			if (!mInjectionQueue.tasks.empty())
+			{
+				task = std::move(mInjectionQueue.tasks.front());
+				mInjectionQueue.tasks.pop_front();
+				return true;
+			}
+		}
+
+		// Steal the oldest task of another worker
+		int count = (int)mQueues.size();
+		for (int i = 1; i < count; i++)
+		{
+			TaskQueue* queue = mQueues[(index + i) % count].get();
+
+			std::unique_lock<std::mutex> lock(queue->lock, std::try_to_lock);
+			if (lock.owns_lock() && !queue->tasks.empty())
+			{
+				task = std::move(queue->tasks.front());
+				queue->tasks.pop_front();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool TaskScheduler::runPendingTask(const void* owner)
+	{
+		Task task;
+		bool found = false;
+
+		auto takeFrom = [&task, &found, owner](TaskQueue* queue)
+		{
+			std::unique_lock<std::mutex> lock(queue->lock);
+			for (auto it = queue->tasks.begin(); it != queue->tasks.end(); ++it)
+			{
+				if (it->owner != owner)
+					continue;
+
+				task = std::move(*it);
+				queue->tasks.erase(it);
+				found = true;
+				break;
+			}
+		};
+
+		if (tCurrentScheduler == this && tWorkerIndex >= 0)
+			takeFrom(mQueues[tWorkerIndex].get());
+
+		if (!found)
+			takeFrom(&mInjectionQueue);
+
+		for (int i = 0; !found && i < (int)mQueues.size(); i++)
+			if (i != tWorkerIndex || tCurrentScheduler != this)
+				takeFrom(mQueues[i].get());
+
+		if (!found)
+			return false;
+
+		mQueuedTasks--;
+
+		try
+		{
+			TRACE_SCOPE("Task");
+			task.work();
+		}
+		catch (...) {}
+
+		return true;
+	}
+
+	void TaskScheduler::workerLoop(int index)
+	{
+		tCurrentScheduler = this;
+		tWorkerIndex = index;
+
+		Tracer::setThreadName("Worker " + std::to_string(index + 1));
+
+		while (mRunning)
+		{
+			Task task;
+			if (popTask(index, task))
+			{
+				mQueuedTasks--;
+
+				try
+				{
+					TRACE_SCOPE("Task");
+					task.work();
+				}
+				catch (...) {}
+
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(mParkLock);
+
+			mParkedThreads++;
+			mParkCondition.wait(lock, [this] { return !mRunning || mQueuedTasks > 0; });
+			mParkedThreads--;
+		}
+	}
+
+	TaskGroup::TaskGroup(TaskScheduler* scheduler) : mScheduler(scheduler), mPendingTasks(0), mCancelled(false)
+	{
+		if (mScheduler == nullptr)
+			mScheduler = TaskScheduler::getInstance();
+	}
+
+	TaskGroup::~TaskGroup()
+	{
+		wait();
+	}
+
+	// Last access of a task to its group : the group may be destroyed as soon as mLock is released
+	void TaskGroup::taskDone()
+	{
+		std::unique_lock<std::mutex> lock(mLock);
+		if (--mPendingTasks == 0)
+			mCondition.notify_all();
+	}
+
+	// The counter is only tested under mLock : seeing 0 then means the last taskDone has released the group
+	bool TaskGroup::isDone()
+	{
+		std::unique_lock<std::mutex> lock(mLock);
+		return mPendingTasks == 0;
+	}
+
+	void TaskGroup::wait()
+	{
+		while (!isDone())
+		{
+			// Help instead of blocking : avoids starving the scheduler when a worker waits for a nested group
+			if (mScheduler->runPendingTask(this))
+				continue;
+
+			// Remaining tasks are running on workers, or are continuations not queued yet
+			std::unique_lock<std::mutex> lock(mLock);
+			if (mCondition.wait_for(lock, std::chrono::milliseconds(10), [this] { return mPendingTasks == 0; }))
+				return;
+		}
+	}
+
+	void TaskGroup::wait(const std::function<void(void)>& work, int delay)
+	{
+		while (!isDone())
+		{
+			work();
+
+			std::unique_lock<std::mutex> lock(mLock);
+			if (mCondition.wait_for(lock, std::chrono::milliseconds(delay), [this] { return mPendingTasks == 0; }))
+				return;
+		}
+	}
+}
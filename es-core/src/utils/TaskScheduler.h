@@ -0,0 +1,255 @@
+#pragma once
+#ifndef ES_CORE_UTILS_TASK_SCHEDULER_H
+#define ES_CORE_UTILS_TASK_SCHEDULER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <future>
+#include <exception>
+#include <functional>
+
+namespace Utils
+{
+	// Work-stealing scheduler : every worker owns a deque (LIFO for the owner, FIFO for thieves), tasks coming from other threads go to a shared injection queue.
+	// Idle workers park on a condition variable, so the scheduler does not use any cpu while there's nothing to do.
+	class TaskScheduler
+	{
+	public:
+		typedef std::function<void(void)> work_function;
+
+		// Shared scheduler used by TaskGroups, started on first use
+		static TaskScheduler* getInstance();
+
+		// threadCount <= 0 : two threads per core, as loading tasks mostly wait on I/O
+		TaskScheduler(int threadCount = 0);
+		~TaskScheduler();
+
+		// owner is an opaque tag, it only allows a waiting thread to pick up its own tasks with runPendingTask
+		void submit(work_function work, const void* owner = nullptr);
+
+		// Executes one queued task belonging to owner on the calling thread. Returns false if there was none.
+		bool runPendingTask(const void* owner);
+
+		int getThreadCount() { return (int)mThreads.size(); }
+
+	private:
+		struct Task
+		{
+			work_function work;
+			const void* owner;
+		};
+
+		struct TaskQueue
+		{
+			std::mutex lock;
+			std::deque<Task> tasks;
+		};
+
+		TaskScheduler(const TaskScheduler&) = delete;
+		TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+		void workerLoop(int index);
+		bool popTask(int index, Task& task);
+
+		std::vector<std::thread> mThreads;
+		std::vector<std::unique_ptr<TaskQueue>> mQueues;
+		TaskQueue mInjectionQueue;
+
+		std::mutex mParkLock;
+		std::condition_variable mParkCondition;
+
+		std::atomic<int> mQueuedTasks;
+		std::atomic<int> mParkedThreads;
+		std::atomic<bool> mRunning;
+
+		static TaskScheduler* sInstance;
+	};
+
+	// Thrown by Task::get when the group was cancelled before the task could start
+	class TaskCancelledException : public std::exception
+	{
+	public:
+		const char* what() const noexcept override { return "task cancelled"; }
+	};
+
+	template<typename T> class Task;
+
+	namespace Internal
+	{
+		template<typename T> struct TaskState
+		{
+			TaskState() : future(promise.get_future().share()), done(false) { }
+
+			void complete()
+			{
+				std::vector<std::function<void(void)>> continuations;
+
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					done = true;
+					continuations.swap(mContinuations);
+				}
+
+				for (auto& continuation : continuations)
+					continuation();
+			}
+
+			void addContinuation(const std::function<void(void)>& continuation)
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					if (!done)
+					{
+						mContinuations.push_back(continuation);
+						return;
+					}
+				}
+
+				continuation();
+			}
+
+			std::promise<T> promise;
+			std::shared_future<T> future;
+			std::mutex mutex;
+			bool done;
+
+		private:
+			std::vector<std::function<void(void)>> mContinuations;
+		};
+
+		template<typename T, typename F> inline void setResult(std::promise<T>& promise, F& work) { promise.set_value(work()); }
+		template<typename F> inline void setResult(std::promise<void>& promise, F& work) { work(); promise.set_value(); }
+	}
+
+	// Set of tasks that can be waited for, or cancelled, together. The destructor waits for every pending task.
+	class TaskGroup
+	{
+	public:
+		TaskGroup(TaskScheduler* scheduler = nullptr);
+		~TaskGroup();
+
+		template<typename F> auto run(F work) -> Task<decltype(work())>;
+
+		// Blocks until all the tasks of the group are done. Queued tasks of the group are executed by the calling thread meanwhile.
+		void wait();
+
+		// Blocks until all the tasks of the group are done, calling work every 'delay' ms (used to refresh the splash screen from the main thread)
+		void wait(const std::function<void(void)>& work, int delay = 50);
+
+		// Tasks not started yet are dropped. Running tasks can check isCancelled to exit early.
+		void cancel() { mCancelled = true; }
+		bool isCancelled() { return mCancelled; }
+
+		int getPendingCount() { return mPendingTasks; }
+
+	private:
+		template<typename T> friend class Task;
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		template<typename T, typename F> void submit(std::shared_ptr<Internal::TaskState<T>> state, F work);
+		void taskDone();
+		bool isDone();
+
+		TaskScheduler* mScheduler;
+
+		std::atomic<int> mPendingTasks;
+		std::atomic<bool> mCancelled;
+
+		std::mutex mLock;
+		std::condition_variable mCondition;
+	};
+
+	// Result of a task started by a TaskGroup.
+	template<typename T> class Task
+	{
+	public:
+		Task() : mGroup(nullptr) { }
+
+		bool valid() const { return mState != nullptr; }
+		bool isReady() const { return mState != nullptr && mState->future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+
+		void wait() const { mState->future.wait(); }
+
+		// Rethrows the exception of the task, or TaskCancelledException
+		decltype(std::declval<std::shared_future<T>>().get()) get() const { return mState->future.get(); }
+
+		// Schedules continuation in the same group once this task is finished. continuation receives this task.
+		template<typename C> auto then(C continuation) -> Task<decltype(continuation(std::declval<Task<T>>()))>;
+
+	private:
+		friend class TaskGroup;
+		template<typename U> friend class Task;
+
+		Task(TaskGroup* group, std::shared_ptr<Internal::TaskState<T>> state) : mGroup(group), mState(state) { }
+
+		TaskGroup* mGroup;
+		std::shared_ptr<Internal::TaskState<T>> mState;
+	};
+
+	template<typename T, typename F>
+	void TaskGroup::submit(std::shared_ptr<Internal::TaskState<T>> state, F work)
+	{
+		// mPendingTasks was already incremented by the caller
+		mScheduler->submit([this, state, work]() mutable
+		{
+			if (mCancelled)
+				state->promise.set_exception(std::make_exception_ptr(TaskCancelledException()));
+			else
+			{
+				try
+				{
+					Internal::setResult(state->promise, work);
+				}
+				catch (...)
+				{
+					state->promise.set_exception(std::current_exception());
+				}
+			}
+
+			state->complete();
+			taskDone();
+		}, this);
+	}
+
+	template<typename F>
+	auto TaskGroup::run(F work) -> Task<decltype(work())>
+	{
+		typedef decltype(work()) R;
+
+		auto state = std::make_shared<Internal::TaskState<R>>();
+
+		mPendingTasks++;
+		submit(state, work);
+
+		return Task<R>(this, state);
+	}
+
+	template<typename T> template<typename C>
+	auto Task<T>::then(C continuation) -> Task<decltype(continuation(std::declval<Task<T>>()))>
+	{
+		typedef decltype(continuation(std::declval<Task<T>>())) R;
+
+		auto state = std::make_shared<Internal::TaskState<R>>();
+		auto group = mGroup;
+		auto antecedent = *this;
+
+		// Counted right away so that TaskGroup::wait can't return before the continuation is queued
+		group->mPendingTasks++;
+
+		mState->addContinuation([group, state, antecedent, continuation]()
+		{
+			group->submit(state, [antecedent, continuation]() mutable { return continuation(antecedent); });
+		});
+
+		return Task<R>(group, state);
+	}
+}
+
+#endif // ES_CORE_UTILS_TASK_SCHEDULER_H
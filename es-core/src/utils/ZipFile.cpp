@@ -11,6 +11,8 @@
 #include <iostream>
 #include <cstring>
 #include <string>
+// mz_crc32 is implemented below with ZipFile::computeCRC, so members are checked faster when they are extracted
+#define MINIZ_EXTERNAL_CRC32
 #include "zip_file.hpp"
 #include "FileSystemUtil.h"
 #include "md5.h"
@@ -20,9 +22,56 @@ namespace Utils
 {
 	namespace Zip
 	{
+		// Slice-by-8 CRC32 tables : miniz's mz_crc32 does two 4 bits lookups per byte, this does 8 bytes per iteration
+		struct Crc32Tables
+		{
+			Crc32Tables()
+			{
+				for (unsigned int i = 0; i < 256; i++)
+				{
+					unsigned int crc = i;
+					for (int j = 0; j < 8; j++)
+						crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+
+					table[0][i] = crc;
+				}
+
+				for (unsigned int i = 0; i < 256; i++)
+					for (int slice = 1; slice < 8; slice++)
+						table[slice][i] = (table[slice - 1][i] >> 8) ^ table[0][table[slice - 1][i] & 0xFF];
+			}
+
+			uint32_t table[8][256];
+		};
+
 		unsigned int ZipFile::computeCRC(unsigned int crc, const void* ptr, size_t buf_len)
-		{			
-			return (mz_uint32)mz_crc32((mz_uint32)crc, (const mz_uint8 *)ptr, buf_len);
+		{
+			static const Crc32Tables tables;
+			const uint32_t (*table)[256] = tables.table;
+
+			const unsigned char* data = (const unsigned char*)ptr;
+			uint32_t value = ~(uint32_t)crc;
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			while (buf_len >= 8)
+			{
+				uint32_t one, two;
+				memcpy(&one, data, 4);
+				memcpy(&two, data + 4, 4);
+				one ^= value;
+
+				value = table[7][one & 0xFF] ^ table[6][(one >> 8) & 0xFF] ^ table[5][(one >> 16) & 0xFF] ^ table[4][one >> 24] ^
+					table[3][two & 0xFF] ^ table[2][(two >> 8) & 0xFF] ^ table[1][(two >> 16) & 0xFF] ^ table[0][two >> 24];
+
+				data += 8;
+				buf_len -= 8;
+			}
+#endif
+
+			while (buf_len-- > 0)
+				value = (value >> 8) ^ table[0][(value ^ *data++) & 0xFF];
+
+			return ~value;
 		}
 
 		#define mZipArchive   ((mz_zip_archive*) mZipFile)
@@ -367,3 +416,11 @@ namespace Utils
 	} // Zip::
 
 } // Utils::
+
+mz_ulong mz_crc32(mz_ulong crc, const mz_uint8 *ptr, size_t buf_len)
+{
+	if (!ptr)
+		return MZ_CRC32_INIT;
+
+	return Utils::Zip::ZipFile::computeCRC((unsigned int)crc, ptr, buf_len);
+}
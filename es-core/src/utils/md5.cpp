@@ -143,9 +143,14 @@ void MD5::init()
 // decodes input (unsigned char) into output (uint4). Assumes len is a multiple of 4.
 void MD5::decode(uint4 output[], const uint1 input[], size_type len)
 {
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	// Host order is already MD5 order
+	memcpy(output, input, len);
+#else
 	for (unsigned int i = 0, j = 0; j < len; i++, j += 4)
 		output[i] = ((uint4)input[j]) | (((uint4)input[j + 1]) << 8) |
 		(((uint4)input[j + 2]) << 16) | (((uint4)input[j + 3]) << 24);
+#endif
 }
 
 //////////////////////////////
@@ -0,0 +1,235 @@
+#include "sevenzip.h"
+
+#include "7z.h"
+#include "7zCrc.h"
+#include "7zFile.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define SEVENZIP_LOOKAHEAD_SIZE (1 << 18)
+
+static void* sevenZipAlloc(ISzAllocPtr p, size_t size)
+{
+	return size == 0 ? nullptr : std::malloc(size);
+}
+
+static void sevenZipFree(ISzAllocPtr p, void* address)
+{
+	std::free(address);
+}
+
+static const ISzAlloc sAllocator = { sevenZipAlloc, sevenZipFree };
+
+static std::string utf16ToUtf8(const uint16_t* text)
+{
+	std::string ret;
+
+	for (size_t i = 0; text[i] != 0; i++)
+	{
+		uint32_t c = text[i];
+
+		// Surrogate pair
+		if (c >= 0xD800 && c <= 0xDBFF && text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF)
+		{
+			c = 0x10000 + ((c - 0xD800) << 10) + (text[i + 1] - 0xDC00);
+			i++;
+		}
+
+		if (c < 0x80)
+			ret += (char)c;
+		else if (c < 0x800)
+		{
+			ret += (char)(0xC0 | (c >> 6));
+			ret += (char)(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000)
+		{
+			ret += (char)(0xE0 | (c >> 12));
+			ret += (char)(0x80 | ((c >> 6) & 0x3F));
+			ret += (char)(0x80 | (c & 0x3F));
+		}
+		else
+		{
+			ret += (char)(0xF0 | (c >> 18));
+			ret += (char)(0x80 | ((c >> 12) & 0x3F));
+			ret += (char)(0x80 | ((c >> 6) & 0x3F));
+			ret += (char)(0x80 | (c & 0x3F));
+		}
+	}
+
+	return ret;
+}
+
+class SevenZipArchive
+{
+public:
+	SevenZipArchive() : mFileOpened(false), mArchiveOpened(false)
+	{
+		memset(&mLookStream, 0, sizeof(mLookStream));
+		SzArEx_Init(&mDb);
+	}
+
+	~SevenZipArchive()
+	{
+		if (mArchiveOpened)
+			SzArEx_Free(&mDb, &sAllocator);
+
+		if (mLookStream.buf != nullptr)
+			ISzAlloc_Free(&sAllocator, mLookStream.buf);
+
+		if (mFileOpened)
+			File_Close(&mArchiveStream.file);
+	}
+
+	bool open(const char* path)
+	{
+		static bool crcTableGenerated = (CrcGenerateTable(), true);
+		(void)crcTableGenerated;
+
+#ifdef _WIN32
+		int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+		std::vector<WCHAR> widePath(length > 0 ? length : 1);
+		MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath.data(), length);
+
+		if (InFile_OpenW(&mArchiveStream.file, widePath.data()) != 0)
+			return false;
+#else
+		if (InFile_Open(&mArchiveStream.file, path) != 0)
+			return false;
+#endif
+
+		mFileOpened = true;
+
+		FileInStream_CreateVTable(&mArchiveStream);
+		LookToRead2_CreateVTable(&mLookStream, False);
+
+		mLookStream.buf = (Byte*)ISzAlloc_Alloc(&sAllocator, SEVENZIP_LOOKAHEAD_SIZE);
+		if (mLookStream.buf == nullptr)
+			return false;
+
+		mLookStream.bufSize = SEVENZIP_LOOKAHEAD_SIZE;
+		mLookStream.realStream = &mArchiveStream.vt;
+		LookToRead2_Init(&mLookStream);
+
+		if (SzArEx_Open(&mDb, &mLookStream.vt, &sAllocator, &sAllocator) != SZ_OK)
+			return false;
+
+		mArchiveOpened = true;
+		return true;
+	}
+
+	std::string getFileName(uint32_t index)
+	{
+		size_t length = SzArEx_GetFileNameUtf16(&mDb, index, nullptr);
+
+		std::vector<uint16_t> name(length + 1, 0);
+		SzArEx_GetFileNameUtf16(&mDb, index, name.data());
+
+		return utf16ToUtf8(name.data());
+	}
+
+	CSzArEx mDb;
+	CLookToRead2 mLookStream;
+
+private:
+	CFileInStream mArchiveStream;
+	bool mFileOpened;
+	bool mArchiveOpened;
+};
+
+bool sevenZipList(const char* path, std::vector<SevenZipEntry>& entries)
+{
+	SevenZipArchive archive;
+	if (!archive.open(path))
+		return false;
+
+	const CSzArEx* db = &archive.mDb;
+
+	for (uint32_t i = 0; i < db->NumFiles; i++)
+	{
+		SevenZipEntry entry;
+		entry.name = archive.getFileName(i);
+		entry.size = SzArEx_GetFileSize(db, i);
+		entry.isDirectory = SzArEx_IsDir(db, i);
+		entry.hasCrc = SzBitWithVals_Check(&db->CRCs, i);
+		entry.crc = entry.hasCrc ? db->CRCs.Vals[i] : 0;
+
+		entries.push_back(entry);
+	}
+
+	return true;
+}
+
+bool sevenZipRead(const char* path, const char* name, const std::function<void(const void* data, size_t size)>& callback, unsigned long long maxBlockSize)
+{
+	SevenZipArchive archive;
+	if (!archive.open(path))
+		return false;
+
+	const CSzArEx* db = &archive.mDb;
+
+	for (uint32_t i = 0; i < db->NumFiles; i++)
+	{
+		if (SzArEx_IsDir(db, i) || archive.getFileName(i) != name)
+			continue;
+
+		uint32_t folderIndex = db->FileToFolder[i];
+		if (folderIndex != (uint32_t)-1 && SzAr_GetFolderUnpackSize(&db->db, folderIndex) > maxBlockSize)
+			return false;
+
+		uint32_t blockIndex = 0xFFFFFFFF;
+		Byte* outBuffer = nullptr;
+		size_t outBufferSize = 0;
+		size_t offset = 0;
+		size_t outSizeProcessed = 0;
+
+		SRes res = SzArEx_Extract(db, &archive.mLookStream.vt, i, &blockIndex, &outBuffer, &outBufferSize, &offset, &outSizeProcessed, &sAllocator, &sAllocator);
+		if (res == SZ_OK)
+			callback(outBuffer + offset, outSizeProcessed);
+
+		ISzAlloc_Free(&sAllocator, outBuffer);
+		return res == SZ_OK;
+	}
+
+	return false;
+}
+
+bool sevenZipReadAll(const char* path, const std::function<void(const void* data, size_t size)>& callback, unsigned long long maxBlockSize)
+{
+	SevenZipArchive archive;
+	if (!archive.open(path))
+		return false;
+
+	const CSzArEx* db = &archive.mDb;
+
+	for (uint32_t folderIndex = 0; folderIndex < db->db.NumFolders; folderIndex++)
+		if (SzAr_GetFolderUnpackSize(&db->db, folderIndex) > maxBlockSize)
+			return false;
+
+	// The decoded block is kept by SzArEx_Extract for the next files of the same block
+	uint32_t blockIndex = 0xFFFFFFFF;
+	Byte* outBuffer = nullptr;
+	size_t outBufferSize = 0;
+	SRes res = SZ_OK;
+
+	for (uint32_t i = 0; i < db->NumFiles && res == SZ_OK; i++)
+	{
+		if (SzArEx_IsDir(db, i))
+			continue;
+
+		size_t offset = 0;
+		size_t outSizeProcessed = 0;
+
+		res = SzArEx_Extract(db, &archive.mLookStream.vt, i, &blockIndex, &outBuffer, &outBufferSize, &offset, &outSizeProcessed, &sAllocator, &sAllocator);
+		if (res == SZ_OK && outSizeProcessed > 0)
+			callback(outBuffer + offset, outSizeProcessed);
+	}
+
+	ISzAlloc_Free(&sAllocator, outBuffer);
+	return res == SZ_OK;
+}
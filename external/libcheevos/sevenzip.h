@@ -0,0 +1,27 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// In-process access to 7z archives, with the LZMA SDK built in this library
+
+struct SevenZipEntry
+{
+	std::string name; // UTF-8
+	unsigned long long size;
+	bool isDirectory;
+	bool hasCrc;
+	unsigned int crc;
+};
+
+// Lists the files of an archive, with the CRC32 stored in its headers : nothing is decompressed
+bool sevenZipList(const char* path, std::vector<SevenZipEntry>& entries);
+
+// Decompresses a file of an archive in memory, and passes its content to the callback.
+// Fails if the solid block containing the file is bigger than maxBlockSize.
+bool sevenZipRead(const char* path, const char* name, const std::function<void(const void* data, size_t size)>& callback, unsigned long long maxBlockSize);
+
+// Decompresses every file of an archive in memory, in archive order, and passes their contents to the callback : same bytes as '7z x -so'.
+// Fails if a solid block is bigger than maxBlockSize.
+bool sevenZipReadAll(const char* path, const std::function<void(const void* data, size_t size)>& callback, unsigned long long maxBlockSize);